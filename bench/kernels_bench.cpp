@@ -0,0 +1,407 @@
+/** @file */
+
+/**
+*   @brief Benchmarks of the parts of "Stack" which don't depend on the modes of "stack.h":
+*   @brief   poison - "poison_find_eq()", "poison_find_ne()", "poison_fill()" over 1 KB .. 1 GB buffers
+*   @brief   hash   - every algorithm of "stack_hash.h" as "CheckHash()" runs it over 1 MB .. 256 MB buffers
+*   @brief   alloc  - grow-and-free cycles of every "StackAllocator" of "stack_alloc.h"
+*   @brief   mt     - pushes and pops of "LockFreeStack" and "EliminationStack" in the ratios 50/50, 90/10, 10/90
+*   @brief            by 1, 2, 4 .. max threads, separate pusher and popper threads, the stacks are pre-filled
+*   @brief   snapshot - "SharedStackSnapshot()" of 1 K .. 1 M elements, 16 pushes and pops of the copy, its destructor
+*
+*   @brief Every result is one JSON line with "bench", "name", "size", "ops", "ns_per_op" and the throughput
+*   @brief ("gb_per_s" for the buffers, "ops_per_s" for the others).
+*
+*   @brief Usage: kernels_bench [time budget of one benchmark in ms] [max buffer size in MB] [max threads]
+*   @brief Max threads is std::thread::hardware_concurrency() by default.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <thread>
+#include <vector>
+
+typedef long long Stack_elem;
+
+#include "../src/stack_common.h"
+#include "../src/stack_alloc.h"
+#include "../src/stack_poison.h"
+#include "../src/stack_hash.h"
+#include "../src/stack_elimination.h"
+#include "../src/stack_shared.h"
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static double BUDGET_NS = 100 * 1e6;
+
+static double bench_now_ns()
+{
+    struct timespec now = {};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (double) now.tv_sec * 1e9 + (double) now.tv_nsec;
+}
+
+static void bench_print_bytes(const char *bench, const char *name, const size_t size, const size_t ops,
+                                                                                      const double elapsed_ns)
+{
+    double ns = elapsed_ns / (double) ops;
+
+    printf("{\"bench\": \"%s\", \"name\": \"%s\", \"size\": %zu, \"ops\": %zu, \"ns_per_op\": %.1f, \"gb_per_s\": %.2f}\n",
+           bench, name, size, ops, ns, (double) size / ns);
+}
+
+static void bench_print_ops(const char *bench, const char *name, const size_t size, const size_t ops,
+                                                                                    const double elapsed_ns)
+{
+    double ns = elapsed_ns / (double) ops;
+
+    printf("{\"bench\": \"%s\", \"name\": \"%s\", \"size\": %zu, \"ops\": %zu, \"ns_per_op\": %.1f, \"ops_per_s\": %.0f}\n",
+           bench, name, size, ops, ns, 1e9 / ns);
+}
+
+/**
+*   @brief Repeats the call of "func" until the budget ends, at least twice (the first call warms the buffer up).
+*
+*   @return number of measured calls, the time is put in "elapsed_ns"
+*/
+
+template <typename Func>
+static size_t bench_repeat(Func func, double *elapsed_ns)
+{
+    func();
+
+    size_t ops   = 0;
+    double start = bench_now_ns();
+
+    do
+    {
+        func();
+        ++ops;
+    }
+    while (bench_now_ns() - start < BUDGET_NS);
+
+    *elapsed_ns = bench_now_ns() - start;
+    return ops;
+}
+
+/*------------------------------------------------------POISON--------------------------------------------------------*/
+
+static void bench_poison(const size_t max_size)
+{
+    for (size_t size = 1 << 10; size <= max_size; size <<= 2)
+    {
+        unsigned char *buf = (unsigned char *) malloc(size);
+        if (buf == nullptr)
+            break;
+
+        double elapsed = 0;
+        size_t ops     = 0;
+
+        ops = bench_repeat([&] { poison_fill(buf, size, (unsigned char) POISON_BYTE); }, &elapsed);
+        bench_print_bytes("poison", "fill", size, ops, elapsed);
+
+        volatile size_t sink = 0;
+
+        ops = bench_repeat([&] { sink = sink + poison_find_ne(buf, size, (unsigned char) POISON_BYTE); }, &elapsed);
+        bench_print_bytes("poison", "find_ne", size, ops, elapsed);
+
+        memset(buf, 0x11, size);
+
+        ops = bench_repeat([&] { sink = sink + poison_find_eq(buf, size, (unsigned char) POISON_BYTE); }, &elapsed);
+        bench_print_bytes("poison", "find_eq", size, ops, elapsed);
+
+        free(buf);
+    }
+}
+
+/*-------------------------------------------------------HASH---------------------------------------------------------*/
+
+static void bench_hash(const size_t max_size)
+{
+    typedef unsigned long long (*hash_func_t)(const void *buf, const size_t len, const unsigned long long seed);
+
+    const char  *names[] = {"djb2",    "crc32c",    "mul64"};
+    hash_func_t  funcs[] = {hash_djb2, hash_crc32c, hash_mul64};
+
+    for (size_t size = 1 << 20; size <= max_size && size <= (256u << 20); size <<= 4)
+    {
+        unsigned char *buf = (unsigned char *) malloc(size);
+        if (buf == nullptr)
+            break;
+
+        memset(buf, (unsigned char) POISON_BYTE, size);
+
+        for (int algo = 0; algo < 3; ++algo)
+        {
+            volatile unsigned long long sink = 0;
+            double elapsed = 0;
+
+            size_t ops = bench_repeat([&] { sink = sink + funcs[algo](buf, size, HASH_START); }, &elapsed);
+            bench_print_bytes("hash", names[algo], size, ops, elapsed);
+        }
+
+        free(buf);
+    }
+}
+
+/*-------------------------------------------------------ALLOC--------------------------------------------------------*/
+
+/**
+*   @brief Allocates 64 bytes, doubles the block up to "size" bytes by realloc() and frees it, as the "Stack" store
+*   @brief does from the construction to the destruction. One cycle is one operation.
+*/
+
+static void bench_alloc(const size_t max_size)
+{
+    const char           *names[] = {"system",                "pool",                 "vm"};
+    const StackAllocator *alloc[] = {&STACK_SYSTEM_ALLOCATOR, &STACK_POOL_ALLOCATOR,
+                                     #ifdef __unix__
+                                         &STACK_VM_ALLOCATOR
+                                     #else
+                                         nullptr
+                                     #endif
+                                    };
+
+    for (size_t size = 1 << 10; size <= max_size && size <= (64u << 20); size <<= 6)
+    {
+        for (int kind = 0; kind < 3; ++kind)
+        {
+            const StackAllocator *allocator = alloc[kind];
+            if (allocator == nullptr)
+                continue;
+
+            double elapsed = 0;
+
+            size_t ops = bench_repeat([&]
+            {
+                size_t block_size = 64;
+                void  *block      = allocator->alloc(allocator->ctx, block_size);
+
+                for (; block != nullptr && block_size < size; block_size *= 2)
+                {
+                    void *temp = allocator->realloc(allocator->ctx, block, block_size, 2 * block_size);
+                    if (temp == nullptr)
+                        break;
+
+                    block = temp;
+                }
+
+                if (block != nullptr)
+                    allocator->free(allocator->ctx, block, block_size);
+            }, &elapsed);
+
+            bench_print_ops("alloc", names[kind], size, ops, elapsed);
+        }
+    }
+}
+
+/*--------------------------------------------------------MT----------------------------------------------------------*/
+
+static const size_t MT_OPS = 1 << 18;
+
+/**
+*   @brief Ratio of pushes to pops of the mt benchmark.
+*
+*   @param         name - suffix of the name in the results
+*   @param push_percent - share of the pushes among MT_OPS operations
+*/
+
+typedef struct _MtMix
+{
+    const char *name;
+    unsigned    push_percent;
+
+} MtMix;
+
+static const MtMix MT_MIXES[] = {{"50_50", 50}, {"90_10", 90}, {"10_90", 10}};
+
+/**
+*   @brief "threads_num" threads do MT_OPS pushes and pops in the ratio of "push_percent". The threads are split
+*   @brief into pushers and poppers in the same ratio (at least one of each), so the pushes and the pops of
+*   @brief different threads can meet and eliminate each other. One thread interleaves them in that ratio.
+*   @brief The stack must be filled with MT_OPS elements before, so a pop never finds it empty.
+*
+*   @return number of done operations, the time is put in "elapsed_ns"
+*/
+
+template <typename StackT, typename Push, typename Pop>
+static size_t bench_mt_run(StackT *stk, const int threads_num, const unsigned push_percent, Push push, Pop pop,
+                                                                                         double *elapsed_ns)
+{
+    std::vector<std::thread> threads;
+
+    const size_t push_ops = MT_OPS * push_percent / 100;
+    const size_t  pop_ops = MT_OPS - push_ops;
+
+    int pushers = (int) (((unsigned) threads_num * push_percent + 50) / 100);
+
+    if (pushers > threads_num - 1) pushers = threads_num - 1;
+    if (pushers < 1)               pushers = 1;
+
+    const int poppers = threads_num - pushers;
+
+    double start = bench_now_ns();
+
+    if (threads_num == 1)
+    {
+        Stack_elem val = 0;
+
+        for (size_t counter = 0; counter < MT_OPS; ++counter)
+        {
+            if ((counter * push_percent) % 100 < push_percent)
+                push(stk, (Stack_elem) counter);
+            else
+                pop (stk, &val);
+        }
+    }
+    else
+    {
+        for (int thread = 0; thread < threads_num; ++thread)
+        {
+            const bool is_pusher = thread < pushers;
+
+            threads.emplace_back([=]
+            {
+                Stack_elem val = 0;
+
+                if (is_pusher)
+                {
+                    for (size_t counter = 0; counter < push_ops / (size_t) pushers; ++counter)
+                        push(stk, (Stack_elem) counter);
+                }
+                else
+                {
+                    for (size_t counter = 0; counter < pop_ops / (size_t) poppers; ++counter)
+                        pop(stk, &val);
+                }
+            });
+        }
+    }
+
+    for (std::thread &thread : threads)
+        thread.join();
+
+    *elapsed_ns = bench_now_ns() - start;
+
+    if (threads_num == 1) return MT_OPS;
+
+    return (push_ops / (size_t) pushers) * (size_t) pushers + (pop_ops / (size_t) poppers) * (size_t) poppers;
+}
+
+/**
+*   @brief Next number of threads of the sweep: 1, 2, 4 .. and "max_threads" itself as the last step.
+*/
+
+static int bench_mt_next(const int threads_num, const int max_threads)
+{
+    return (threads_num < max_threads && 2 * threads_num > max_threads) ? max_threads : 2 * threads_num;
+}
+
+static void bench_mt(const int max_threads)
+{
+    char name[64] = "";
+
+    for (const MtMix &mix : MT_MIXES)
+    {
+        for (int threads_num = 1; threads_num <= max_threads; threads_num = bench_mt_next(threads_num, max_threads))
+        {
+            double elapsed = 0;
+
+            LockFreeStack lf_stk = {};
+            LockFreeStackCtor(&lf_stk);
+
+            for (size_t counter = 0; counter < MT_OPS; ++counter)
+                LockFreeStackPush(&lf_stk, (Stack_elem) counter);
+
+            size_t ops = bench_mt_run(&lf_stk, threads_num, mix.push_percent,
+                                      [] (LockFreeStack *stk, Stack_elem val) { LockFreeStackPush(stk, val); },
+                                      [] (LockFreeStack *stk, Stack_elem *val) { LockFreeStackPop(stk, val); },
+                                      &elapsed);
+
+            snprintf(name, sizeof(name), "lockfree_%s", mix.name);
+            bench_print_ops("mt", name, (size_t) threads_num, ops, elapsed);
+
+            LockFreeStackDtor(&lf_stk);
+
+            EliminationStack *el_stk = new EliminationStack();
+            EliminationStackCtor(el_stk);
+
+            for (size_t counter = 0; counter < MT_OPS; ++counter)
+                EliminationStackPush(el_stk, (Stack_elem) counter);
+
+            ops = bench_mt_run(el_stk, threads_num, mix.push_percent,
+                               [] (EliminationStack *stk, Stack_elem val) { EliminationStackPush(stk, val); },
+                               [] (EliminationStack *stk, Stack_elem *val) { EliminationStackPop(stk, val); },
+                               &elapsed);
+
+            snprintf(name, sizeof(name), "elimination_%s", mix.name);
+            bench_print_ops("mt", name, (size_t) threads_num, ops, elapsed);
+
+            EliminationStackDtor(el_stk);
+            delete el_stk;
+        }
+    }
+}
+
+/*-----------------------------------------------------SNAPSHOT-------------------------------------------------------*/
+
+/**
+*   @brief One operation is the branch of the backtracking search: the copy of the "SharedStack", 16 pushes and 16 pops
+*   @brief of the copy and its destructor. The time must not depend on the size of the original.
+*/
+
+static void bench_snapshot()
+{
+    for (size_t size = 1 << 10; size <= (1 << 20); size <<= 2)
+    {
+        SharedStack stk = {};
+        SharedStackCtor(&stk);
+
+        for (size_t counter = 0; counter < size; ++counter)
+            SharedStackPush(&stk, (Stack_elem) (counter % 128));
+
+        double elapsed = 0;
+
+        size_t ops = bench_repeat([&]
+        {
+            SharedStack copy = {};
+            SharedStackSnapshot(&copy, &stk);
+
+            for (int counter = 0; counter < 16; ++counter)
+                SharedStackPush(&copy, (Stack_elem) counter);
+
+            for (int counter = 0; counter < 16; ++counter)
+                SharedStackPop(&copy);
+
+            SharedStackDtor(&copy);
+        }, &elapsed);
+
+        bench_print_ops("snapshot", "shared", size, ops, elapsed);
+
+        SharedStackDtor(&stk);
+    }
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+int main(int argc, const char *argv[])
+{
+    BUDGET_NS = ((argc > 1) ? atof(argv[1]) : 100) * 1e6;
+
+    size_t max_size = ((argc > 2) ? (size_t) atol(argv[2]) : 1024) << 20;
+
+    int max_threads = (argc > 3) ? atoi(argv[3]) : (int) std::thread::hardware_concurrency();
+    if (max_threads < 1) max_threads = 1;
+
+    bench_poison(max_size);
+    bench_hash  (max_size);
+    bench_alloc (max_size);
+    bench_mt    (max_threads);
+
+    bench_snapshot();
+
+    return 0;
+}
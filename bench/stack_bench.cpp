@@ -0,0 +1,312 @@
+/** @file */
+
+/**
+*   @brief Microbenchmarks of "StackPush()", "StackPop()", "StackVerify()" and the capacity changes of "stack.h".
+*   @brief One binary is built for every combination of the modes and the element size by "make bench", the modes
+*   @brief come from the -D flags (STACK_MODES_EXTERNAL), the element size from BENCH_ELEM_SIZE.
+*
+*   @brief Every result is one JSON line:
+*   @brief   {"build": ..., "elem_size": ..., "depth": ..., "bench": ..., "ops": ..., "ns_per_op": ..., "ops_per_s": ...,
+*   @brief    "allocs": ..., "bytes_logged": ...}
+*   @brief "allocs" is the number of calls of the allocator during the benchmark, "bytes_logged" is the growth of the
+*   @brief log-file (0 without STACK_DUMPING).
+*
+*   @brief Usage: stack_bench [time budget of one benchmark in ms] [depth]...
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef BENCH_ELEM_SIZE
+    #define BENCH_ELEM_SIZE 8
+#endif
+
+typedef struct _Stack_elem
+{
+    unsigned char bytes[BENCH_ELEM_SIZE];
+
+} Stack_elem;
+
+#include "../src/stack.h"
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/**
+*   @brief Depths used if none is given in the command line.
+*/
+
+const size_t BENCH_DEPTHS[] = {16, 256, 4096};
+
+/**
+*   @brief Counters of the allocator wrapped by "COUNTING_ALLOCATOR".
+*
+*   @param   calls - number of alloc() and realloc() calls
+*   @param wrapped - allocator which does the work
+*/
+
+typedef struct _BenchAllocCounter
+{
+    size_t                calls;
+    const StackAllocator *wrapped;
+
+} BenchAllocCounter;
+
+static BenchAllocCounter ALLOC_COUNTER = {0, STACK_DEFAULT_ALLOCATOR};
+
+static void *counting_alloc(void *ctx, size_t size)
+{
+    BenchAllocCounter *counter = (BenchAllocCounter *) ctx;
+
+    ++counter->calls;
+    return counter->wrapped->alloc(counter->wrapped->ctx, size);
+}
+
+static void *counting_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size)
+{
+    BenchAllocCounter *counter = (BenchAllocCounter *) ctx;
+
+    ++counter->calls;
+    return counter->wrapped->realloc(counter->wrapped->ctx, ptr, old_size, new_size);
+}
+
+static void counting_free(void *ctx, void *ptr, size_t size)
+{
+    BenchAllocCounter *counter = (BenchAllocCounter *) ctx;
+
+    counter->wrapped->free(counter->wrapped->ctx, ptr, size);
+}
+
+static const StackAllocator COUNTING_ALLOCATOR = {counting_alloc, counting_realloc, counting_free, &ALLOC_COUNTER};
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/**
+*   @brief State of one benchmark: the time budget and the counters at the beginning.
+*/
+
+typedef struct _BenchRun
+{
+    const char *name;
+    size_t      depth;
+
+    double      budget_ns;
+
+    double      start_ns;
+    size_t      start_allocs;
+    long        start_logged;
+
+    size_t      ops;
+
+} BenchRun;
+
+static double bench_now_ns()
+{
+    struct timespec now = {};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (double) now.tv_sec * 1e9 + (double) now.tv_nsec;
+}
+
+static long bench_logged()
+{
+    #ifdef STACK_DUMPING
+
+        log_flush();
+        return ftell(LOG_STREAM);
+
+    #else
+
+        return 0;
+
+    #endif
+}
+
+static const char *bench_build_name()
+{
+    return
+        #ifdef STACK_DUMPING
+            "dump"
+        #else
+            "nodump"
+        #endif
+        #ifdef CANARY_PROTECTION
+            "+canary"
+        #endif
+        #ifdef HASH_PROTECTION
+            "+hash"
+        #endif
+        "";
+}
+
+static void bench_begin(BenchRun *run, const char *name, const size_t depth, const double budget_ns)
+{
+    run->name         = name;
+    run->depth        = depth;
+    run->budget_ns    = budget_ns;
+    run->ops          = 0;
+    run->start_logged = bench_logged();
+    run->start_allocs = ALLOC_COUNTER.calls;
+    run->start_ns     = bench_now_ns();
+}
+
+static bool bench_running(const BenchRun *run)
+{
+    // the clock is read once per 16 operations, so it doesn't dominate the fast builds
+    return run->ops == 0 || (run->ops % 16 != 0) || bench_now_ns() - run->start_ns < run->budget_ns;
+}
+
+static void bench_print(const char *name, const size_t depth, const size_t ops, const double elapsed_ns,
+                                                             const size_t allocs, const long logged)
+{
+    double ns = (ops != 0) ? elapsed_ns / (double) ops : 0;
+
+    printf("{\"build\": \"%s\", \"elem_size\": %d, \"depth\": %zu, \"bench\": \"%s\", \"ops\": %zu, "
+           "\"ns_per_op\": %.1f, \"ops_per_s\": %.0f, \"allocs\": %zu, \"bytes_logged\": %ld}\n",
+           bench_build_name(), BENCH_ELEM_SIZE, depth, name, ops, ns, (ns > 0) ? 1e9 / ns : 0, allocs, logged);
+}
+
+static void bench_end(BenchRun *run)
+{
+    bench_print(run->name, run->depth, run->ops, bench_now_ns() - run->start_ns,
+                ALLOC_COUNTER.calls - run->start_allocs, bench_logged() - run->start_logged);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/**
+*   @brief Fills the element by the byte which is not POISON_BYTE, so "StackVerify()" doesn't take it for poison.
+*/
+
+static Stack_elem bench_elem(const size_t counter)
+{
+    Stack_elem elem = {};
+    memset(elem.bytes, 0x10 + (int) (counter % 0x40), sizeof(elem.bytes));
+
+    return elem;
+}
+
+/**
+*   @brief Pushes "depth" elements to the empty "Stack" and pops them back until the budget ends.
+*   @brief The first half measures "StackPush()" with the growth, the second one "StackPop()" with the shrink.
+*/
+
+static void bench_push_pop(const size_t depth, const double budget_ns)
+{
+    Stack stk = {};
+    StackCtorAlloc(&stk, 0, &COUNTING_ALLOCATOR);
+
+    BenchRun push = {}, pop = {};
+    double   push_ns = 0, pop_ns = 0;
+    size_t   push_ops = 0, pop_ops = 0, push_allocs = 0, pop_allocs = 0;
+    long     push_logged = 0, pop_logged = 0;
+
+    do
+    {
+        bench_begin(&push, "push", depth, budget_ns);
+
+        for (size_t counter = 0; counter < depth; ++counter, ++push.ops)
+            StackPush(&stk, bench_elem(counter));
+
+        push_ns     += bench_now_ns() - push.start_ns;
+        push_ops    += push.ops;
+        push_allocs += ALLOC_COUNTER.calls - push.start_allocs;
+        push_logged += bench_logged() - push.start_logged;
+
+        bench_begin(&pop, "pop", depth, budget_ns);
+
+        for (size_t counter = 0; counter < depth; ++counter, ++pop.ops)
+            StackPop(&stk);
+
+        pop_ns     += bench_now_ns() - pop.start_ns;
+        pop_ops    += pop.ops;
+        pop_allocs += ALLOC_COUNTER.calls - pop.start_allocs;
+        pop_logged += bench_logged() - pop.start_logged;
+    }
+    while (push_ns < budget_ns && pop_ns < budget_ns);
+
+    StackDtor(&stk);
+
+    bench_print("push", depth, push_ops, push_ns, push_allocs, push_logged);
+    bench_print("pop",  depth, pop_ops,  pop_ns,  pop_allocs,  pop_logged);
+}
+
+/**
+*   @brief Calls "StackVerify()" of the "Stack" of "depth" elements until the budget ends.
+*/
+
+static void bench_verify(const size_t depth, const double budget_ns)
+{
+    Stack stk = {};
+    StackCtorAlloc(&stk, 0, &COUNTING_ALLOCATOR);
+
+    for (size_t counter = 0; counter < depth; ++counter)
+        StackPush(&stk, bench_elem(counter));
+
+    BenchRun run = {};
+
+    for (bench_begin(&run, "verify", depth, budget_ns); bench_running(&run); ++run.ops)
+        StackVerify(&stk);
+
+    bench_end(&run);
+
+    StackDtor(&stk);
+}
+
+/**
+*   @brief Doubles the capacity of the "Stack" of "depth" elements by "StackReserve()" and shrinks it back by
+*   @brief "StackShrinkToFit()" until the budget ends. Every call is one operation, so it is the cost of "StackResize()"
+*   @brief which "StackRealloc()" does on the growth and the shrink.
+*/
+
+static void bench_realloc(const size_t depth, const double budget_ns)
+{
+    Stack stk = {};
+    StackCtorAlloc(&stk, 0, &COUNTING_ALLOCATOR);
+
+    for (size_t counter = 0; counter < depth; ++counter)
+        StackPush(&stk, bench_elem(counter));
+
+    BenchRun run = {};
+
+    for (bench_begin(&run, "realloc", depth, budget_ns); bench_running(&run); run.ops += 2)
+    {
+        StackReserve    (&stk, 2 * depth);
+        StackShrinkToFit(&stk);
+    }
+
+    bench_end(&run);
+
+    StackDtor(&stk);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+int main(int argc, const char *argv[])
+{
+    double budget_ns = ((argc > 1) ? atof(argv[1]) : 100) * 1e6;
+
+    size_t        depths_num = (argc > 2) ? (size_t) (argc - 2) : sizeof(BENCH_DEPTHS) / sizeof(BENCH_DEPTHS[0]);
+    const size_t *depths     = BENCH_DEPTHS;
+
+    size_t *arg_depths = (size_t *) calloc(depths_num, sizeof(size_t));
+
+    if (argc > 2)
+    {
+        for (size_t counter = 0; counter < depths_num; ++counter)
+            arg_depths[counter] = (size_t) atol(argv[counter + 2]);
+
+        depths = arg_depths;
+    }
+
+    for (size_t counter = 0; counter < depths_num; ++counter)
+    {
+        bench_push_pop(depths[counter], budget_ns);
+        bench_verify  (depths[counter], budget_ns);
+        bench_realloc (depths[counter], budget_ns);
+    }
+
+    free(arg_depths);
+    return 0;
+}
@@ -0,0 +1,309 @@
+/** @file */
+
+#ifndef LOG_MMAP_H
+#define LOG_MMAP_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/**
+*   @brief Log-file backend which writes into the memory-mapped region of the file (LOG_MMAP mode of "stack.h").
+*
+*   @brief An append is a memcpy() into the mapping, the file is extended by LOG_MMAP_CHUNK bytes at a time, so
+*   @brief there are a few syscalls per chunk instead of one per line. The not yet written part of the chunk is filled
+*   @brief by spaces and the closing tags always follow the written text, so the file is the valid HTML document
+*   @brief even if the process crashes in the middle.
+*
+*   @brief When the text reaches "rotate_size" bytes, the file is closed at the end of the current line and renamed:
+*   @brief log.html -> log.1.html -> log.2.html -> ... -> log.<keep>.html, the oldest one is removed. Every file
+*   @brief has its own head and tail, so every one opens in a browser alone.
+*/
+
+const size_t LOG_MMAP_CHUNK = 1 << 20;
+
+const char LOG_MMAP_HEAD[] = "<!DOCTYPE html>\n<html>\n<head><meta charset=\"utf-8\"><title>Stack log</title></head>\n"
+                             "<body>\n<pre>\n";
+const char LOG_MMAP_TAIL[] = "</pre>\n</body>\n</html>\n";
+
+/**
+*   @brief State of the memory-mapped log-file.
+*
+*   @param   file_name - name of the current file, the rotated ones get the number before the extension
+*   @param rotate_size - size (in bytes) of the text after which the file is rotated
+*   @param        keep - number of the rotated files which are kept
+*   @param          fd - descriptor of the current file
+*   @param         map - mapping of the current file
+*   @param    map_size - size of the mapping, it may exceed the file
+*   @param   file_size - size of the file, the bytes after "used" are the tail and spaces
+*   @param        used - number of written bytes (the head included)
+*   @param        lock - mutex which orders the appends of the threads
+*/
+
+typedef struct _LogMmap
+{
+    const char *file_name;
+    size_t      rotate_size;
+    int         keep;
+
+    int         fd;
+    char       *map;
+    size_t      map_size;
+    size_t      file_size;
+    size_t      used;
+
+    pthread_mutex_t lock;
+
+} LogMmap;
+
+/**
+*   @brief Puts the name of the rotated file number "number" in "name" ("log.html" -> "log.<number>.html").
+*/
+
+static void log_mmap_name(const LogMmap *log, const int number, char *name, const size_t name_size)
+{
+    const char *ext = strrchr(log->file_name, '.');
+    int         len = (ext != nullptr) ? (int) (ext - log->file_name) : (int) strlen(log->file_name);
+
+    snprintf(name, name_size, "%.*s.%d%s", len, log->file_name, number, (ext != nullptr) ? ext : "");
+}
+
+/**
+*   @brief Makes the file big enough for "size" bytes of text and the tail. The added part is spaces.
+*
+*   @return 1 if it is OK, 0 if the file can't be extended
+*/
+
+static int log_mmap_reserve(LogMmap *log, const size_t size)
+{
+    size_t needed = size + sizeof(LOG_MMAP_TAIL) - 1;
+
+    if (needed <= log->file_size)
+        return 1;
+
+    size_t new_size = (needed + LOG_MMAP_CHUNK - 1) / LOG_MMAP_CHUNK * LOG_MMAP_CHUNK;
+
+    if (new_size > log->map_size)
+    {
+        // only a line longer than LOG_MMAP_CHUNK after "rotate_size" gets here
+        munmap(log->map, log->map_size);
+
+        void *new_map = mmap(nullptr, 2 * new_size, PROT_READ | PROT_WRITE, MAP_SHARED, log->fd, 0);
+        if (new_map == MAP_FAILED)
+        {
+            log->map = nullptr;
+            return 0;
+        }
+
+        log->map      = (char *) new_map;
+        log->map_size = 2 * new_size;
+    }
+
+    // the file grows by write() of spaces, not by ftruncate() and memset(): a crash between them leaves zeros
+    static char spaces[1 << 16] = "";
+    if (spaces[0] != ' ')
+        memset(spaces, ' ', sizeof(spaces));
+
+    while (log->file_size < new_size)
+    {
+        size_t  part    = (new_size - log->file_size < sizeof(spaces)) ? new_size - log->file_size : sizeof(spaces);
+        ssize_t written = pwrite(log->fd, spaces, part, (off_t) log->file_size);
+
+        if (written <= 0)
+            return 0;
+
+        log->file_size += (size_t) written;
+    }
+
+    return 1;
+}
+
+/**
+*   @brief Appends "len" bytes to the current file and moves the tail after them.
+*/
+
+static void log_mmap_append(LogMmap *log, const char *buf, const size_t len)
+{
+    if (!log_mmap_reserve(log, log->used + len))
+        return;
+
+    // the new tail goes first, so the text which overwrites the old one is always followed by some tail
+    memcpy(log->map + log->used + len, LOG_MMAP_TAIL, sizeof(LOG_MMAP_TAIL) - 1);
+    memcpy(log->map + log->used, buf, len);
+
+    log->used += len;
+}
+
+static int log_mmap_open_file(LogMmap *log)
+{
+    log->fd = open(log->file_name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (log->fd < 0)
+        return 0;
+
+    log->map_size  = log->rotate_size + LOG_MMAP_CHUNK;
+    log->file_size = 0;
+    log->used      = 0;
+
+    log->map = (char *) mmap(nullptr, log->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, log->fd, 0);
+
+    if (log->map == (char *) MAP_FAILED)
+    {
+        close(log->fd);
+
+        log->fd  = -1;
+        log->map = nullptr;
+        return 0;
+    }
+
+    log_mmap_append(log, LOG_MMAP_HEAD, sizeof(LOG_MMAP_HEAD) - 1);
+    return 1;
+}
+
+/**
+*   @brief Cuts the spaces after the tail and unmaps the current file.
+*/
+
+static void log_mmap_close_file(LogMmap *log)
+{
+    if (log->fd < 0)
+        return;
+
+    if (log->map != nullptr)
+        munmap(log->map, log->map_size);
+
+    if (ftruncate(log->fd, (off_t) (log->used + sizeof(LOG_MMAP_TAIL) - 1)) != 0)
+        perror("log_mmap");
+
+    close(log->fd);
+
+    log->fd  = -1;
+    log->map = nullptr;
+}
+
+/**
+*   @brief Closes the current file, shifts the numbers of the rotated files and opens the new current file.
+*/
+
+static void log_mmap_rotate(LogMmap *log)
+{
+    log_mmap_close_file(log);
+
+    char old_name[FILENAME_MAX] = "";
+    char new_name[FILENAME_MAX] = "";
+
+    if (log->keep <= 0)
+        remove(log->file_name);
+
+    else
+    {
+        log_mmap_name(log, log->keep, old_name, sizeof(old_name));
+        remove(old_name);
+
+        for (int number = log->keep - 1; number >= 1; --number)
+        {
+            log_mmap_name(log, number,     old_name, sizeof(old_name));
+            log_mmap_name(log, number + 1, new_name, sizeof(new_name));
+
+            rename(old_name, new_name);
+        }
+
+        log_mmap_name(log, 1, new_name, sizeof(new_name));
+        rename(log->file_name, new_name);
+    }
+
+    log_mmap_open_file(log);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/**
+*   @brief Creates the current file and maps it.
+*
+*   @param         log [out]         log - pointer to the state
+*   @param   file_name [in]    file_name - name of the current file
+*   @param rotate_size [in]  rotate_size - size (in bytes) of the text after which the file is rotated
+*   @param        keep [in]         keep - number of the rotated files which are kept
+*
+*   @return 1 if opening is OK, 0 else
+*/
+
+static int log_mmap_open(LogMmap *log, const char *file_name, const size_t rotate_size, const int keep)
+{
+    assert(log       != nullptr);
+    assert(file_name != nullptr);
+
+    log->file_name   = file_name;
+    log->rotate_size = (rotate_size > LOG_MMAP_CHUNK) ? rotate_size : LOG_MMAP_CHUNK;
+    log->keep        = keep;
+
+    pthread_mutex_init(&log->lock, nullptr);
+
+    return log_mmap_open_file(log);
+}
+
+/**
+*   @brief Appends "len" bytes from "buf" to the log. If they reach "rotate_size", the file is rotated after
+*   @brief the line which crosses it, so every file begins from the beginning of a line.
+*
+*   @param log [in][out] log - pointer to the state
+*   @param buf [in]      buf - pointer to the first byte to write
+*   @param len [in]      len - number of bytes to write
+*
+*   @return nothing
+*/
+
+static void log_mmap_write(LogMmap *log, const char *buf, size_t len)
+{
+    assert(log != nullptr);
+
+    pthread_mutex_lock(&log->lock);
+
+    while (len > 0 && log->map != nullptr)
+    {
+        size_t room = (log->used < log->rotate_size) ? log->rotate_size - log->used : 0;
+
+        if (len <= room)
+        {
+            log_mmap_append(log, buf, len);
+            break;
+        }
+
+        size_t      from = (room > 0) ? room - 1 : 0;
+        const char *eol  = (const char *) memchr(buf + from, '\n', len - from);
+        size_t      line = (eol != nullptr) ? (size_t) (eol - buf) + 1 : len;
+
+        log_mmap_append(log, buf, line);
+
+        if (eol != nullptr)
+            log_mmap_rotate(log);
+
+        buf += line;
+        len -= line;
+    }
+
+    pthread_mutex_unlock(&log->lock);
+}
+
+/**
+*   @brief Cuts the current file after the tail and unmaps it.
+*
+*   @return nothing
+*/
+
+static void log_mmap_close(LogMmap *log)
+{
+    assert(log != nullptr);
+
+    pthread_mutex_lock(&log->lock);
+
+    log_mmap_close_file(log);
+
+    pthread_mutex_unlock(&log->lock);
+}
+
+#endif //LOG_MMAP_H
@@ -2,32 +2,22 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <string.h>
+#include <stdint.h>
 
-#include "../lib/var_declaration.h"
-
-struct Stack
-{
-    void *data;
-
-    int elem_size;
-    int data_size;
-    int data_capacity;
-
-    bool is_ctor;
-
-    var_declaration var_info;
-};
+#include "stack_generic.h"
 
 const Stack default_Stack =
 {
     nullptr, // data
 
           0, // elem_size
-          1, // data_size
+          0, // data_size
           4, // data_capacity
 
        true, // is_ctor
 
+    nullptr, // elem_copy
+
     {
     nullptr,
     nullptr,
@@ -36,7 +26,7 @@ const Stack default_Stack =
     }        // var_info
 };
 
-const Stack *poison_Stack =
+const Stack poison_Stack =
 {
     nullptr, // data
 
@@ -46,6 +36,8 @@ const Stack *poison_Stack =
 
       false, // is_ctor
 
+    nullptr, // elem_copy
+
     {
     nullptr,
     nullptr,
@@ -55,25 +47,41 @@ const Stack *poison_Stack =
 
 };
 
-enum STACK_ERRORS
-{
-    OK                      ,
+/*___________________________ELEMENT_COPY_ROUTINES__________________________*/
 
-    NULLPTR_STACK           ,
-    NULLPTR_STACK_INFO      ,
+// memcpy() with the constant size is compiled into one or two moves, so common sizes don't pay for the generic copy
+
+static void elem_copy_1 (void *dest, const void *src, const int) { memcpy(dest, src,  1); }
+static void elem_copy_2 (void *dest, const void *src, const int) { memcpy(dest, src,  2); }
+static void elem_copy_4 (void *dest, const void *src, const int) { memcpy(dest, src,  4); }
+static void elem_copy_8 (void *dest, const void *src, const int) { memcpy(dest, src,  8); }
+static void elem_copy_16(void *dest, const void *src, const int) { memcpy(dest, src, 16); }
+
+static void elem_copy_generic(void *dest, const void *src, const int elem_size)
+{
+    memcpy(dest, src, (size_t) elem_size);
+}
 
-    ALREADY_CTORED          ,
-    NOT_YET_CTORED          ,
+static elem_copy_t get_elem_copy(const int elem_size)
+{
+    switch (elem_size)
+    {
+        case  1: return elem_copy_1;
+        case  2: return elem_copy_2;
+        case  4: return elem_copy_4;
+        case  8: return elem_copy_8;
+        case 16: return elem_copy_16;
 
-    NEGATIVE_ELEM_SIZE      ,
-    NEGATIVE_DATA_SIZE      ,
-    NEGATIVE_DATA_CAPCITY   ,
+        default: return elem_copy_generic;
+    }
+}
 
-    INVALID_CAPACITY        ,
-    INVALID_DATA            ,
+static inline char *elem_ptr(const Stack *const stk, const int index)
+{
+    return (char *) stk->data + (size_t) index * (size_t) stk->elem_size;
+}
 
-    MEMORY_LIMIT_EXCEEDED   ,
-};
+/*__________________________________________________________________________*/
 
 unsigned int Stack_verify(Stack *const stk)
 {
@@ -82,49 +90,107 @@ unsigned int Stack_verify(Stack *const stk)
 
     unsigned int err = 0;
 
-    if (stk->var_info       == nullptr      ) err = err | (1 << NULLPTR_STACK_INFO   );
+    if (stk->var_info.name_var == nullptr) err = err | (1 << NULLPTR_STACK_INFO   );
 
-    if (stk->elem_size      <              0) err = err | (1 << NEGATIVE_ELEM_SIZE   );
+    if (stk->elem_size      <=             0) err = err | (1 << NEGATIVE_ELEM_SIZE   );
     if (stk->data_size      <              0) err = err | (1 << NEGATIVE_DATA_SIZE   );
     if (stk->data_capacity  <              0) err = err | (1 << NEGATIVE_DATA_CAPCITY);
 
     if (stk->data_capacity  < stk->data_size) err = err | (1 << INVALID_CAPACITY     );
     if (stk->data           == nullptr      ) err = err | (1 << INVALID_DATA         );
+    if (stk->elem_copy      == nullptr      ) err = err | (1 << INVALID_DATA         );
 
     return err;
 }
 
-int  Stack_ctor(Stack *const stk, const int elem_size,  const char *file,
-                                                        const char *func,
-                                                        const char *name,
-                                                        const int   line)
+unsigned int Stack_ctor(Stack *const stk, const int elem_size,  const char *file,
+                                                                const char *func,
+                                                                const char *name,
+                                                                const int   line)
 {
     assert(file);
     assert(func);
     assert(name);
 
+    if (stk          == nullptr) return (1 << NULLPTR_STACK     );
+    if (stk->is_ctor == true   ) return (1 << ALREADY_CTORED    );
+    if (elem_size    <= 0      ) return (1 << NEGATIVE_ELEM_SIZE);
+
    *stk            = default_Stack;
     stk->elem_size = elem_size;
-    stk->data      = calloc(stk->data_capacity * elem_size);
+    stk->elem_copy = get_elem_copy(elem_size);
+    stk->data      = calloc((size_t) stk->data_capacity, (size_t) elem_size);
 
-    var_ctor(stk->var_info, file, func, name, line);
+    var_ctor(&stk->var_info, file, func, name, (unsigned int) line);
+
+    if (stk->data == nullptr) return (1 << MEMORY_LIMIT_EXCEEDED);
+
+    return Stack_verify(stk);
 }
 
-void Stack_dtor(Stack *const stk)
+unsigned int Stack_dtor(Stack *const stk)
 {
+    unsigned int err = Stack_verify(stk);
+    if (err & ((1 << NULLPTR_STACK) | (1 << NOT_YET_CTORED))) return err;
+
     free(stk->data);
 
     *stk = poison_Stack;
     var_dtor(&stk->var_info);
+
+    return err;
 }
 
-void Stack_realloc(Stack *const stk)
+/**
+*   @brief Doubles the capacity if "Stack" is full and halves it if "Stack" is filled by a quarter.
+*
+*   @return bit-mask which encodes the errors from "enum STACK_ERRORS"
+*/
+static unsigned int Stack_realloc(Stack *const stk)
 {
-    if (stk->data_size == stk->data_capacity)
-    {
-        int future_capacity = 2 * data_capacity;
+    int future_capacity = stk->data_capacity;
 
-        void *temp_data = realloc(stk->data, future_capacity * stk->elem_size);
-        if   (temp_data == nullptr) return
-    }
-}
\ No newline at end of file
+    if      (stk->data_size == stk->data_capacity)                             future_capacity = 2 * stk->data_capacity;
+    else if (stk->data_capacity > 4 && 4 * stk->data_size <= stk->data_capacity) future_capacity = stk->data_capacity / 2;
+
+    if (future_capacity == stk->data_capacity) return OK;
+
+    void *temp_data = realloc(stk->data, (size_t) future_capacity * (size_t) stk->elem_size);
+    if   (temp_data == nullptr) return (1 << MEMORY_LIMIT_EXCEEDED);
+
+    stk->data          = temp_data;
+    stk->data_capacity = future_capacity;
+
+    return OK;
+}
+
+unsigned int Stack_push(Stack *const stk, const void *push_val)
+{
+    unsigned int err = Stack_verify(stk);
+    if (err) return err;
+
+    assert(push_val);
+
+    err = Stack_realloc(stk);
+    if (err) return err;
+
+    stk->elem_copy(elem_ptr(stk, stk->data_size), push_val, stk->elem_size);
+    ++stk->data_size;
+
+    return OK;
+}
+
+unsigned int Stack_pop(Stack *const stk, void *front_val)
+{
+    unsigned int err = Stack_verify(stk);
+    if (err) return err;
+
+    if (stk->data_size == 0) return (1 << EMPTY_STACK);
+
+    --stk->data_size;
+
+    if (front_val != nullptr)
+        stk->elem_copy(front_val, elem_ptr(stk, stk->data_size), stk->elem_size);
+
+    return Stack_realloc(stk);
+}
@@ -3,15 +3,97 @@
 #ifndef STACK_H
 #define STACK_H
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 #include <inttypes.h>
 #include <stdarg.h>
 
+#ifndef STACK_MODES_EXTERNAL // the build passes the modes by -D flags instead (see the "bench" target of Makefile)
+
 #define  STACK_DUMPING
 #define CANARY_PROTECTION
+//#define  GUARD_PROTECTION
+//#define  GUARD_INACTIVE
+//#define   POISON_WATERMARK
 #define   HASH_PROTECTION
+#define   HASH_INCREMENTAL
+//#define   HASH_CRC32C
+//#define   HASH_MUL64
+//#define   LOG_ASYNC
+//#define   LOG_TRACE
+//#define   LOG_MMAP
+//#define   POOL_ALLOCATOR
+//#define   STACK_STATS
+//#define   STACK_LATENCY
+//#define   FLIGHT_RECORDER
+//#define   STACK_PERSISTENT
+
+#endif
+
+#ifndef HASH_PROTECTION
+    #undef HASH_INCREMENTAL  // nothing to update
+#endif
+
+#ifdef LOG_TRACE
+    #undef LOG_ASYNC // trace writer has its own buffer
+    #undef LOG_MMAP
+#endif
+
+#ifdef LOG_MMAP
+    #undef LOG_ASYNC // appends to the mapping make no syscalls, there is nothing to move to the background
+#endif
+
+#if defined(HASH_CRC32C) || defined(HASH_MUL64)
+    #undef HASH_INCREMENTAL  // incremental update needs the byte polynomial of djb2
+#endif
+
+#ifdef LOG_ASYNC
+    #include <pthread.h>
+#endif
+
+#ifdef STACK_STATS
+    #include <time.h>
+#endif
+
+#if defined(STACK_DUMPING) || defined(FLIGHT_RECORDER)
+    #define STACK_ERROR_DUMP // "StackDump()" writes the found errors in the log-file
+#endif
+
+#if defined(STACK_PERSISTENT) && (defined(GUARD_PROTECTION) || !defined(__unix__))
+    #undef STACK_PERSISTENT  // the store is the shared mapping of the file, it can't be the block between guard pages
+#endif
+
+#ifdef GUARD_PROTECTION
+    #undef CANARY_PROTECTION // guard pages replace the canaries
+    #include <signal.h>
+#else
+    #undef GUARD_INACTIVE    // write protection of non active elements needs the guard allocator
+#endif
+
+#include "stack_common.h"
+#include "stack_alloc.h"
+#include "stack_poison.h"
+#include "stack_hash.h"
+#include "stack_file.h"
+#include "trace.h"
+
+#ifdef LOG_MMAP
+    #include "log_mmap.h"
+#endif
+
+#ifdef STACK_LATENCY
+    #include "stack_latency.h"
+#endif
+
+#ifdef FLIGHT_RECORDER
+    #include "stack_flight.h"
+#endif
+
+#ifdef STACK_PERSISTENT
+    #include "stack_persist.h"
+#endif
 
 #ifdef STACK_DUMPING
 
@@ -33,6 +115,268 @@
 
 #endif
 
+/**
+*   @brief Allocator of the elements store used by "StackCtor()". "StackCtorAlloc()" chooses another one for the "Stack".
+*   @brief It is the system allocator, and the pool one in POOL_ALLOCATOR mode.
+*/
+
+#ifdef POOL_ALLOCATOR
+
+    const StackAllocator *STACK_DEFAULT_ALLOCATOR = &STACK_POOL_ALLOCATOR;
+
+#else
+
+    const StackAllocator *STACK_DEFAULT_ALLOCATOR = &STACK_SYSTEM_ALLOCATOR;
+
+#endif
+
+/**
+*   @brief Modes of this build which are written in the snapshot by "StackSave()" (see "stack_file.h").
+*/
+
+const uint32_t STACK_FILE_FLAGS =
+    #ifdef CANARY_PROTECTION
+        STACK_FILE_CANARY    |
+    #endif
+    #ifdef HASH_PROTECTION
+        STACK_FILE_HASH      |
+    #endif
+    #ifdef HASH_CRC32C
+        STACK_FILE_CRC32C    |
+    #endif
+    #ifdef HASH_MUL64
+        STACK_FILE_MUL64     |
+    #endif
+    #ifdef POISON_WATERMARK
+        STACK_FILE_WATERMARK |
+    #endif
+        0;
+
+/**
+*   @brief The enum contains levels of "StackVerify()".
+*
+*   @param VERIFY_FULL    - every call checks the metadata, all elements, canaries and hash
+*   @param VERIFY_META    - every call checks only the metadata (size, capacity) and canaries
+*   @param VERIFY_SAMPLED - every "verify_param"-th call is VERIFY_FULL, the others are VERIFY_META
+*   @param VERIFY_WINDOW  - every call is VERIFY_META plus check of the next "verify_param" elements of the rolling window,
+*                           hash is checked when the window passes the whole "Stack.data"
+*/
+
+typedef enum _VerifyMode
+{
+    VERIFY_FULL    = 0,
+    VERIFY_META    = 1,
+    VERIFY_SAMPLED = 2,
+    VERIFY_WINDOW  = 3
+
+} VerifyMode;
+
+/**
+*   @brief Strategy of the "Stack" capacity changes used by "StackRealloc()".
+*
+*   @param grow_percent - capacity of the full "Stack" is multiplied by grow_percent / 100 (at least by one element)
+*   @param    shrink_at - capacity is decreased when it is not less than shrink_at * size, 0 disables the shrinking
+*   @param    shrink_to - capacity after the shrinking is shrink_to * size, the gap between "shrink_at" and "shrink_to"
+*                         is the hysteresis window: the "Stack" oscillating around one size doesn't realloc every time
+*   @param min_capacity - capacity is never decreased below it
+*   @param max_capacity - capacity is never increased above it, 0 means no limit
+*/
+
+typedef struct _StackGrowth
+{
+    size_t grow_percent;
+    size_t shrink_at;
+    size_t shrink_to;
+    size_t min_capacity;
+    size_t max_capacity;
+
+} StackGrowth;
+
+/**
+*   @brief Growth strategy set by "StackCtor()". "StackSetGrowth()" changes it for the "Stack".
+*/
+
+StackGrowth STACK_DEFAULT_GROWTH = {200, 4, 2, 4, 0};
+
+#ifdef STACK_STATS
+
+    /**
+    *   @brief Counters of the "Stack" usage (only in STACK_STATS mode), "StackGetStats()" returns them.
+    *
+    *   @param        pushes - number of pushed elements
+    *   @param          pops - number of popped elements
+    *   @param   reallocs_up - number of capacity growths
+    *   @param reallocs_down - number of capacity shrinks
+    *   @param realloc_bytes - bytes of the store kept by the reallocations (the allocator copies at most them)
+    *   @param      max_size - high-water mark of "Stack.size"
+    *   @param      verifies - number of "StackVerify()" calls
+    *   @param     verify_ns - total time of "StackVerify()" calls
+    *   @param  verify_fails - number of "StackVerify()" calls which found errors
+    *   @param hash_recounts - number of hash counts over the whole store
+    */
+
+    typedef struct _StackStats
+    {
+        size_t pushes;
+        size_t pops;
+
+        size_t reallocs_up;
+        size_t reallocs_down;
+        size_t realloc_bytes;
+
+        size_t max_size;
+
+        size_t             verifies;
+        unsigned long long verify_ns;
+        size_t             verify_fails;
+
+        size_t hash_recounts;
+
+    } StackStats;
+
+    #define STACK_STATS_ADD(stk, counter, val) ((stk)->stats.counter += (val))
+
+    #define STACK_STATS_PUSHED(stk, num)                                                                \
+            ((stk)->stats.pushes  += (num),                                                             \
+             (stk)->stats.max_size = ((stk)->size > (stk)->stats.max_size) ? (stk)->size : (stk)->stats.max_size)
+
+#else
+
+    #define STACK_STATS_ADD(stk, counter, val) ((void) 0)
+    #define STACK_STATS_PUSHED(stk, num)       ((void) 0)
+
+#endif
+
+#ifdef STACK_LATENCY
+
+    /**
+    *   @brief Operations whose latencies are recorded in STACK_LATENCY mode.
+    *
+    *   @param LATENCY_PUSH   - "StackPush()"
+    *   @param LATENCY_POP    - "StackPop()"
+    *   @param LATENCY_PUSH_N - "StackPushN()"
+    *   @param LATENCY_POP_N  - "StackPopN()"
+    *   @param LATENCY_VERIFY - "StackVerify()", also the one called inside the other operations
+    *   @param LATENCY_RESIZE - "StackResize()", the capacity change inside the other operations
+    */
+
+    typedef enum _StackLatencyOp
+    {
+        LATENCY_PUSH   = 0,
+        LATENCY_POP    = 1,
+        LATENCY_PUSH_N = 2,
+        LATENCY_POP_N  = 3,
+        LATENCY_VERIFY = 4,
+        LATENCY_RESIZE = 5,
+
+        LATENCY_OPS_NUM
+
+    } StackLatencyOp;
+
+    /**
+    *   @brief Names of the operations in "StackLatencyPrint()", index is the value of "enum _StackLatencyOp".
+    */
+
+    const char *LATENCY_OP_NAMES[LATENCY_OPS_NUM] = {"push", "pop", "push_n", "pop_n", "verify", "resize"};
+
+    /**
+    *   @brief Latency histograms of the "Stack" operations (only in STACK_LATENCY mode), one per "enum _StackLatencyOp".
+    */
+
+    typedef struct _StackLatency
+    {
+        LatencyHist ops[LATENCY_OPS_NUM];
+
+    } StackLatency;
+
+    #define STACK_LATENCY_START()         const uint64_t latency_start = latency_ticks()
+    #define STACK_LATENCY_RECORD(stk, op) latency_record(&(stk)->latency.ops[op], latency_ticks() - latency_start)
+
+#else
+
+    #define STACK_LATENCY_START()         ((void) 0)
+    #define STACK_LATENCY_RECORD(stk, op) ((void) 0)
+
+#endif
+
+#ifdef FLIGHT_RECORDER
+
+    /**
+    *   @brief Operations which are recorded in FLIGHT_RECORDER mode, "arg" of the record is in the brackets.
+    *
+    *   @param FLIGHT_CTOR      - "StackCtor()"        (capacity)
+    *   @param FLIGHT_PUSH      - "StackPush()"        (first 8 bytes of the pushed value)
+    *   @param FLIGHT_POP       - "StackPop()"         (0)
+    *   @param FLIGHT_PUSH_N    - "StackPushN()"       (number of elements)
+    *   @param FLIGHT_POP_N     - "StackPopN()"        (number of elements)
+    *   @param FLIGHT_RESERVE   - "StackReserve()"     (capacity)
+    *   @param FLIGHT_SHRINK    - "StackShrinkToFit()" (0)
+    *   @param FLIGHT_DTOR      - "StackDtor()"        (0)
+    *   @param FLIGHT_SAVE      - "StackSave()"        (0)
+    *   @param FLIGHT_LOAD      - "StackLoad()"        (0)
+    *   @param FLIGHT_OPEN      - "StackPersistOpen()" of the existing file (0)
+    */
+
+    typedef enum _StackFlightOp
+    {
+        FLIGHT_CTOR    = 0,
+        FLIGHT_PUSH    = 1,
+        FLIGHT_POP     = 2,
+        FLIGHT_PUSH_N  = 3,
+        FLIGHT_POP_N   = 4,
+        FLIGHT_RESERVE = 5,
+        FLIGHT_SHRINK  = 6,
+        FLIGHT_DTOR    = 7,
+        FLIGHT_SAVE    = 8,
+        FLIGHT_LOAD    = 9,
+        FLIGHT_OPEN    = 10,
+
+        FLIGHT_OPS_NUM
+
+    } StackFlightOp;
+
+    /**
+    *   @brief Names of the operations in the dump of the flight recorder, index is the value of "enum _StackFlightOp".
+    */
+
+    const char *FLIGHT_OP_NAMES[FLIGHT_OPS_NUM] = {"ctor", "push", "pop", "push_n", "pop_n", "reserve", "shrink", "dtor",
+                                                   "save", "load", "open"};
+
+    /**
+    *   @brief Returns the first 8 bytes of "elem" (all bytes if "Stack_elem" is shorter) as the argument of the record.
+    */
+
+    static inline uint64_t flight_elem_arg(const Stack_elem *elem)
+    {
+        uint64_t arg = 0;
+        memcpy(&arg, elem, (sizeof(Stack_elem) < sizeof(arg)) ? sizeof(Stack_elem) : sizeof(arg));
+
+        return arg;
+    }
+
+    #define STACK_FLIGHT_BEGIN(stk, op, arg)                                                            \
+            (((stk) != nullptr) ? flight_begin(&(stk)->flight, op, (uint64_t) (arg),                     \
+                                               (stk)->size, (stk)->capacity) : (void) 0)
+
+    #define STACK_FLIGHT_END(stk) flight_end(&(stk)->flight, (stk)->size, (stk)->capacity)
+
+#else
+
+    #define STACK_FLIGHT_BEGIN(stk, op, arg) ((void) 0)
+    #define STACK_FLIGHT_END(stk)            ((void) 0)
+
+#endif
+
+#ifdef STACK_PERSISTENT
+
+    #define STACK_PERSIST_COMMIT(stk) (((stk)->persist != nullptr) ? StackPersistCommit(stk) : (void) 0)
+
+#else
+
+    #define STACK_PERSIST_COMMIT(stk) ((void) 0)
+
+#endif
+
 /**
 *   @brief Data structure, which stores the ordered subsequence of "Stack_elem"-type elements,
 *   @brief organaized according to the LIFO principle.
@@ -45,7 +389,25 @@
 *   @param     size - number of elements in the "Stack"
 *   @param capacity - number of "Stack" elements which may be fit in allocated memory
 *   @param  is_Ctor - marker if "Stack" already constructed
+*   @param hash_val - hash of the "Stack" elements store (only in HASH_PROTECTION mode)
+*   @param hash_pow - weight of the first element after the top of "Stack" in the "hash_val" (only in HASH_INCREMENTAL mode)
 *   @param     info - struct which contains information about "Stack" variable declaration (only in STACK_DUMPING mode)
+*   @param allocator - allocator of the elements store (see "stack_alloc.h")
+*   @param    growth - strategy of the capacity changes
+*   @param  reserved - capacity requested by "StackReserve()", "StackRealloc()" doesn't shrink below it
+*   @param guard_writable - end of the writable prefix of "Stack.data", the rest is read-only (only in GUARD_INACTIVE mode)
+*   @param       poisoned - number of elements which were ever poisoned or pushed since the allocation, the elements after
+*                           them are not touched, so their pages stay uncommitted (only in POISON_WATERMARK mode)
+*
+*   @param    verify_mode - level of "StackVerify()"
+*   @param   verify_param - period in VERIFY_SAMPLED mode and number of elements in VERIFY_WINDOW mode
+*   @param verify_counter - number of "StackVerify()" calls
+*   @param  verify_cursor - index of the rolling window beginning in VERIFY_WINDOW mode
+*   @param          stats - counters of the "Stack" usage (only in STACK_STATS mode)
+*   @param        latency - latency histograms of the operations (only in STACK_LATENCY mode)
+*   @param         flight - ring of the last operations, it is dumped with the errors (only in FLIGHT_RECORDER mode)
+*   @param        persist - file of the "Stack" opened by "StackPersistOpen()", nullptr for the others
+*                           (only in STACK_PERSISTENT mode)
 */
 
 typedef struct _Stack
@@ -63,140 +425,164 @@ typedef struct _Stack
 
     #endif
 
+    #ifdef HASH_INCREMENTAL
+
+        unsigned long long hash_pow;
+
+    #endif
+
     #ifdef STACK_DUMPING
 
         VarDeclaration info;
 
     #endif
 
-} Stack;
+    const StackAllocator *allocator;
 
-/**
-*   @brief The enum contains Stack errors.
-*
-*   @param STACK_OK           - Stack is OK
-*   @param STACK_NULLPTR      - pointer to the Stack is nullptr
-*   @param STACK_NON_CTOR     - Stack is not     constructed
-*   @param STACK_ALREADY_CTOR - Stack is already constructed
-*   @param STACK_EMPTY        - Stack is empty
-*
-*   @param CAPACITY_INVALID   - Stack's capacity is invalid(lower than zero or less then     size)
-*   @param SIZE_INVALID       - Stack's     size is invalid(lower than zero or more than capacity)
-*
-*   @param ACTIVE_POISON_VALUES         - poison-values   are active
-*   @param NON_ACTIVE_NON_POISON_VALUES - refuse elements are non-poison
-*
-*   @param MEMORY_LIMIT_EXCEEDED        - memory allocation query is failed
-*
-*   @param CANARY_PROTECTION_FAILED     - canary protection is failed
-*   @param HASH_PROTECTION_FAILED       - hash   protection is failed
-*/
+    StackGrowth growth;
+    size_t      reserved;
 
-typedef enum _StackError
-{
-    STACK_OK                     = 0,
-    STACK_NULLPTR                = 1,
-    STACK_NON_CTOR               = 2,
-    STACK_ALREADY_CTOR           = 3,
-    STACK_EMPTY                  = 4,
+    #ifdef GUARD_INACTIVE
 
-    CAPACITY_INVALID             = 5,
-    SIZE_INVALID                 = 6,
+        char *guard_writable;
 
-    ACTIVE_POISON_VALUES         = 7,
-    NON_ACTIVE_NON_POISON_VALUES = 8,
+    #endif
 
-    MEMORY_LIMIT_EXCEEDED        = 9,
+    #ifdef POISON_WATERMARK
 
-    CANARY_PROTECTION_FAILED     = 10,
-    HASH_PROTECTION_FAILED       = 11
+        size_t poisoned;
 
-} StackError;
+    #endif
 
-/**
-*   @brief Messages needed to write in log-file in case of errors in "Stack".
-*   @brief Index of message is equal to corresponding error-value in the "enum _StackError".
-*/
+    VerifyMode verify_mode;
+    size_t     verify_param;
+    size_t     verify_counter;
+    size_t     verify_cursor;
 
-const char *error_message[] =
-{
-    "OK",                                    // 0
-    "pointer to the stack is nullptr",       // 1
-    "stack is not constructed",              // 2
-    "stack is already constructed",          // 3
-    "stack is empty",                        // 4
-    "capacity invalid",                      // 5
-    "size invalid",                          // 6
-    "active variables are poisoned",         // 7
-    "non active variables are non poisoned", // 8
-    "memory limit exceeded",                 // 9
-    "canary protection failed",              // 10
-    "hash   protection failed"               // 11
-};
+    #ifdef STACK_STATS
 
-/**
-*   @brief The enum contains poison-values for Stack's elements.
-*
-*   @param POISON_DATA       - poison-value for "Stack_elem *data"
-*   @param POISON_BYTE       - poison-value for byte of elements of "data"
-*   @param POISON_SIZE       - poison-value for "size_t size"
-*   @param POISON_CAPACITY   - poison-value for "size_t capacity"
-*   @param POISON_NAME       - poison-value for StackDeclaration's elements: variable_name, function_name, file_name
-*   @param POISON_STRING     - poison-value fors StackDeclaration's element "string_number"
-*/
+        StackStats stats;
 
-typedef enum _Poison
-{
-    POISON_DATA       = 7,
-    POISON_BYTE       = unsigned(-345),
-    POISON_SIZE       = -1,
-    POISON_CAPACITY   = -1,
-    POISON_NAME       = 7,
-    POISON_STRING     = 0
+    #endif
 
-} Poison;
+    #ifdef STACK_LATENCY
 
-/**
-*   @brief The enum contains any protection constants.
-*
-*   @param LEFT_CANARY  - value for the  left canary protection
-*   @param RIGHT_CANARY - value for the right canary protection
-*
-*   @param HASH_START   - begining value of the hash
-*/
+        StackLatency latency;
 
-typedef enum _Protection
-{
-    LEFT_CANARY  = 0xBAADF00D,
-    RIGHT_CANARY = 0xDEADBEEF,
-    HASH_START   = 0xFEEDFACE
+    #endif
 
-} Protection;
+    #ifdef FLIGHT_RECORDER
+
+        FlightRecorder flight;
+
+    #endif
+
+    #ifdef STACK_PERSISTENT
+
+        PersistFile *persist;
+
+    #endif
+
+} Stack;
 
 /*---------------------------------------------FUNCTIONS_DECLARATION--------------------------------------------------*/
 
-static unsigned StackVerify(Stack *stk);
+static unsigned StackVerify       (Stack *stk);
+static unsigned StackVerifyData   (Stack *stk, const size_t left, const size_t right);
+static unsigned StackSetVerifyMode(Stack *stk, const VerifyMode mode, const size_t param);
 
 static unsigned StackPush   (Stack *stk, const Stack_elem push_val);
 static unsigned StackPop    (Stack *stk, Stack_elem *const front_val = nullptr);
 static unsigned StackDtor   (Stack *stk);
 static unsigned StackRealloc(Stack *stk, const int condition);
+static unsigned StackResize (Stack *stk, const size_t future_capacity);
+static void    *StackStoreRealloc(Stack *stk, void *store, const size_t old_size, const size_t new_size);
+
+static unsigned StackReserve    (Stack *stk, const size_t capacity);
+static unsigned StackShrinkToFit(Stack *stk);
+static unsigned StackSetGrowth  (Stack *stk, const StackGrowth *growth);
+static size_t   StackGrowCapacity  (const Stack *stk, const size_t needed);
+static size_t   StackShrinkCapacity(const Stack *stk);
+
+static unsigned StackPushN  (Stack *stk, const Stack_elem *push_vals,  const size_t num);
+static unsigned StackPopN   (Stack *stk,       Stack_elem *front_vals, const size_t num);
+
+static unsigned StackSave (Stack *stk, const char *file_name);
+static unsigned _StackLoad(Stack *stk, const char *file_name, const char *stk_name,
+                                                              const char *stk_func,
+                                                              const char *stk_file, const int stk_line);
+
+#ifdef STACK_PERSISTENT
+
+    static unsigned _StackPersistOpen(Stack *stk, const char *file_name, const int capacity,
+                                                  const PersistSync sync, const size_t sync_period,
+                                                  const char *stk_name, const char *stk_func,
+                                                  const char *stk_file, const int stk_line);
+
+    static unsigned StackSync         (Stack *stk);
+    static void     StackPersistCommit(Stack *stk);
+    static size_t   StackPersistRepair(Stack *stk);
+
+#endif
+
+#ifdef STACK_STATS
+
+    static unsigned StackGetStats(const Stack *stk, StackStats *stats);
+
+    static unsigned long long stats_now_ns();
+    static void StackStatsVerified(Stack *stk, const unsigned err, const unsigned long long start_ns);
+
+#endif
+
+#ifdef STACK_LATENCY
+
+    static unsigned StackGetLatency  (const Stack *stk, StackLatency *latency);
+    static void     StackLatencyMerge(StackLatency *dst, const StackLatency *src);
+    static void     StackLatencyPrint(FILE *stream, const StackLatency *latency);
+
+#endif
 
 static unsigned  PoisonCheck(void *_verifiable_elem, const size_t elem_size, const unsigned char poison_val,
                                                                       const unsigned char mode);
-static void FillPoison(void *_fillable_elem, const size_t elem_size, const unsigned left,
-                                                              const unsigned right, const unsigned char poison_val);
-static void make_bit_true(unsigned *const num, const unsigned bit_num);
+static size_t   PoisonFind(void *_verifiable_elem, const size_t elem_size, const size_t left,
+                                                   const size_t right, const unsigned char poison_val,
+                                                                       const unsigned char mode);
+static void FillPoison(void *_fillable_elem, const size_t elem_size, const size_t left,
+                                                              const size_t right, const unsigned char poison_val);
 
-#ifdef STACK_DUMPING
+static unsigned _StackCtor(Stack *stk, int capacity, const char *stk_name,
+                                              const char *stk_func,
+                                              const char *stk_file, const int stk_line,
+                                              const StackAllocator *allocator = nullptr);
+
+static inline size_t StackStoreSize(const size_t capacity);
+static inline size_t StackPoisonedEnd(const Stack *stk);
+
+#ifdef POISON_WATERMARK
+
+    static void StackPoisonUpTo(Stack *stk, const size_t end);
+
+#endif
+
+#ifdef STACK_ERROR_DUMP
 
     static void StackDump(Stack *stk, const unsigned err, const char *current_file,
                                                    const char *current_func,
-                                                   const char *current_line);
+                                                   int         current_line);
 
-    static unsigned _StackCtor(Stack *stk, int capacity, const char *stk_name,
-                                                  const char *stk_func,
-                                                  const char *stk_file, const int stk_line);
+#endif
+
+#ifdef GUARD_PROTECTION
+
+    static void StackGuardRegister  (Stack *stk);
+    static void StackGuardUnregister(Stack *stk);
+    static void guard_sigsegv_handler(int sig, siginfo_t *info, void *context);
+
+#endif
+
+#ifdef GUARD_INACTIVE
+
+    static void StackGuardSync(Stack *stk, const size_t active);
 
 #endif
 
@@ -212,6 +598,22 @@ static void make_bit_true(unsigned *const num, const unsigned bit_num);
     static unsigned long long get_hash(void *_data_store, const size_t elem_size);
     static unsigned CheckHash(void *_data_store, const size_t elem_size, unsigned long long hash_val);
 
+    static void StackHashRecount(Stack *stk);
+
+#endif
+
+#ifdef HASH_INCREMENTAL
+
+    static unsigned long long hash_power  (unsigned long long base, size_t exp);
+    static unsigned long long hash_inverse(const unsigned long long odd_val);
+
+    static unsigned long long hash_poly(const void *bytes, const size_t len);
+
+    static void StackHashUpdateTop(Stack *stk, const unsigned long long old_poly, const unsigned long long new_poly,
+                                               const size_t             num,      const int                is_push);
+
+    static void StackHashResize(Stack *stk, const size_t old_end, const size_t new_end, const unsigned long long tail_poly);
+
 #endif
 
 /*---------------------------------------LOG_FUNCTIONS_DECLARATION----------------------------------------------------*/
@@ -247,756 +649,3793 @@ const char *COLOR_NAMES[] =
     ""
 };
 
-const char *LOG_FILE_NAME = "log.html";
-FILE       *LOG_STREAM    = nullptr;
+const char *LOG_FILE_NAME   = "log.html";
+const char *TRACE_FILE_NAME = "log.trace"; ///< is written instead of LOG_FILE_NAME in LOG_TRACE mode
+FILE       *LOG_STREAM    = nullptr; ///< stays nullptr in LOG_MMAP mode
 
-char *TAB_SHIFT = nullptr;
-int   TAB_NUM = 0;
+#ifdef LOG_MMAP
 
-/**
-*   @brief Closes log-file. Called by using atexit().
-*
-*   @return 1 if closing is OK. Does abort() if an ERROR found.
-*/
+    #ifndef LOG_ROTATE_SIZE
+        #define LOG_ROTATE_SIZE (64u << 20) ///< size (in bytes) of the text after which log.html is rotated
+    #endif
 
-void CLOSE_LOG_STREAM()
-{
-    assert(LOG_STREAM != nullptr);
+    #ifndef LOG_ROTATE_KEEP
+        #define LOG_ROTATE_KEEP 4           ///< number of the rotated log-files which are kept
+    #endif
 
-    fprintf(LOG_STREAM, "\"%s\" CLOSING IS OK\n\n", LOG_FILE_NAME);
-    fclose( LOG_STREAM);
-}
+    LogMmap LOG_MMAP_FILE = {};
+
+#endif
+
+const size_t LOG_LINE_SIZE = 1 << 10; ///< messages shorter than it are formatted without malloc()
+
+#ifdef LOG_ASYNC
+
+    const size_t LOG_COMMIT_SIZE = LOG_LINE_SIZE; ///< whole lines are collected up to it, so the ring is locked once per batch
+
+#else
+
+    const size_t LOG_COMMIT_SIZE = 1;             ///< unbuffered log-file gets every line as soon as it is finished
+
+#endif
 
 /**
-*   @brief Opens log-file. Ckecks if opening is OK and in this case prints message in the log-file.
-*   @brief Uses atexit() to call CLOSE_LOG_STREAM() after program end.
+*   @brief Logging context of one thread. The threads share only the log-file, and it gets only whole lines
+*   @brief by one "log_write()", so the lines of different threads never mix.
 *
-*   @return 1 if checking is OK. Does abort() if an ERROR found.
+*   @param  tab_shift - string of "tab_num" tabs, it is printed after every new line (TAB_SHIFT)
+*   @param    tab_num - nesting of the traced calls of the thread
+*   @param    tab_cap - size of the "tab_shift" memory, it grows with the nesting
+*   @param      stage - text which is not written yet, its last line may be unfinished
+*   @param  stage_len - number of bytes in the "stage"
+*   @param  stage_cap - size of the "stage" memory
+*   @param registered - marker if the "stage" is written out at the thread exit
+*   @param     exited - marker if the context is already freed at the thread exit (or before the atexit() handlers
+*                       of the main thread), the later lines go to the log-file at once and without the tabs
 */
 
-int OPEN_LOG_STREAM()
+typedef struct _LogContext
 {
-    LOG_STREAM = fopen(LOG_FILE_NAME, "w");
+    char  *tab_shift;
+    int    tab_num;
+    size_t tab_cap;
 
-    TAB_SHIFT  = (char *) calloc(1, 100);
-    TAB_NUM    = 0;
+    char  *stage;
+    size_t stage_len;
+    size_t stage_cap;
 
-    assert(LOG_STREAM != nullptr);
-    assert(TAB_SHIFT  != nullptr);
+    int    registered;
+    int    exited;
 
-    setvbuf(LOG_STREAM,   nullptr, _IONBF, 0);
+} LogContext;
 
-    fprintf(LOG_STREAM, "<pre>\n""\"%s\" OPENING IS OK\n\n", LOG_FILE_NAME);
+thread_local LogContext LOG_CONTEXT = {};
 
-    atexit(CLOSE_LOG_STREAM);
-    return 1;
+static inline const char *log_tab_shift()
+{
+    return (LOG_CONTEXT.tab_shift != nullptr) ? LOG_CONTEXT.tab_shift : "";
 }
 
-int  _OPEN_CLOSE_LOG_STREAM = OPEN_LOG_STREAM();
-
-void log_message(COLOR col, const char *fmt, ...)
+static int log_tab_num()
 {
-    va_list ap;
-    va_start(ap, fmt);
-
-    fprintf (LOG_STREAM, "<font color=%s>", COLOR_NAMES[col]);
-    vfprintf(LOG_STREAM, fmt, ap);
-    fprintf (LOG_STREAM, "</font>");
+    return LOG_CONTEXT.tab_num;
 }
 
-void log_func_end(const char *function_name, unsigned err)
-{
-    TAB_SHIFT[--TAB_NUM] = '\0';
+#define TAB_SHIFT log_tab_shift()
 
-    log_message(USUAL, "%s returns %d\n\n%s", function_name, err, TAB_SHIFT);
-}
+static void log_context_register();
+
+/**
+*   @brief Increases the nesting of the traced calls of the thread by one tab.
+*
+*   @return nothing
+*/
 
-void log_stack_elem(const Stack_elem *var)
+static void log_tab_push()
 {
-    unsigned char current_byte_value = 0;
-    unsigned char is_poison = 1;
+    if (LOG_CONTEXT.exited)
+        return;
+
+    size_t needed = (size_t) LOG_CONTEXT.tab_num + 2;
 
-    for (size_t i = 0; i < sizeof(Stack_elem); ++i)
+    if (needed > LOG_CONTEXT.tab_cap)
     {
-        current_byte_value = *((const unsigned char *) var + i);
+        size_t new_cap = (LOG_CONTEXT.tab_cap != 0) ? 2 * LOG_CONTEXT.tab_cap : 64;
+        if (new_cap < needed) new_cap = needed;
 
-        if (current_byte_value != (unsigned char) POISON_BYTE)
-            is_poison = 0;
+        char *new_mem = (char *) realloc(LOG_CONTEXT.tab_shift, new_cap);
+        assert(new_mem != nullptr);
 
-        log_message(BLUE, "%x", current_byte_value);
+        log_context_register();
+
+        LOG_CONTEXT.tab_shift = new_mem;
+        LOG_CONTEXT.tab_cap   = new_cap;
     }
 
-    if (is_poison)
-        log_message(POISON_COLOR, "(POISON)");
+    LOG_CONTEXT.tab_shift[LOG_CONTEXT.tab_num++] = '\t';
+    LOG_CONTEXT.tab_shift[LOG_CONTEXT.tab_num]   = '\0';
 }
 
-void log_make_dump(Stack *stk, const char *current_file,
-                               const char *current_func,
-                               int         current_line)
+/**
+*   @brief Decreases the nesting of the traced calls of the thread by one tab, never below zero.
+*
+*   @return nothing
+*/
+
+static void log_tab_pop()
 {
-    log_message(BLUE, "\n%sERROR occurred at:\n"
-                      "             %sFILE: %s\n"
-                      "             %sFUNC: %s\n"
-                      "             %sLINE: %d\n\n%s", TAB_SHIFT, TAB_SHIFT, current_file, TAB_SHIFT, current_func, TAB_SHIFT, current_line, TAB_SHIFT);    
+    if (LOG_CONTEXT.tab_num > 0)
+        LOG_CONTEXT.tab_shift[--LOG_CONTEXT.tab_num] = '\0';
+}
 
-    if (stk == nullptr)
+#ifdef LOG_ASYNC
+
+    /**
+    *   @brief Ring buffer of the asynchronous log. Callers append formatted text into "buf",
+    *   @brief the background thread "writer" drains it into the LOG_STREAM by large writes.
+    *
+    *   @param        buf - memory of the ring buffer (LOG_RING_SIZE bytes)
+    *   @param       head - number of bytes appended since the log opening
+    *   @param       tail - number of bytes written  since the log opening
+    *   @param  flush_req - "head" value which must be written as soon as possible
+    *   @param       stop - marker if "writer" must drain the buffer and exit
+    *   @param  is_writer - marker if "writer" runs; if not (in a fork() child), the log is written synchronously
+    *   @param       lock - mutex which protects all fields above
+    *   @param  not_empty - signaled when "writer" has a work to do
+    *   @param   not_full - signaled when "writer" frees a space in the "buf"
+    *   @param     writer - background thread
+    */
+
+    typedef struct _LogRing
     {
-        fprintf(LOG_STREAM, "Stack[nullptr]\n%s", TAB_SHIFT);
-        return;
+        char  *buf;
+
+        size_t head;
+        size_t tail;
+        size_t flush_req;
+
+        int    stop;
+        int    is_writer;
+
+        pthread_mutex_t lock;
+        pthread_cond_t  not_empty;
+        pthread_cond_t  not_full;
+
+        pthread_t writer;
+
+    } LogRing;
+
+    const size_t LOG_RING_SIZE      = 1 << 22;
+    const size_t LOG_RING_THRESHOLD = 1 << 16; ///< "writer" wakes up when so many bytes are collected
+
+    LogRing LOG_RING = {};
+
+    /**
+    *   @brief Body of the background thread. Waits until enough bytes are collected, a flush is requested
+    *   @brief or the log is closing, and writes the collected bytes by one fwrite() (two if the bytes wrap around).
+    *
+    *   @return nullptr
+    */
+
+    void *log_writer(void *)
+    {
+        pthread_mutex_lock(&LOG_RING.lock);
+
+        while (true)
+        {
+            while (!LOG_RING.stop && LOG_RING.head - LOG_RING.tail < LOG_RING_THRESHOLD
+                                  && LOG_RING.flush_req            <= LOG_RING.tail)
+                pthread_cond_wait(&LOG_RING.not_empty, &LOG_RING.lock);
+
+            if (LOG_RING.head == LOG_RING.tail)
+            {
+                if (LOG_RING.stop) break;
+
+                continue;
+            }
+
+            size_t begin = LOG_RING.tail % LOG_RING_SIZE;
+            size_t len   = LOG_RING.head - LOG_RING.tail;
+
+            if (begin + len > LOG_RING_SIZE) len = LOG_RING_SIZE - begin;
+
+            pthread_mutex_unlock(&LOG_RING.lock);
+
+            fwrite(LOG_RING.buf + begin, 1, len, LOG_STREAM);
+            fflush(LOG_STREAM);
+
+            pthread_mutex_lock(&LOG_RING.lock);
+
+            LOG_RING.tail += len;
+            pthread_cond_broadcast(&LOG_RING.not_full);
+        }
+
+        pthread_mutex_unlock(&LOG_RING.lock);
+        return nullptr;
     }
 
-    if (stk->info.variable_name == nullptr) stk->info.variable_name = "nullptr";
-    if (stk->info.file_name     == nullptr) stk->info.file_name     = "nullptr";
-    if (stk->info.function_name == nullptr) stk->info.function_name = "nullptr";
+    /**
+    *   @brief pthread_atfork() handlers. "fork()" is done with the ring and the LOG_STREAM locked, so the child
+    *   @brief doesn't inherit them in the middle of an append or a write. The child has no "writer", so it drops
+    *   @brief the bytes which the parent's "writer" still owes and writes its own log synchronously.
+    *
+    *   @return nothing
+    */
 
-    if (stk->info.variable_name == (const char *) POISON_NAME) stk->info.variable_name = "POISON_NAME";
-    if (stk->info.file_name     == (const char *) POISON_NAME) stk->info.file_name     = "POISON_NAME";
-    if (stk->info.function_name == (const char *) POISON_NAME) stk->info.function_name = "POISON_NAME";
+    void log_fork_prepare()
+    {
+        pthread_mutex_lock(&LOG_RING.lock);
+        flockfile(LOG_STREAM);
+        fflush_unlocked(LOG_STREAM);
+    }
 
-    log_message(BLUE, "Stack[%p] \"%s\" was constructed at\n%s"
-                      "file: \"%s\"\n%s"
-                      "func: \"%s\"\n%s"
-                      "line: \"%d\"\n%s"
-                      "{\n%s"
-                      "\tsize     = %u\n%s"
-                      "\tcapacity = %u\n%s", stk, stk->info.variable_name, TAB_SHIFT,
-                                               stk->info.file_name, TAB_SHIFT, stk->info.function_name, TAB_SHIFT, stk->info.string_number, TAB_SHIFT,
-                                               TAB_SHIFT, stk->size, TAB_SHIFT, stk->capacity, TAB_SHIFT);
-    if (stk->data == nullptr)
+    void log_fork_parent()
     {
-        log_message(BLUE, "\tdata[nullptr]\n%s}\n%s", TAB_SHIFT, TAB_SHIFT);
-        return;
+        funlockfile(LOG_STREAM);
+        pthread_mutex_unlock(&LOG_RING.lock);
     }
 
-    if (stk->data == (Stack_elem *) POISON_DATA)
+    void log_fork_child()
     {
-        log_message(BLUE, "\tdata");
-        log_message(POISON_COLOR, "[POISON_DATA]");
-        log_message(BLUE, "\n%s}\n%s", TAB_SHIFT, TAB_SHIFT);
-        return;
+        LOG_RING.tail      = LOG_RING.head;
+        LOG_RING.flush_req = LOG_RING.head;
+        LOG_RING.is_writer = 0;
+
+        pthread_cond_init(&LOG_RING.not_empty, nullptr);
+        pthread_cond_init(&LOG_RING.not_full,  nullptr);
+
+        funlockfile(LOG_STREAM);
+        pthread_mutex_unlock(&LOG_RING.lock);
     }
 
-    #ifdef CANARY_PROTECTION
+#endif
+
+/**
+*   @brief Appends "len" bytes from "buf" to the log-file.
+*   @brief In LOG_ASYNC mode copies them into the ring buffer and waits only if it is full,
+*   @brief or writes them at once if there is no background thread.
+*   @brief In LOG_TRACE mode appends them to the trace as TRACE_TEXT event.
+*   @brief In LOG_MMAP mode copies them into the mapped log-file (see "log_mmap.h").
+*
+*   @param buf [in] buf - pointer to the first byte to write
+*   @param len [in] len - number of bytes to write
+*
+*   @return nothing
+*/
 
-        unsigned left = 0, right = 0;
+void log_write(const char *buf, size_t len)
+{
+    #if defined(LOG_TRACE)
 
-        StackCheckCanary(stk, &left, &right);
+        trace_event(TRACE_TEXT, nullptr, 0, 0, 0, 0, buf, len);
 
-        if (left == LEFT_CANARY)
-        {
-            log_message(BLUE,  "\tleft_canary  = %16u", left);
-            log_message(GREEN, "(OK)\n%s",         TAB_SHIFT);
-        }
-        else
-        {
-            log_message(BLUE,  "\tleft_canary  = %16u", left);
-            log_message(RED,   "(ERROR)\n%s",      TAB_SHIFT);
-        }
+    #elif defined(LOG_ASYNC)
 
-        if (right == RIGHT_CANARY)
+        pthread_mutex_lock(&LOG_RING.lock);
+
+        if (!LOG_RING.is_writer)
         {
-            log_message(BLUE,  "\tright_canary = %16u", right);
-            log_message(GREEN, "(OK)\n%s",          TAB_SHIFT);
+            fwrite(buf, 1, len, LOG_STREAM);
+            len = 0;
         }
-        else
+
+        while (len > 0)
         {
-            log_message(BLUE, "\tright_canary = %16u", right);
-            log_message(RED,  "(ERROR)\n%s",       TAB_SHIFT);
-        }
+            while (LOG_RING.head - LOG_RING.tail == LOG_RING_SIZE)
+                pthread_cond_wait(&LOG_RING.not_full, &LOG_RING.lock);
 
-    #endif
+            size_t begin = LOG_RING.head % LOG_RING_SIZE;
+            size_t chunk = LOG_RING_SIZE - (LOG_RING.head - LOG_RING.tail);
 
-    #ifdef HASH_PROTECTION
+            if (chunk > LOG_RING_SIZE - begin) chunk = LOG_RING_SIZE - begin;
+            if (chunk > len)                   chunk = len;
 
-        unsigned good_hash = CheckHash(stk->data, stk->capacity * sizeof(Stack_elem), stk->hash_val);
+            memcpy(LOG_RING.buf + begin, buf, chunk);
 
-        if (good_hash)
-        {
-            log_message(BLUE,  "\thash_val = %llx", stk->hash_val);
-            log_message(GREEN, "(OK)\n%s",            TAB_SHIFT);
-        }
-        else
-        {
-            log_message(BLUE, "\thash_val = %llx", stk->hash_val);
-            log_message(RED,  "(ERROR)\n%s",         TAB_SHIFT);
-        }
+            LOG_RING.head += chunk;
+            buf           += chunk;
+            len           -= chunk;
 
-    #endif
+            if (LOG_RING.head - LOG_RING.tail >= LOG_RING_THRESHOLD)
+                pthread_cond_signal(&LOG_RING.not_empty);
+        }
 
-    log_message(BLUE, "\tdata[%p]\n%s\t{\n%s", stk->data, TAB_SHIFT, TAB_SHIFT);
+        pthread_mutex_unlock(&LOG_RING.lock);
 
-    for (size_t data_counter = 0; data_counter < stk->capacity; ++data_counter)
-    {
-        putc('\t', LOG_STREAM);
+    #elif defined(LOG_MMAP)
 
-        (data_counter < stk->size) ? putc('*', LOG_STREAM) : putc(' ', LOG_STREAM);
+        log_mmap_write(&LOG_MMAP_FILE, buf, len);
 
-        log_message(BLUE, "[%d] = ", data_counter);
+    #else
 
-        log_stack_elem(stk->data + data_counter);
+        fwrite(buf, 1, len, LOG_STREAM);
 
-        fprintf(LOG_STREAM, "\n%s", TAB_SHIFT);
-    }
-    log_message(BLUE, "\t}\n%s}\n%s", TAB_SHIFT, TAB_SHIFT);
+    #endif
 }
 
-void log_dumping_ctor(Stack *stk, const int capacity, const char *stk_name,
-                                                      const char *stk_func,
-                                                      const char *stk_file, const int stk_line)
+/**
+*   @brief Writes the first "len" bytes of the "stage" of the thread by one "log_write()" and keeps the rest.
+*
+*   @return nothing
+*/
+
+static void log_commit(const size_t len)
 {
-    if (stk_name == nullptr) stk_name = "nullptr";
-    if (stk_func == nullptr) stk_func = "nullptr";
-    if (stk_file == nullptr) stk_file = "nullptr";
-
-    log_message(USUAL, "(dumping)_StackCtor(stk = %p, capacity = %d,\n%s"
-                       "stk_name = \"%s\"\n%s"
-                       "stk_func = \"%s\"\n%s"
-                       "stk_file = \"%s\"\n%s"
-                       "stk_line = %d)\n\n%s\t",
-                                            stk,      capacity,       TAB_SHIFT,
-                        stk_name, TAB_SHIFT,
-                        stk_func, TAB_SHIFT,
-                        stk_file, TAB_SHIFT,
-                        stk_line, TAB_SHIFT);
-    TAB_SHIFT[TAB_NUM++] = '\t';
+    if (len == 0)
+        return;
+
+    log_write(LOG_CONTEXT.stage, len);
+
+    LOG_CONTEXT.stage_len -= len;
+    memmove(LOG_CONTEXT.stage, LOG_CONTEXT.stage + len, LOG_CONTEXT.stage_len);
 }
 
-void log_push(Stack *stk, const Stack_elem push_val)
+/**
+*   @brief Writes the whole "stage" of the thread, the unfinished line too, and frees the context at the thread exit.
+*   @brief The lines logged after it (by the later thread_local destructors and, for the main thread, by the atexit()
+*   @brief handlers as "CLOSE_LOG_STREAM()") bypass the "stage", so nothing is allocated for the freed context again.
+*/
+
+struct LogContextExit
 {
-    fprintf(LOG_STREAM, "StackPush(stk = %p, push_val = ", stk);
+    ~LogContextExit()
+    {
+        log_commit(LOG_CONTEXT.stage_len);
 
-    log_stack_elem(&push_val);
+        free(LOG_CONTEXT.stage);
+        free(LOG_CONTEXT.tab_shift);
 
-    fprintf(LOG_STREAM, ")\n\n%s\t", TAB_SHIFT);
-    TAB_SHIFT[TAB_NUM++] = '\t';
-}
+        LOG_CONTEXT        = {};
+        LOG_CONTEXT.exited = 1;
+    }
+};
 
-/*--------------------------------------------------------------------------------------------------------------------*/
+/**
+*   @brief Makes "LogContextExit" run at the exit of the calling thread.
+*/
+
+static void log_context_register()
+{
+    if (!LOG_CONTEXT.registered)
+    {
+        static thread_local LogContextExit context_exit;
+        (void) context_exit;
+
+        LOG_CONTEXT.registered = 1;
+    }
+}
 
 /**
-*   @brief Works in 2 modes.
-*   @brief Checks if the variable is filled by "poison_val"     in the first  mode.
-*   @brief Checks if the variable doesn't have any poison bytes in the second mode.
+*   @brief Appends "len" bytes from "buf" to the "stage" of the thread. Writes the finished lines to the log-file
+*   @brief when at least LOG_COMMIT_SIZE bytes of them are collected or when no traced call is running.
 *
-*   @param _verifiable_elem [in] _verifiable_elem - pointer         to the variable to check
-*   @param        elem_size [in]        elem_size - size (in bytes) of the variable to check
-*   @param       poison_val [in]       poison_val - poison value to compare with
-*   @param             mode [in]             mode - mode of "PoisonCheck()"
+*   @param buf [in] buf - pointer to the first byte to append
+*   @param len [in] len - number of bytes to append
 *
-*   @return In the first  mode: 1 if all bytes are     equal to "poison_value" and 0 else
-*   @return In the zero   mode: 1 if all bytes are not equal to "poison_value" and 0 else
+*   @return nothing
 */
 
-static unsigned PoisonCheck(void *_verifiable_elem, const size_t elem_size, const unsigned char poison_val,
-                                                                const unsigned char mode)
+static void log_stage(const char *buf, const size_t len)
 {
-    assert(_verifiable_elem != nullptr);
+    if (LOG_CONTEXT.exited)
+    {
+        log_write(buf, len); // nothing would free the new "stage" any more
+        return;
+    }
 
-    const unsigned char* verifiable_elem = (const unsigned char *) _verifiable_elem;
+    log_context_register();
 
-    for (size_t counter = 0; counter < elem_size; ++counter)
+    if (LOG_CONTEXT.stage_len + len > LOG_CONTEXT.stage_cap)
     {
-        unsigned char checking_res = mode ? verifiable_elem[counter] == poison_val :
-                                            verifiable_elem[counter] != poison_val ;
-        if (!checking_res)
+        size_t new_cap = (LOG_CONTEXT.stage_cap != 0) ? 2 * LOG_CONTEXT.stage_cap : 2 * LOG_LINE_SIZE;
+        if (new_cap < LOG_CONTEXT.stage_len + len) new_cap = LOG_CONTEXT.stage_len + len;
+
+        char *new_mem = (char *) realloc(LOG_CONTEXT.stage, new_cap);
+
+        if (new_mem == nullptr)
         {
-            log_func_end(__PRETTY_FUNCTION__, 0);
-            return 0;
+            log_commit(LOG_CONTEXT.stage_len);  // no memory to keep the line together: write it in parts
+            log_write (buf, len);
+            return;
         }
+
+        LOG_CONTEXT.stage     = new_mem;
+        LOG_CONTEXT.stage_cap = new_cap;
     }
-    return 1;
+
+    memcpy(LOG_CONTEXT.stage + LOG_CONTEXT.stage_len, buf, len);
+    LOG_CONTEXT.stage_len += len;
+
+    size_t finished = LOG_CONTEXT.stage_len;
+
+    while (finished > 0 && LOG_CONTEXT.stage[finished - 1] != '\n')
+        --finished;
+
+    // outside of the traced calls nothing follows soon, so the lines are written at once
+    if (finished >= LOG_COMMIT_SIZE || (finished > 0 && LOG_CONTEXT.tab_num == 0))
+        log_commit(finished);
 }
 
 /**
-*   @brief Fills the segment [l, r) of the array "_fillable_elem" by "poison_val".
-*
-*   @param _fillable_elem [in] _fillable_elem - pointer to the first byte of the array to fill
-*   @param      elem_size [in]      elem_size - size (in bytes) of the array's elements
-*   @param           left [in]           left - index of the filling segment beginning
-*   @param          right [in]          right - index of the filling segment ending
-*   @param     poison_val [in]     poison_val - value to fill in
+*   @brief Waits until everything appended to the log-file before the call is written on the disk.
+*   @brief Does nothing special in the default mode, because the LOG_STREAM is unbuffered there,
+*   @brief and in LOG_MMAP mode, because the mapping is the page cache of the file already.
 *
 *   @return nothing
 */
 
-static void FillPoison(void *_fillable_elem, const size_t elem_size, const unsigned left,
-                                                              const unsigned right, const unsigned char poison_val)
+void log_flush()
 {
-    fprintf(LOG_STREAM, "FillPoison(_fillable_elem = %p, elem_size = %lu,\n%s"
-                        "                                                left  = %u,\n%s"
-                        "                                                right = %u, poison_val = %u)\n\n%s",
-                                    _fillable_elem,      elem_size, TAB_SHIFT,
-                                                                         left, TAB_SHIFT,
-                                                                         right,      poison_val, TAB_SHIFT);
-    TAB_SHIFT[TAB_NUM++] = '\t';
+    log_commit(LOG_CONTEXT.stage_len);
 
-    assert(_fillable_elem != nullptr);
+    #if defined(LOG_TRACE)
 
-    char *fillable_elem = (char *) _fillable_elem;
+        trace_flush();
 
-    memset(fillable_elem + elem_size * left, poison_val, elem_size * (right - left));
+    #elif defined(LOG_ASYNC)
 
-    log_func_end(__PRETTY_FUNCTION__, 0);
+        pthread_mutex_lock(&LOG_RING.lock);
+
+        if (LOG_RING.is_writer)
+        {
+            size_t target = LOG_RING.head;
+
+            if (LOG_RING.flush_req < target) LOG_RING.flush_req = target;
+            pthread_cond_signal(&LOG_RING.not_empty);
+
+            while (LOG_RING.tail < target)
+                pthread_cond_wait(&LOG_RING.not_full, &LOG_RING.lock);
+        }
+        else
+            fflush(LOG_STREAM);
+
+        pthread_mutex_unlock(&LOG_RING.lock);
+
+    #elif !defined(LOG_MMAP)
+
+        fflush(LOG_STREAM);
+
+    #endif
 }
 
-#ifdef CANARY_PROTECTION
+/**
+*   @brief Formats the message like vprintf() and appends it to the "stage" of the thread by "log_stage()".
+*   @brief In LOG_TRACE mode appends it to the trace by "log_write()" at once, the trace has its own buffer.
+*
+*   @param fmt [in] fmt - format string
+*   @param  ap [in]  ap - arguments of the format string
+*
+*   @return nothing
+*/
 
-    /**
-    *   @brief Checks if canary protection of the "stack" is OK. Puts values of canaries in the "left_canary" and
-    *   @brief the "right_canary".
-    *
-    *   @param          stk [in]           stk - pointer to the "stack" to check the canary protection
-    *   @param  left_canary [out]  left_canary - pointer to the  left_canary value. In case of nullptr, value doesn't put
-    *   @param right_canary [out] right_canary - pointer to the right_canary value. In case of nullptr, value doesn't put
-    *
-    *   @return 0 if check failed and 0 else
-    */
+void log_vprintf(const char *fmt, va_list ap)
+{
+    #ifdef LOG_TRACE
 
-    static unsigned StackCheckCanary(Stack *stk, unsigned *const left_canary, unsigned *const right_canary)
-    {
-        assert(stk != nullptr);
+        void (*const append)(const char *buf, size_t len) = log_write;
 
-        unsigned  left = *(unsigned *) ((unsigned *)stk->data - 1);
-        unsigned right = *(unsigned *) (stk->data + stk->capacity);
+    #else
 
-        unsigned ret = (left == (unsigned) LEFT_CANARY) && (right == (unsigned) RIGHT_CANARY);
+        void (*const append)(const char *buf, size_t len) = log_stage;
 
-        if ( left_canary) * left_canary = left ;
-        if (right_canary) *right_canary = right;
+    #endif
 
-        return ret;
-    }
+    char line[LOG_LINE_SIZE];
 
-#endif
+    va_list ap_copy;
+    va_copy(ap_copy, ap);
 
-#ifdef HASH_PROTECTION
+    int len = vsnprintf(line, LOG_LINE_SIZE, fmt, ap);
 
-    /**
-    *   @brief Counts the hash_value for the variable of any type.
-    *
-    *   @param _data_store [in] _data_store - pointer to the first byte of the variable to hash
-    *   @param   elem_size [in]   elem_size - size (in bytes)           of the variable to hash
-    *
-    *   @return hash_value
-    */
+    if (len >= 0 && (size_t) len < LOG_LINE_SIZE)
+        append(line, (size_t) len);
 
-    static unsigned long long get_hash(void *_data_store, const size_t elem_size)
+    else if (len >= 0)
     {
-        assert(_data_store != nullptr);
-
-        unsigned char *data_store = (unsigned char *) _data_store;
-        unsigned long long hash_ret = HASH_START;
+        char *long_line = (char *) calloc((size_t) len + 1, sizeof(char));
 
-        for (size_t counter = 0; counter < elem_size; ++counter)
+        if (long_line != nullptr)
         {
-            hash_ret = ((hash_ret << 5) + hash_ret) + data_store[counter];
+            vsnprintf(long_line, (size_t) len + 1, fmt, ap_copy);
+            append(long_line, (size_t) len);
         }
-
-        return hash_ret;
+        free(long_line);
     }
 
-    /**
-    *   @brief Checks if the "hash_val" of any variable still equal to original hash.
-    *
-    *   @param _data_store [in] _data_store - pointer to the first byte of the variable to check
-    *   @param   elem_size [in]   elem_size - size (in bytes)           of the variable to check
-    *   @param    hash_val [in]    hash_val - hash value to compare with
-    *
-    *   @return true-value if the "hash_val" is right and false-value else
-    */
+    va_end(ap_copy);
+}
 
-    static unsigned CheckHash(void *_data_store, const size_t elem_size, const unsigned long long hash_val)
-    {
-        assert(_data_store != nullptr);
+void log_printf(const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
 
-        unsigned long long     old_hash = hash_val;
-        unsigned long long current_hash = get_hash(_data_store, elem_size);
+    log_vprintf(fmt, ap);
 
-        unsigned ret = (old_hash == current_hash);
+    va_end(ap);
+}
 
-        return ret;
-    }
+/**
+*   @brief Closes log-file. Called by using atexit().
+*   @brief In LOG_ASYNC mode stops the background thread after it writes all collected bytes.
+*
+*   @return 1 if closing is OK. Does abort() if an ERROR found.
+*/
 
-#endif
+void CLOSE_LOG_STREAM()
+{
+    #ifndef LOG_MMAP
 
-#ifdef STACK_DUMPING
+        assert(LOG_STREAM != nullptr);
 
-    #define Stack_assert(stk_ptr, err)                                                          \
-            if ((*err = StackVerify(stk_ptr)))                                                  \
-            {                                                                                   \
-                StackDump(stk_ptr, *err, __FILE__, __PRETTY_FUNCTION__, __LINE__);              \
-                                                                                                \
-                log_func_end(__PRETTY_FUNCTION__, *err);                                        \
-                return *err;                                                                    \
-            }
-#else
+    #endif
 
-    #define Stack_assert(stk_ptr, err)                                                          \
-            if ((*err = StackVerify(stk_ptr)))                                                  \
-            {                                                                                   \
-                log_func_end(__PRETTY_FUNCTION__, *err);                                        \
-                return *err;                                                                    \
-            }
+    log_printf("\"%s\" CLOSING IS OK\n\n", LOG_FILE_NAME);
+    log_commit(LOG_CONTEXT.stage_len);
 
-#endif
+    #ifdef LOG_ASYNC
 
-#ifdef STACK_DUMPING
+        pthread_mutex_lock(&LOG_RING.lock);
 
-    #define StackCtor(stk_name, capacity)                                                       \
-           _StackCtor(stk_name, capacity, #stk_name, __PRETTY_FUNCTION__, __FILE__, __LINE__)
+        const int is_writer = LOG_RING.is_writer;
 
-    /**
-    *   @brief Prints all information about "Stack" variable in the log-file.
-    *
-    *   @param          stk [in]          stk - pointer to the "Stack" variable
-    *   @param          err [in]          err - bit-mask which encodes the errors from "enum _StackError"
-    *   @param current_file [in] current_file - name   of the file, where "StackDump()" called
-    *   @param current_func [in] current_func - name   of the func, where "StackDump()" called
-    *   @param current_file [in] current_line - number of the line, where "StackDump()" called
-    *
-    *   @return nothing
-    */
+        LOG_RING.stop = 1;
+        pthread_cond_signal(&LOG_RING.not_empty);
 
-    static void StackDump(Stack *stk, const unsigned err, const char *current_file,
-                                                   const char *current_func,
-                                                   int         current_line)
-    {
-        fprintf(LOG_STREAM, "StackDump(stk = %p, err = %u,\n%s"
-                            "                              current_file = \"%s\"\n%s"
-                            "                              current_func = \"%s\"\n%s"
-                            "                              current_line = %d)\n\n%s",
-                                       stk,      err, TAB_SHIFT,
-                                                           current_file, TAB_SHIFT,
-                                                           current_func, TAB_SHIFT,
-                                                           current_line, TAB_SHIFT);
-        TAB_SHIFT[TAB_NUM++] = '\t';
-        
-        err == 0 ? log_message(GREEN, "NO_ERRORS\n%s", TAB_SHIFT) : log_message(RED, "MESSAGE_ERRORS\n%s", TAB_SHIFT);
+        pthread_mutex_unlock(&LOG_RING.lock);
 
-        int error_numbers = sizeof(error_message) / sizeof(char *);
+        if (is_writer)
+            pthread_join(LOG_RING.writer, nullptr);
 
-        for (int i = 0; i <= error_numbers; ++i)
-        {
-            if (err & (1 << i))
-                log_message(RED, error_message[i]);
-        }
+    #endif
 
-        log_make_dump(stk, current_file,
-                           current_func,
-                           current_line);
+    #ifdef LOG_TRACE
 
-        log_func_end(__PRETTY_FUNCTION__, 0);
-    }
+        trace_flush();
 
-    /**
-    *   @brief Stack dumping constructor. In adittion to "capacity", it takes "struct _StackDeclaration" elements.
-    *   @brief Allocates memory for "Stack_elem *data" and fills them by poison.
-    *   @brief The "Stack" must be initialized by nulls before.
-    *   @brief Returns the bit-mask which encodes the errors. A set bit means the error.
-    *   @brief Names of the erros are in the "enum _StackError".
-    *
-    *   @param      stk [in][out] stk - pointer to the "Stack"
-    *   @param capacity [in] capacity - needed capacity
-    *   @param stk_name [in] stk_name - name   of the "Stack" variable
-    *   @param stk_func [in] stk_func - name   of the function where the "Stack" variable was declared
-    *   @param stk_file [in] stk_file - name   of the     file where the "Stack" variable was declared
-    *   @param stk_line [in] stk_line - number of the     line where the "Stack" variable was declared
-    *
-    *   @return bit-mask which encodes the errors
-    *
-    *   @note The parameter "stk_name" contains the '&' character before the real name because it obtains
-    *   @note by macros #define using the #-operator before "stk"-parameter which is the pointer. To get
-    *   @note the pointer user need to use &-operator.
-    */
+    #endif
+
+    #ifdef LOG_MMAP
+
+        log_mmap_close(&LOG_MMAP_FILE);
+
+    #else
+
+        fclose(LOG_STREAM);
+
+    #endif
+}
+
+/**
+*   @brief Opens log-file. Ckecks if opening is OK and in this case prints message in the log-file.
+*   @brief Uses atexit() to call CLOSE_LOG_STREAM() after program end.
+*   @brief In LOG_ASYNC mode starts the background thread which writes the log-file. A fork() child has no such thread
+*   @brief and writes its log-file synchronously.
+*   @brief In LOG_TRACE mode opens the binary trace instead (see "trace.h").
+*   @brief In LOG_MMAP mode maps the log-file, which is rotated every LOG_ROTATE_SIZE bytes (see "log_mmap.h").
+*
+*   @return 1 if checking is OK. Does abort() if an ERROR found.
+*/
+
+int OPEN_LOG_STREAM()
+{
+    #ifdef LOG_TRACE
+
+        LOG_STREAM = trace_open(TRACE_FILE_NAME, sizeof(Stack_elem), (unsigned char) POISON_BYTE, log_tab_num);
+
+    #elif defined(LOG_MMAP)
+
+        int is_open = log_mmap_open(&LOG_MMAP_FILE, LOG_FILE_NAME, LOG_ROTATE_SIZE, LOG_ROTATE_KEEP);
+
+        assert(is_open);
+        (void) is_open;
+
+    #else
+
+        LOG_STREAM = fopen(LOG_FILE_NAME, "w");
+
+    #endif
+
+    #ifndef LOG_MMAP
+
+        assert(LOG_STREAM != nullptr);
+
+    #endif
+
+    #ifdef LOG_ASYNC
+
+        LOG_RING.buf = (char *) calloc(LOG_RING_SIZE, sizeof(char));
+        assert(LOG_RING.buf != nullptr);
 
-    static unsigned _StackCtor(Stack *stk, int capacity, const char *stk_name,
-                                                  const char *stk_func,
-                                                  const char *stk_file, const int stk_line)
+        pthread_mutex_init(&LOG_RING.lock,      nullptr);
+        pthread_cond_init (&LOG_RING.not_empty, nullptr);
+        pthread_cond_init (&LOG_RING.not_full,  nullptr);
+
+        int thread_err = pthread_create(&LOG_RING.writer, nullptr, log_writer, nullptr);
+        assert(thread_err == 0);
+        (void) thread_err;
+
+        LOG_RING.is_writer = 1;
+
+        pthread_atfork(log_fork_prepare, log_fork_parent, log_fork_child);
+
+    #elif !defined(LOG_MMAP)
+
+        setvbuf(LOG_STREAM,   nullptr, _IONBF, 0);
+
+    #endif
+
+    #ifdef LOG_MMAP
+
+        log_printf("\"%s\" OPENING IS OK\n\n", LOG_FILE_NAME); // every file has its own head with <pre>
+
+    #else
+
+        log_printf("<pre>\n""\"%s\" OPENING IS OK\n\n", LOG_FILE_NAME);
+
+    #endif
+
+    atexit(CLOSE_LOG_STREAM);
+    return 1;
+}
+
+int  _OPEN_CLOSE_LOG_STREAM = OPEN_LOG_STREAM();
+
+void log_message(COLOR col, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+
+    log_printf("<font color=%s>", COLOR_NAMES[col]);
+    log_vprintf(fmt, ap);
+    log_printf("</font>");
+
+    va_end(ap);
+}
+
+#ifdef STACK_DUMPING
+
+    void log_func_end(const char *function_name, unsigned err)
     {
-        log_dumping_ctor(stk, capacity, stk_name,
-                                        stk_func,
-                                        stk_file,
-                                        stk_line);
+        log_tab_pop();
 
-        unsigned err = 0;
+        #ifdef LOG_TRACE
 
-        if (stk == nullptr)
+            trace_event(TRACE_FUNC_END, nullptr, trace_string_id(function_name), err);
+
+        #else
+
+            log_message(USUAL, "%s returns %d\n\n%s", function_name, err, TAB_SHIFT);
+
+            if (LOG_CONTEXT.tab_num == 0)
+                log_commit(LOG_CONTEXT.stage_len); // the outermost call is over, its lines go to the log-file together
+
+        #endif
+    }
+
+    void log_stack_elem(const Stack_elem *var)
+    {
+        unsigned char current_byte_value = 0;
+        unsigned char is_poison = 1;
+
+        for (size_t i = 0; i < sizeof(Stack_elem); ++i)
         {
-            log_func_end(__PRETTY_FUNCTION__, err);
-            return err;
+            current_byte_value = *((const unsigned char *) var + i);
+
+            if (current_byte_value != (unsigned char) POISON_BYTE)
+                is_poison = 0;
+
+            log_message(BLUE, "%x", current_byte_value);
         }
 
-        if (stk->is_Ctor == 1)
-            make_bit_true(&err, STACK_ALREADY_CTOR);
+        if (is_poison)
+            log_message(POISON_COLOR, "(POISON)");
+    }
+
+    void log_make_dump(Stack *stk, const char *current_file,
+                                   const char *current_func,
+                                   int         current_line)
+    {
+        log_message(BLUE, "\n%sERROR occurred at:\n"
+                          "             %sFILE: %s\n"
+                          "             %sFUNC: %s\n"
+                          "             %sLINE: %d\n\n%s", TAB_SHIFT, TAB_SHIFT, current_file, TAB_SHIFT, current_func, TAB_SHIFT, current_line, TAB_SHIFT);    
 
-        if (err != STACK_OK)
+        if (stk == nullptr)
         {
-            StackDump(stk, err, __FILE__, __PRETTY_FUNCTION__, __LINE__);
+            log_printf("Stack[nullptr]\n%s", TAB_SHIFT);
+            return;
+        }
 
-            log_func_end(__PRETTY_FUNCTION__, err);
-            return err;
+        if (stk->info.variable_name == nullptr) stk->info.variable_name = "nullptr";
+        if (stk->info.file_name     == nullptr) stk->info.file_name     = "nullptr";
+        if (stk->info.function_name == nullptr) stk->info.function_name = "nullptr";
+
+        if (stk->info.variable_name == (const char *) POISON_NAME) stk->info.variable_name = "POISON_NAME";
+        if (stk->info.file_name     == (const char *) POISON_NAME) stk->info.file_name     = "POISON_NAME";
+        if (stk->info.function_name == (const char *) POISON_NAME) stk->info.function_name = "POISON_NAME";
+
+        log_message(BLUE, "Stack[%p] \"%s\" was constructed at\n%s"
+                          "file: \"%s\"\n%s"
+                          "func: \"%s\"\n%s"
+                          "line: \"%d\"\n%s"
+                          "{\n%s"
+                          "\tsize     = %u\n%s"
+                          "\tcapacity = %u\n%s", stk, stk->info.variable_name, TAB_SHIFT,
+                                                   stk->info.file_name, TAB_SHIFT, stk->info.function_name, TAB_SHIFT, stk->info.string_number, TAB_SHIFT,
+                                                   TAB_SHIFT, stk->size, TAB_SHIFT, stk->capacity, TAB_SHIFT);
+        if (stk->data == nullptr)
+        {
+            log_message(BLUE, "\tdata[nullptr]\n%s}\n%s", TAB_SHIFT, TAB_SHIFT);
+            return;
         }
 
-        stk->is_Ctor = 1;
-        stk->size    = 0;
+        if (stk->data == (Stack_elem *) POISON_DATA)
+        {
+            log_message(BLUE, "\tdata");
+            log_message(POISON_COLOR, "[POISON_DATA]");
+            log_message(BLUE, "\n%s}\n%s", TAB_SHIFT, TAB_SHIFT);
+            return;
+        }
 
-        stk->info.variable_name = stk_name + 1; // add 1 to skip the '&' character
-        stk->info.function_name = stk_func;
-        stk->info.file_name     = stk_file;
-        stk->info.string_number = stk_line;
+        #ifdef CANARY_PROTECTION
 
-        capacity = (capacity < 0) ? 0 : capacity;
+            unsigned left = 0, right = 0;
 
-        #ifdef CANARY_PROTECTION
+            StackCheckCanary(stk, &left, &right);
 
-            unsigned *temp_data_store = (unsigned *) calloc(1, capacity * sizeof(Stack_elem) + 8);
+            if (left == LEFT_CANARY)
+            {
+                log_message(BLUE,  "\tleft_canary  = %16u", left);
+                log_message(GREEN, "(OK)\n%s",         TAB_SHIFT);
+            }
+            else
+            {
+                log_message(BLUE,  "\tleft_canary  = %16u", left);
+                log_message(RED,   "(ERROR)\n%s",      TAB_SHIFT);
+            }
 
-            if (temp_data_store == nullptr)
+            if (right == RIGHT_CANARY)
+            {
+                log_message(BLUE,  "\tright_canary = %16u", right);
+                log_message(GREEN, "(OK)\n%s",          TAB_SHIFT);
+            }
+            else
             {
-                stk->data        = nullptr;
+                log_message(BLUE, "\tright_canary = %16u", right);
+                log_message(RED,  "(ERROR)\n%s",       TAB_SHIFT);
+            }
 
-                make_bit_true(&err, MEMORY_LIMIT_EXCEEDED);
-                StackDump(stk, err, __FILE__, __PRETTY_FUNCTION__, __LINE__);
+        #endif
 
-                log_func_end(__PRETTY_FUNCTION__, err);
-                return err;
+        #ifdef HASH_PROTECTION
+
+            unsigned good_hash = CheckHash(stk->data, StackPoisonedEnd(stk) * sizeof(Stack_elem), stk->hash_val);
+
+            if (good_hash)
+            {
+                log_message(BLUE,  "\thash_val = %llx", stk->hash_val);
+                log_message(GREEN, "(OK)\n%s",            TAB_SHIFT);
             }
             else
             {
-                stk->data        = (Stack_elem *) (temp_data_store + 1);
-                stk->capacity    = capacity;
-
-                *temp_data_store = (unsigned)  LEFT_CANARY;
-                 temp_data_store = (unsigned *) (stk->data + stk->capacity);
-                *temp_data_store = (unsigned) RIGHT_CANARY;
+                log_message(BLUE, "\thash_val = %llx", stk->hash_val);
+                log_message(RED,  "(ERROR)\n%s",         TAB_SHIFT);
             }
 
+        #endif
+
+        #ifdef STACK_STATS
+
+            log_message(BLUE, "\tstats\n%s"
+                              "\t{\n%s"
+                              "\t\tpushes        = %zu\n%s"
+                              "\t\tpops          = %zu\n%s"
+                              "\t\treallocs_up   = %zu\n%s"
+                              "\t\treallocs_down = %zu\n%s"
+                              "\t\trealloc_bytes = %zu\n%s"
+                              "\t\tmax_size      = %zu\n%s"
+                              "\t\tverifies      = %zu (%llu ns)\n%s"
+                              "\t\tverify_fails  = %zu\n%s"
+                              "\t\thash_recounts = %zu\n%s"
+                              "\t}\n%s", TAB_SHIFT, TAB_SHIFT,
+                                         stk->stats.pushes,        TAB_SHIFT,
+                                         stk->stats.pops,          TAB_SHIFT,
+                                         stk->stats.reallocs_up,   TAB_SHIFT,
+                                         stk->stats.reallocs_down, TAB_SHIFT,
+                                         stk->stats.realloc_bytes, TAB_SHIFT,
+                                         stk->stats.max_size,      TAB_SHIFT,
+                                         stk->stats.verifies,      stk->stats.verify_ns, TAB_SHIFT,
+                                         stk->stats.verify_fails,  TAB_SHIFT,
+                                         stk->stats.hash_recounts, TAB_SHIFT, TAB_SHIFT);
+
+        #endif
+
+        log_message(BLUE, "\tdata[%p]\n%s\t{\n%s", stk->data, TAB_SHIFT, TAB_SHIFT);
+
+        #ifdef POISON_WATERMARK
+
+            log_message(BLUE, "\tpoisoned = %u\n%s", (unsigned) stk->poisoned, TAB_SHIFT);
+
+        #endif
+
+        for (size_t data_counter = 0; data_counter < StackPoisonedEnd(stk); ++data_counter)
+        {
+            log_printf((data_counter < stk->size) ? "\t*" : "\t ");
+
+            log_message(BLUE, "[%d] = ", data_counter);
+
+            log_stack_elem(stk->data + data_counter);
+
+            log_printf("\n%s", TAB_SHIFT);
+        }
+
+        if (StackPoisonedEnd(stk) < stk->capacity)
+            log_message(BLUE, "\t [%d..%d] not touched\n%s", (int) StackPoisonedEnd(stk), (int) stk->capacity - 1, TAB_SHIFT);
+
+        log_message(BLUE, "\t}\n%s}\n%s", TAB_SHIFT, TAB_SHIFT);
+    }
+
+    void log_dumping_ctor(Stack *stk, const int capacity, const char *stk_name,
+                                                          const char *stk_func,
+                                                          const char *stk_file, const int stk_line)
+    {
+        if (stk_name == nullptr) stk_name = "nullptr";
+        if (stk_func == nullptr) stk_func = "nullptr";
+        if (stk_file == nullptr) stk_file = "nullptr";
+
+        log_message(USUAL, "(dumping)_StackCtor(stk = %p, capacity = %d,\n%s"
+                           "stk_name = \"%s\"\n%s"
+                           "stk_func = \"%s\"\n%s"
+                           "stk_file = \"%s\"\n%s"
+                           "stk_line = %d)\n\n%s\t",
+                                                stk,      capacity,       TAB_SHIFT,
+                            stk_name, TAB_SHIFT,
+                            stk_func, TAB_SHIFT,
+                            stk_file, TAB_SHIFT,
+                            stk_line, TAB_SHIFT);
+        log_tab_push();
+    }
+
+    void log_push(Stack *stk, const Stack_elem push_val)
+    {
+        #ifdef LOG_TRACE
+
+            trace_event(TRACE_PUSH, stk, 0, 0, 0, 0, &push_val, sizeof(Stack_elem));
+
         #else
 
-            if (capacity)
-            {
-                stk->capacity = capacity;
+            log_printf(TRACE_FORMAT_PUSH_BEGIN, stk);
 
-                stk->data     = (Stack_elem *) calloc(capacity, sizeof(Stack_elem));
+            log_stack_elem(&push_val);
 
-                if (stk->data == nullptr)
-                {
-                    make_bit_true(&err, MEMORY_LIMIT_EXCEEDED);
-                    StackDump(stk, err, __FILE__, __PRETTY_FUNCTION__, __LINE__);
+            log_printf(TRACE_FORMAT_PUSH_END, TAB_SHIFT);
 
-                    log_func_end(__PRETTY_FUNCTION__, err);
-                    return err;
-                }
-            }
         #endif
 
-        if (stk->capacity)
-            FillPoison(stk->data, sizeof(Stack_elem), 0, capacity, (unsigned char) POISON_BYTE);
+        log_tab_push();
+    }
 
-        #ifdef HASH_PROTECTION
+    void log_pop(Stack *stk, const Stack_elem *front_val)
+    {
+        #ifdef LOG_TRACE
+
+            trace_event(TRACE_POP, stk, (uint64_t) (uintptr_t) front_val);
+
+        #else
 
-            stk->hash_val = get_hash(stk->data, stk->capacity * sizeof(Stack_elem));
+            log_printf(TRACE_FORMAT_POP, stk, front_val, TAB_SHIFT);
 
         #endif
 
-        Stack_assert(stk, &err);
+        log_tab_push();
+    }
 
-        log_func_end(__PRETTY_FUNCTION__, STACK_OK);
-        return (unsigned) STACK_OK;
+    void log_push_n(Stack *stk, const Stack_elem *push_vals, const size_t num)
+    {
+        #ifdef LOG_TRACE
+
+            trace_event(TRACE_PUSH_N, stk, (uint64_t) (uintptr_t) push_vals, num);
+
+        #else
+
+            log_printf(TRACE_FORMAT_PUSH_N, stk, push_vals, (unsigned long) num, TAB_SHIFT);
+
+        #endif
+
+        log_tab_push();
     }
 
-#endif
+    void log_pop_n(Stack *stk, const Stack_elem *front_vals, const size_t num)
+    {
+        #ifdef LOG_TRACE
 
-/**
-*   @brief Check if "stk" is invalid. Makes the bit-mask which encodes the errors. A set bit means the error.
-*   @brief Names of the erros are in the "enum _StackError".
-*
-*   @param stk [in] stk - pointer to the "Stack"
-*
-*   @return bit-mask which encodes the errors
-*/
+            trace_event(TRACE_POP_N, stk, (uint64_t) (uintptr_t) front_vals, num);
 
-static unsigned StackVerify(Stack *stk)
-{
-    fprintf(LOG_STREAM, "StackVerify(stk = %p)\n\n%s",
-                                     stk, TAB_SHIFT);
-    TAB_SHIFT[TAB_NUM++] = '\t';
+        #else
+
+            log_printf(TRACE_FORMAT_POP_N, stk, front_vals, (unsigned long) num, TAB_SHIFT);
+
+        #endif
+
+        log_tab_push();
+    }
+
+    void log_reserve(Stack *stk, const size_t capacity)
+    {
+        #ifdef LOG_TRACE
+
+            trace_event(TRACE_RESERVE, stk, capacity);
+
+        #else
+
+            log_printf(TRACE_FORMAT_RESERVE, stk, (unsigned long) capacity, TAB_SHIFT);
+
+        #endif
+
+        log_tab_push();
+    }
+
+    void log_shrink_to_fit(Stack *stk)
+    {
+        #ifdef LOG_TRACE
+
+            trace_event(TRACE_SHRINK_TO_FIT, stk);
+
+        #else
+
+            log_printf(TRACE_FORMAT_SHRINK_TO_FIT, stk, TAB_SHIFT);
+
+        #endif
+
+        log_tab_push();
+    }
+
+    void log_verify(Stack *stk)
+    {
+        #ifdef LOG_TRACE
+
+            trace_event(TRACE_VERIFY, stk);
+
+        #else
+
+            log_printf(TRACE_FORMAT_VERIFY, stk, TAB_SHIFT);
+
+        #endif
+
+        log_tab_push();
+    }
+
+    void log_realloc(Stack *stk, const int condition)
+    {
+        #ifdef LOG_TRACE
+
+            trace_event(TRACE_REALLOC, stk, (uint64_t) condition);
+
+        #else
+
+            log_printf(TRACE_FORMAT_REALLOC, stk, condition, TAB_SHIFT);
+
+        #endif
+
+        log_tab_push();
+    }
+
+    void log_save(Stack *stk, const char *file_name)
+    {
+        log_message(USUAL, "StackSave(stk = %p, file_name = \"%s\")\n\n%s", stk, file_name, TAB_SHIFT);
+        log_tab_push();
+    }
+
+    void log_load(Stack *stk, const char *file_name)
+    {
+        log_message(USUAL, "StackLoad(stk = %p, file_name = \"%s\")\n\n%s", stk, file_name, TAB_SHIFT);
+        log_tab_push();
+    }
+
+    void log_persist_open(Stack *stk, const char *file_name)
+    {
+        log_message(USUAL, "StackPersistOpen(stk = %p, file_name = \"%s\")\n\n%s", stk, file_name, TAB_SHIFT);
+        log_tab_push();
+    }
+
+    void log_persist_repair(Stack *stk, const size_t committed_size)
+    {
+        log_message(BLUE, "torn state of the file is rolled back: size %lu -> %lu\n\n%s",
+                          (unsigned long) committed_size, (unsigned long) stk->size, TAB_SHIFT);
+    }
+
+    void log_sync(Stack *stk)
+    {
+        log_message(USUAL, "StackSync(stk = %p)\n\n%s", stk, TAB_SHIFT);
+        log_tab_push();
+    }
+
+    void log_dtor(Stack *stk)
+    {
+        #ifdef LOG_TRACE
+
+            trace_event(TRACE_DTOR, stk);
+
+        #else
+
+            log_printf(TRACE_FORMAT_DTOR, stk, TAB_SHIFT);
+
+        #endif
+
+        log_tab_push();
+    }
+
+    void log_fill_poison(void *fillable_elem, const size_t elem_size, const size_t left,
+                                                                      const size_t right, const unsigned char poison_val)
+    {
+        #ifdef LOG_TRACE
+
+            trace_event(TRACE_FILL_POISON, fillable_elem, elem_size, left, right, poison_val);
+
+        #else
+
+            log_printf(TRACE_FORMAT_FILL_POISON, fillable_elem, (unsigned long) elem_size, TAB_SHIFT,
+                                                                 (unsigned long) left,      TAB_SHIFT,
+                                                                 (unsigned long) right, (unsigned) poison_val, TAB_SHIFT);
+
+        #endif
+
+        log_tab_push();
+    }
+
+#else
+
+    /**
+    *   @brief Without STACK_DUMPING mode traced calls do nothing, so the compiler removes them.
+    */
+
+    static inline void log_func_end   (const char *, unsigned)                                    {}
+    static inline void log_push       (Stack *, const Stack_elem)                                  {}
+    static inline void log_pop        (Stack *, const Stack_elem *)                                {}
+    static inline void log_push_n     (Stack *, const Stack_elem *, const size_t)                  {}
+    static inline void log_pop_n      (Stack *, const Stack_elem *, const size_t)                  {}
+    static inline void log_reserve    (Stack *, const size_t)                                      {}
+    static inline void log_shrink_to_fit(Stack *)                                                  {}
+    static inline void log_verify     (Stack *)                                                    {}
+    static inline void log_realloc    (Stack *, const int)                                         {}
+    static inline void log_dtor       (Stack *)                                                    {}
+    static inline void log_save       (Stack *, const char *)                                      {}
+    static inline void log_load       (Stack *, const char *)                                      {}
+    static inline void log_persist_open  (Stack *, const char *)                                   {}
+    static inline void log_persist_repair(Stack *, const size_t)                                   {}
+    static inline void log_sync       (Stack *)                                                    {}
+    static inline void log_fill_poison(void *, const size_t, const size_t, const size_t, const unsigned char)     {}
+
+#endif
+
+#ifdef FLIGHT_RECORDER
+
+    /**
+    *   @brief Prints the flight recorder of "stk" from the oldest kept operation to the newest one. The time of every
+    *   @brief operation is counted from the beginning of the newest one.
+    */
+
+    void log_flight(const Stack *stk)
+    {
+        if (stk == nullptr)
+            return;
+
+        const FlightRecorder *flight = &stk->flight;
+        const FlightRecord   *newest = flight_get(flight, 0);
+
+        size_t kept = (flight->count < FLIGHT_RECORDS) ? (size_t) flight->count : FLIGHT_RECORDS;
+
+        log_message(BLUE, "\n%sflight recorder: last %zu of %" PRIu64 " operations\n%s", TAB_SHIFT, kept, flight->count,
+                                                                                          TAB_SHIFT);
+
+        for (size_t back = kept; back-- > 0; )
+        {
+            const FlightRecord *record = flight_get(flight, back);
+
+            double since_ns = (double) (int64_t) (record->ticks - newest->ticks) * latency_ns_per_tick();
+
+            log_message(BLUE, "\t[%4" PRIu64 "] %12.0f ns %-8s arg = %-20" PRIu64 " size %zu -> ",
+                              flight->count - 1 - back, since_ns,
+                              (record->op < FLIGHT_OPS_NUM) ? FLIGHT_OP_NAMES[record->op] : "?",
+                              record->arg, record->size_before);
+
+            if (record->size_after == FLIGHT_NOT_ENDED)
+                log_message(RED,  "?, capacity %zu -> ? (not ended)\n%s", record->cap_before, TAB_SHIFT);
+            else
+                log_message(BLUE, "%zu, capacity %zu -> %zu\n%s", record->size_after, record->cap_before,
+                                                                  record->cap_after, TAB_SHIFT);
+        }
+    }
+
+#endif
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/**
+*   @brief Counts the size (in bytes) of the elements store: "capacity" elements plus canaries in CANARY_PROTECTION mode.
+*
+*   @param capacity [in] capacity - number of elements
+*
+*   @return size of the store
+*/
+
+static inline size_t StackStoreSize(const size_t capacity)
+{
+    #ifdef CANARY_PROTECTION
+
+        return capacity * sizeof(Stack_elem) + 2 * sizeof(unsigned);
+
+    #else
+
+        return capacity * sizeof(Stack_elem);
+
+    #endif
+}
+
+/**
+*   @brief Counts the number of elements covered by the poison checks and the hash: "Stack.capacity", or the watermark
+*   @brief "Stack.poisoned" in POISON_WATERMARK mode.
+*
+*   @param stk [in] stk - pointer to the "Stack"
+*
+*   @return number of elements
+*/
+
+static inline size_t StackPoisonedEnd(const Stack *stk)
+{
+    #ifdef POISON_WATERMARK
+
+        return stk->poisoned;
+
+    #else
+
+        return stk->capacity;
+
+    #endif
+}
+
+#ifdef POISON_WATERMARK
+
+    /**
+    *   @brief Moves the watermark "Stack.poisoned" up to "end": poisons the elements [poisoned, end) and adds them
+    *   @brief to the hash in HASH_INCREMENTAL mode. Without HASH_INCREMENTAL the caller recounts the hash after
+    *   @brief the write anyway. Does nothing if "end" is under the watermark already.
+    *
+    *   @param stk [in][out] stk - pointer to the "Stack"
+    *   @param end [in]      end - needed watermark, must not be greater than "Stack.capacity"
+    *
+    *   @return nothing
+    */
+
+    static void StackPoisonUpTo(Stack *stk, const size_t end)
+    {
+        assert(stk != nullptr);
+        assert(end <= stk->capacity);
+
+        if (end <= stk->poisoned)
+            return;
+
+        FillPoison(stk->data, sizeof(Stack_elem), stk->poisoned, end, (unsigned char) POISON_BYTE);
+
+        #ifdef HASH_INCREMENTAL
+
+            StackHashResize(stk, stk->poisoned, end, hash_poly(stk->data + stk->poisoned,
+                                                               (end - stk->poisoned) * sizeof(Stack_elem)));
+
+        #endif
+
+        stk->poisoned = end;
+    }
+
+#endif
+
+/**
+*   @brief Works in 2 modes.
+*   @brief Checks if the variable is filled by "poison_val"     in the first  mode.
+*   @brief Checks if the variable doesn't have any poison bytes in the second mode.
+*
+*   @param _verifiable_elem [in] _verifiable_elem - pointer         to the variable to check
+*   @param        elem_size [in]        elem_size - size (in bytes) of the variable to check
+*   @param       poison_val [in]       poison_val - poison value to compare with
+*   @param             mode [in]             mode - mode of "PoisonCheck()"
+*
+*   @return In the first  mode: 1 if all bytes are     equal to "poison_value" and 0 else
+*   @return In the zero   mode: 1 if all bytes are not equal to "poison_value" and 0 else
+*/
+
+static unsigned PoisonCheck(void *_verifiable_elem, const size_t elem_size, const unsigned char poison_val,
+                                                                const unsigned char mode)
+{
+    assert(_verifiable_elem != nullptr);
+
+    size_t mismatch = mode ? poison_find_ne(_verifiable_elem, elem_size, poison_val) :
+                             poison_find_eq(_verifiable_elem, elem_size, poison_val);
+
+    return mismatch == elem_size;
+}
+
+/**
+*   @brief Looks for the first element of the segment [left, right) of the array "_verifiable_elem" which fails
+*   @brief "PoisonCheck()" in the same mode. The whole segment is scanned by one call of the vector kernel.
+*
+*   @param _verifiable_elem [in] _verifiable_elem - pointer to the first byte of the array to check
+*   @param        elem_size [in]        elem_size - size (in bytes) of the array's elements
+*   @param             left [in]             left - index of the checking segment beginning
+*   @param            right [in]            right - index of the checking segment ending
+*   @param       poison_val [in]       poison_val - poison value to compare with
+*   @param             mode [in]             mode - mode of "PoisonCheck()"
+*
+*   @return index of the first failed element or "right" if all elements are OK
+*/
+
+static size_t PoisonFind(void *_verifiable_elem, const size_t elem_size, const size_t left,
+                                                 const size_t right, const unsigned char poison_val,
+                                                                     const unsigned char mode)
+{
+    assert(_verifiable_elem != nullptr);
+
+    if (left >= right)
+        return right;
+
+    const char *segment = (const char *) _verifiable_elem + elem_size * left;
+    size_t      len     = elem_size * (right - left);
+
+    size_t mismatch = mode ? poison_find_ne(segment, len, poison_val) :
+                             poison_find_eq(segment, len, poison_val);
+
+    return left + mismatch / elem_size;
+}
+
+/**
+*   @brief Fills the segment [l, r) of the array "_fillable_elem" by "poison_val".
+*
+*   @param _fillable_elem [in] _fillable_elem - pointer to the first byte of the array to fill
+*   @param      elem_size [in]      elem_size - size (in bytes) of the array's elements
+*   @param           left [in]           left - index of the filling segment beginning
+*   @param          right [in]          right - index of the filling segment ending
+*   @param     poison_val [in]     poison_val - value to fill in
+*
+*   @return nothing
+*/
+
+static void FillPoison(void *_fillable_elem, const size_t elem_size, const size_t left,
+                                                              const size_t right, const unsigned char poison_val)
+{
+    log_fill_poison(_fillable_elem, elem_size, left, right, poison_val);
+
+    assert(_fillable_elem != nullptr);
+
+    char *fillable_elem = (char *) _fillable_elem;
+
+    poison_fill(fillable_elem + elem_size * left, elem_size * (right - left), poison_val);
+
+    log_func_end(__PRETTY_FUNCTION__, 0);
+}
+
+#ifdef CANARY_PROTECTION
+
+    /**
+    *   @brief Checks if canary protection of the "stack" is OK. Puts values of canaries in the "left_canary" and
+    *   @brief the "right_canary".
+    *
+    *   @param          stk [in]           stk - pointer to the "stack" to check the canary protection
+    *   @param  left_canary [out]  left_canary - pointer to the  left_canary value. In case of nullptr, value doesn't put
+    *   @param right_canary [out] right_canary - pointer to the right_canary value. In case of nullptr, value doesn't put
+    *
+    *   @return 0 if check failed and 0 else
+    */
+
+    static unsigned StackCheckCanary(Stack *stk, unsigned *const left_canary, unsigned *const right_canary)
+    {
+        assert(stk != nullptr);
+
+        unsigned  left = *(unsigned *) ((unsigned *)stk->data - 1);
+        unsigned right = *(unsigned *) (stk->data + stk->capacity);
+
+        unsigned ret = (left == (unsigned) LEFT_CANARY) && (right == (unsigned) RIGHT_CANARY);
+
+        if ( left_canary) * left_canary = left ;
+        if (right_canary) *right_canary = right;
+
+        return ret;
+    }
+
+#endif
+
+#ifdef HASH_PROTECTION
+
+    /**
+    *   @brief Counts the hash_value for the variable of any type by the algorithm chosen at compile time:
+    *   @brief HASH_CRC32C, HASH_MUL64 or djb2 if none of them is defined (see "stack_hash.h").
+    *
+    *   @param _data_store [in] _data_store - pointer to the first byte of the variable to hash
+    *   @param   elem_size [in]   elem_size - size (in bytes)           of the variable to hash
+    *
+    *   @return hash_value
+    */
+
+    static unsigned long long get_hash(void *_data_store, const size_t elem_size)
+    {
+        assert(_data_store != nullptr || elem_size == 0); // "Stack" without canaries has no store until the first push
+
+        #if   defined(HASH_CRC32C)
+
+            return hash_crc32c(_data_store, elem_size, HASH_START);
+
+        #elif defined(HASH_MUL64)
+
+            return hash_mul64 (_data_store, elem_size, HASH_START);
+
+        #else
+
+            return hash_djb2  (_data_store, elem_size, HASH_START);
+
+        #endif
+    }
+
+    /**
+    *   @brief Checks if the "hash_val" of any variable still equal to original hash.
+    *
+    *   @param _data_store [in] _data_store - pointer to the first byte of the variable to check
+    *   @param   elem_size [in]   elem_size - size (in bytes)           of the variable to check
+    *   @param    hash_val [in]    hash_val - hash value to compare with
+    *
+    *   @return true-value if the "hash_val" is right and false-value else
+    */
+
+    static unsigned CheckHash(void *_data_store, const size_t elem_size, const unsigned long long hash_val)
+    {
+        assert(_data_store != nullptr);
+
+        unsigned long long     old_hash = hash_val;
+        unsigned long long current_hash = get_hash(_data_store, elem_size);
+
+        unsigned ret = (old_hash == current_hash);
+
+        return ret;
+    }
+
+    /**
+    *   @brief Counts the "Stack.hash_val" over the whole "Stack.data" (up to the watermark in POISON_WATERMARK mode)
+    *   @brief from scratch.
+    *   @brief In HASH_INCREMENTAL mode also resets the "Stack.hash_pow".
+    *
+    *   @param stk [in][out] stk - pointer to the "Stack"
+    *
+    *   @return nothing
+    */
+
+    static void StackHashRecount(Stack *stk)
+    {
+        assert(stk != nullptr);
+
+        stk->hash_val = get_hash(stk->data, StackPoisonedEnd(stk) * sizeof(Stack_elem));
+
+        STACK_STATS_ADD(stk, hash_recounts, 1);
+
+        #ifdef HASH_INCREMENTAL
+
+            stk->hash_pow = hash_power(HASH_BASE, (StackPoisonedEnd(stk) - stk->size) * sizeof(Stack_elem));
+
+        #endif
+    }
+
+#endif
+
+#ifdef HASH_INCREMENTAL
+
+    /**
+    *   @brief Raises "base" to the power "exp" modulo 2^64.
+    *
+    *   @param base [in] base - base   of the power
+    *   @param  exp [in]  exp - degree of the power
+    *
+    *   @return base^exp
+    */
+
+    static unsigned long long hash_power(unsigned long long base, size_t exp)
+    {
+        unsigned long long ret = 1;
+
+        while (exp)
+        {
+            if (exp & 1) ret *= base;
+
+            base *= base;
+            exp >>= 1;
+        }
+
+        return ret;
+    }
+
+    /**
+    *   @brief Counts the inverse of the odd number modulo 2^64 by Newton's iterations.
+    *   @brief Every iteration doubles the number of right low bits, the start value is right in 3 low bits.
+    *
+    *   @param odd_val [in] odd_val - odd number to inverse
+    *
+    *   @return number "ret" such that odd_val * ret = 1 (modulo 2^64)
+    */
+
+    static unsigned long long hash_inverse(const unsigned long long odd_val)
+    {
+        unsigned long long ret = odd_val;
+
+        for (int counter = 0; counter < 5; ++counter)
+            ret *= 2 - odd_val * ret;
+
+        return ret;
+    }
+
+    /**
+    *   @brief "get_hash()" is the polynomial hash, so the byte with number "i" of "Stack.data" gets into the hash with
+    *   @brief the weight HASH_BASE^(capacity * sizeof(Stack_elem) - 1 - i).
+    *   @brief HASH_ELEM_STEP     - multiplier between weights of neighboring elements
+    *   @brief HASH_ELEM_STEP_INV - inverse multiplier
+    */
+
+    const unsigned long long HASH_ELEM_STEP     = hash_power  (HASH_BASE, sizeof(Stack_elem));
+    const unsigned long long HASH_ELEM_STEP_INV = hash_inverse(HASH_ELEM_STEP);
+
+    /**
+    *   @brief Counts the polynomial of "len" bytes: sum of bytes[i] * HASH_BASE^(len - 1 - i) modulo 2^64.
+    *   @brief The difference of polynomials of a range before and after the change is the change of "get_hash()"
+    *   @brief divided by the weight of the last byte of the range.
+    *
+    *   @param bytes [in] bytes - pointer to the first byte
+    *   @param   len [in]   len - number of bytes
+    *
+    *   @return polynomial of the bytes
+    */
+
+    static unsigned long long hash_poly(const void *bytes, const size_t len)
+    {
+        assert(bytes != nullptr);
+
+        const unsigned char *byte = (const unsigned char *) bytes;
+
+        unsigned long long ret = 0;
+
+        for (size_t counter = 0; counter < len; ++counter)
+        {
+            ret = ret * HASH_BASE + byte[counter];
+        }
+
+        return ret;
+    }
+
+    /**
+    *   @brief Updates "Stack.hash_val" in O(num * sizeof(Stack_elem)) after the change of "num" elements on the top border of "Stack".
+    *   @brief In the push mode the changed elements are "Stack.data[Stack.size .. Stack.size + num)" (before the size increment),
+    *   @brief in the pop  mode the changed elements are "Stack.data[Stack.size .. Stack.size + num)" (after  the size decrement).
+    *   @brief The result is equal to "get_hash()" over the whole "Stack.data", so "CheckHash()" in "StackVerify()" still works.
+    *
+    *   @param      stk [in][out]      stk - pointer to the "Stack"
+    *   @param old_poly [in]      old_poly - "hash_poly()" of the changed elements before the change
+    *   @param new_poly [in]      new_poly - "hash_poly()" of the changed elements after  the change
+    *   @param      num [in]           num - number of the changed elements
+    *   @param  is_push [in]       is_push - mode of "StackHashUpdateTop()"
+    *
+    *   @return nothing
+    */
+
+    static void StackHashUpdateTop(Stack *stk, const unsigned long long old_poly, const unsigned long long new_poly,
+                                               const size_t             num,      const int                is_push)
+    {
+        assert(stk != nullptr);
+
+        if (is_push) stk->hash_pow *= (num == 1) ? HASH_ELEM_STEP_INV : hash_power(HASH_ELEM_STEP_INV, num);
+
+        stk->hash_val += (new_poly - old_poly) * stk->hash_pow;
+
+        if (!is_push) stk->hash_pow *= (num == 1) ? HASH_ELEM_STEP     : hash_power(HASH_ELEM_STEP,     num);
+    }
+
+    /**
+    *   @brief Updates "Stack.hash_val" in O(log) after the hashed part of "Stack.data" changes from "old_end" elements
+    *   @brief to "new_end" ones (the capacity change or the watermark move). The hashed part is the prefix of the bigger
+    *   @brief one, so "get_hash()" of the bigger part is equal to "get_hash()" of the smaller one multiplied by the weight
+    *   @brief of the tail plus "hash_poly()" of the tail.
+    *
+    *   @param       stk [in][out]       stk - pointer to the "Stack"
+    *   @param   old_end [in]        old_end - number of hashed elements before the change
+    *   @param   new_end [in]        new_end - number of hashed elements after  the change
+    *   @param tail_poly [in]      tail_poly - "hash_poly()" of the added or removed elements
+    *
+    *   @return nothing
+    */
+
+    static void StackHashResize(Stack *stk, const size_t old_end, const size_t new_end, const unsigned long long tail_poly)
+    {
+        assert(stk != nullptr);
+
+        if (new_end > old_end)
+        {
+            const unsigned long long tail_weight = hash_power(HASH_ELEM_STEP, new_end - old_end);
+
+            stk->hash_val  = stk->hash_val * tail_weight + tail_poly;
+            stk->hash_pow *= tail_weight;
+        }
+        else
+        {
+            const unsigned long long tail_weight_inv = hash_power(HASH_ELEM_STEP_INV, old_end - new_end);
+
+            stk->hash_val  = (stk->hash_val - tail_poly) * tail_weight_inv;
+            stk->hash_pow *= tail_weight_inv;
+        }
+    }
+
+#endif
+
+#ifdef STACK_ERROR_DUMP
+
+    #define Stack_assert(stk_ptr, err)                                                          \
+            if ((*err = StackVerify(stk_ptr)))                                                  \
+            {                                                                                   \
+                StackDump(stk_ptr, *err, __FILE__, __PRETTY_FUNCTION__, __LINE__);              \
+                                                                                                \
+                log_func_end(__PRETTY_FUNCTION__, *err);                                        \
+                return *err;                                                                    \
+            }
+#else
+
+    #define Stack_assert(stk_ptr, err)                                                          \
+            if ((*err = StackVerify(stk_ptr)))                                                  \
+            {                                                                                   \
+                log_func_end(__PRETTY_FUNCTION__, *err);                                        \
+                return *err;                                                                    \
+            }
+
+#endif
+
+#ifdef STACK_DUMPING
+
+    #define StackCtor(stk_name, capacity)                                                       \
+           _StackCtor(stk_name, capacity, #stk_name, __PRETTY_FUNCTION__, __FILE__, __LINE__)
+
+    #define StackCtorAlloc(stk_name, capacity, allocator)                                       \
+           _StackCtor(stk_name, capacity, #stk_name, __PRETTY_FUNCTION__, __FILE__, __LINE__, allocator)
+
+    #define StackLoad(stk_name, file_name)                                                      \
+           _StackLoad(stk_name, file_name, #stk_name, __PRETTY_FUNCTION__, __FILE__, __LINE__)
+
+    #define StackPersistOpen(stk_name, file_name, capacity, sync, sync_period)                  \
+           _StackPersistOpen(stk_name, file_name, capacity, sync, sync_period,                  \
+                             #stk_name, __PRETTY_FUNCTION__, __FILE__, __LINE__)
+
+#else
+
+    #define StackCtor(stk_name, capacity)                                                       \
+           _StackCtor(stk_name, capacity, nullptr, nullptr, nullptr, 0)
+
+    #define StackCtorAlloc(stk_name, capacity, allocator)                                       \
+           _StackCtor(stk_name, capacity, nullptr, nullptr, nullptr, 0, allocator)
+
+    #define StackLoad(stk_name, file_name)                                                      \
+           _StackLoad(stk_name, file_name, nullptr, nullptr, nullptr, 0)
+
+    #define StackPersistOpen(stk_name, file_name, capacity, sync, sync_period)                  \
+           _StackPersistOpen(stk_name, file_name, capacity, sync, sync_period,                  \
+                             nullptr, nullptr, nullptr, 0)
+
+#endif
+
+#ifdef STACK_ERROR_DUMP
+
+    /**
+    *   @brief Prints all information about "Stack" variable in the log-file and flushes it.
+    *   @brief In FLIGHT_RECORDER mode prints the last operations of the "Stack" too. Without STACK_DUMPING mode
+    *   @brief it is the only text of the log-file: the errors and the last operations.
+    *
+    *   @param          stk [in]          stk - pointer to the "Stack" variable
+    *   @param          err [in]          err - bit-mask which encodes the errors from "enum _StackError"
+    *   @param current_file [in] current_file - name   of the file, where "StackDump()" called
+    *   @param current_func [in] current_func - name   of the func, where "StackDump()" called
+    *   @param current_file [in] current_line - number of the line, where "StackDump()" called
+    *
+    *   @return nothing
+    */
+
+    static void StackDump(Stack *stk, const unsigned err, const char *current_file,
+                                                   const char *current_func,
+                                                   int         current_line)
+    {
+        log_printf("StackDump(stk = %p, err = %u,\n%s"
+                   "                              current_file = \"%s\"\n%s"
+                   "                              current_func = \"%s\"\n%s"
+                   "                              current_line = %d)\n\n%s",
+                              stk,      err, TAB_SHIFT,
+                                                  current_file, TAB_SHIFT,
+                                                  current_func, TAB_SHIFT,
+                                                  current_line, TAB_SHIFT);
+        #ifdef STACK_DUMPING
+
+            log_tab_push();
+
+        #endif
+
+        err == 0 ? log_message(GREEN, "NO_ERRORS\n%s", TAB_SHIFT) : log_message(RED, "MESSAGE_ERRORS\n%s", TAB_SHIFT);
+
+        int error_numbers = sizeof(error_message) / sizeof(char *);
+
+        for (int i = 0; i < error_numbers; ++i)
+        {
+            if (err & (1 << i))
+                log_message(RED, error_message[i]);
+        }
+
+        #ifdef STACK_DUMPING
+
+            log_make_dump(stk, current_file,
+                               current_func,
+                               current_line);
+
+        #endif
+
+        #ifdef FLIGHT_RECORDER
+
+            log_flight(stk);
+
+        #endif
+
+        log_func_end(__PRETTY_FUNCTION__, 0);
+
+        log_flush(); // the dump must reach the disk even if the program is going to crash
+    }
+
+#endif
+
+/**
+*   @brief Stack constructor. In adittion to "capacity", it takes "struct _StackDeclaration" elements
+*   @brief (they are ignored without STACK_DUMPING mode).
+*   @brief Allocates memory for "Stack_elem *data" and fills them by poison.
+*   @brief The "Stack" must be initialized by nulls before.
+*   @brief Returns the bit-mask which encodes the errors. A set bit means the error.
+*   @brief Names of the erros are in the "enum _StackError".
+*
+*   @param      stk [in][out] stk - pointer to the "Stack"
+*   @param capacity [in] capacity - needed capacity
+*   @param stk_name [in] stk_name - name   of the "Stack" variable
+*   @param stk_func [in] stk_func - name   of the function where the "Stack" variable was declared
+*   @param stk_file [in] stk_file - name   of the     file where the "Stack" variable was declared
+*   @param stk_line [in] stk_line - number of the     line where the "Stack" variable was declared
+*   @param allocator [in] allocator - allocator of the elements store, STACK_DEFAULT_ALLOCATOR if it is nullptr
+*
+*   @return bit-mask which encodes the errors
+*
+*   @note The parameter "stk_name" contains the '&' character before the real name because it obtains
+*   @note by macros #define using the #-operator before "stk"-parameter which is the pointer. To get
+*   @note the pointer user need to use &-operator.
+*/
+
+static unsigned _StackCtor(Stack *stk, int capacity, const char *stk_name,
+                                              const char *stk_func,
+                                              const char *stk_file, const int stk_line,
+                                              const StackAllocator *allocator)
+{
+    #ifdef STACK_DUMPING
+
+        log_dumping_ctor(stk, capacity, stk_name,
+                                        stk_func,
+                                        stk_file,
+                                        stk_line);
+
+    #else
+
+        (void) stk_name;
+        (void) stk_func;
+        (void) stk_file;
+        (void) stk_line;
+
+    #endif
+
+    unsigned err = 0;
+
+    STACK_FLIGHT_BEGIN(stk, FLIGHT_CTOR, capacity); // the ring of the zeroed "Stack" is empty, so it needs no init
+
+    if (stk == nullptr)
+    {
+        log_func_end(__PRETTY_FUNCTION__, err);
+        return err;
+    }
+
+    if (stk->is_Ctor == 1)
+        make_bit_true(&err, STACK_ALREADY_CTOR);
+
+    if (err != STACK_OK)
+    {
+        #ifdef STACK_ERROR_DUMP
+
+            StackDump(stk, err, __FILE__, __PRETTY_FUNCTION__, __LINE__);
+
+        #endif
+
+        log_func_end(__PRETTY_FUNCTION__, err);
+        return err;
+    }
+
+    stk->is_Ctor   = 1;
+    stk->size      = 0;
+    stk->allocator = (allocator != nullptr) ? allocator : STACK_DEFAULT_ALLOCATOR;
+    stk->growth    = STACK_DEFAULT_GROWTH;
+    stk->reserved  = 0;
+
+    #ifdef STACK_STATS
+
+        stk->stats = {};
+
+    #endif
+
+    #ifdef STACK_LATENCY
+
+        stk->latency = {};
+
+    #endif
+
+    #ifdef GUARD_PROTECTION
+
+        stk->allocator = &STACK_GUARD_ALLOCATOR; // guard pages are made by the allocator, so others are ignored
+
+    #endif
+
+    #ifdef STACK_DUMPING
+
+        stk->info.variable_name = stk_name + 1; // add 1 to skip the '&' character
+        stk->info.function_name = stk_func;
+        stk->info.file_name     = stk_file;
+        stk->info.string_number = stk_line;
+
+    #endif
+
+    capacity = (capacity < 0) ? 0 : capacity;
+
+    #ifdef CANARY_PROTECTION
+
+        unsigned *temp_data_store = (unsigned *) stk->allocator->alloc(stk->allocator->ctx, StackStoreSize((size_t) capacity));
+
+        if (temp_data_store == nullptr)
+        {
+            stk->data        = nullptr;
+
+            make_bit_true(&err, MEMORY_LIMIT_EXCEEDED);
+
+            #ifdef STACK_ERROR_DUMP
+
+                StackDump(stk, err, __FILE__, __PRETTY_FUNCTION__, __LINE__);
+
+            #endif
+
+            log_func_end(__PRETTY_FUNCTION__, err);
+            return err;
+        }
+        else
+        {
+            stk->data        = (Stack_elem *) (temp_data_store + 1);
+            stk->capacity    = capacity;
+
+            *temp_data_store = (unsigned)  LEFT_CANARY;
+             temp_data_store = (unsigned *) (stk->data + stk->capacity);
+            *temp_data_store = (unsigned) RIGHT_CANARY;
+        }
+
+    #else
+
+        #ifdef GUARD_PROTECTION
+
+            const bool alloc_empty = true; // even the empty store is surrounded by the guard pages
+
+        #else
+
+            const bool alloc_empty = false;
+
+        #endif
+
+        if (capacity || alloc_empty)
+        {
+            stk->capacity = capacity;
+
+            stk->data     = (Stack_elem *) stk->allocator->alloc(stk->allocator->ctx, StackStoreSize((size_t) capacity));
+
+            if (stk->data == nullptr)
+            {
+                make_bit_true(&err, MEMORY_LIMIT_EXCEEDED);
+
+                #ifdef STACK_ERROR_DUMP
+
+                    StackDump(stk, err, __FILE__, __PRETTY_FUNCTION__, __LINE__);
+
+                #endif
+
+                log_func_end(__PRETTY_FUNCTION__, err);
+                return err;
+            }
+        }
+    #endif
+
+    #ifdef POISON_WATERMARK
+
+        stk->poisoned = 0;
+
+    #else
+
+        if (stk->capacity)
+            FillPoison(stk->data, sizeof(Stack_elem), 0, capacity, (unsigned char) POISON_BYTE);
+
+    #endif
+
+    #ifdef GUARD_INACTIVE
+
+        stk->guard_writable = (char *) (stk->data + stk->capacity);
+        StackGuardSync(stk, 0);
+
+    #endif
+
+    #ifdef GUARD_PROTECTION
+
+        StackGuardRegister(stk);
+
+    #endif
+
+    #ifdef HASH_PROTECTION
+
+        StackHashRecount(stk);
+
+    #endif
+
+    Stack_assert(stk, &err);
+
+    STACK_FLIGHT_END(stk);
+
+    log_func_end(__PRETTY_FUNCTION__, STACK_OK);
+    return (unsigned) STACK_OK;
+}
+
+/**
+*   @brief Check if "stk" is invalid. Makes the bit-mask which encodes the errors. A set bit means the error.
+*   @brief Names of the erros are in the "enum _StackError".
+*   @brief The depth of the check depends on the "Stack.verify_mode" (see "enum _VerifyMode").
+*
+*   @param stk [in] stk - pointer to the "Stack"
+*
+*   @return bit-mask which encodes the errors
+*/
+
+static unsigned StackVerify(Stack *stk)
+{
+    STACK_LATENCY_START();
+
+    log_verify(stk);
+
+    unsigned err = 0;
+
+    if (stk == nullptr)
+    {
+        make_bit_true(&err, STACK_NULLPTR);
+
+        log_func_end(__PRETTY_FUNCTION__, err);
+        return err;
+    }
+
+    if (!stk->is_Ctor)
+        make_bit_true(&err, STACK_NON_CTOR);
+
+    if (stk->data == (Stack_elem *) POISON_DATA)
+        make_bit_true(&err, ACTIVE_POISON_VALUES);
+
+    if ((int) stk->size < 0)
+        make_bit_true(&err, SIZE_INVALID);
+
+    if ((int) stk->capacity < 0)
+        make_bit_true(&err, CAPACITY_INVALID);
+
+    if (stk->size > stk->capacity)
+    {
+        make_bit_true(&err,     SIZE_INVALID);
+        make_bit_true(&err,  CAPACITY_INVALID);
+    }
+
+    if ((int) stk->capacity > 0 && stk->data == nullptr)
+        make_bit_true(&err, CAPACITY_INVALID);
+
+    if (stk->data == (Stack_elem *) POISON_DATA || stk->data == nullptr)
+    {
+        log_func_end(__PRETTY_FUNCTION__, err);
+        return err;
+    }
+
+    #ifdef STACK_STATS
+
+        const unsigned long long start_ns = stats_now_ns();
+
+    #endif
+
+    #ifdef CANARY_PROTECTION
+
+        if (!StackCheckCanary(stk))
+            make_bit_true(&err, CANARY_PROTECTION_FAILED);
+
+    #endif
+
+    ++stk->verify_counter;
+
+    unsigned char check_hash = 0;
+
+    switch (stk->verify_mode)
+    {
+        case VERIFY_META:
+            break;
+
+        case VERIFY_SAMPLED:
+            if (stk->verify_param > 1 && stk->verify_counter % stk->verify_param != 0)
+                break;
+            //fall through
+
+        case VERIFY_FULL:
+            err |= StackVerifyData(stk, 0, stk->capacity);
+            check_hash = 1;
+            break;
+
+        case VERIFY_WINDOW:
+        {
+            size_t window = (stk->verify_param == 0) ? 1 : stk->verify_param;
+
+            if (stk->verify_cursor >= stk->capacity)
+                stk->verify_cursor = 0;
+
+            size_t window_end = (stk->capacity - stk->verify_cursor < window) ? stk->capacity : stk->verify_cursor + window;
+
+            err |= StackVerifyData(stk, stk->verify_cursor, window_end);
+
+            stk->verify_cursor = window_end;
+            if (stk->verify_cursor == stk->capacity)
+            {
+                stk->verify_cursor = 0;
+                check_hash = 1;
+            }
+            break;
+        }
+
+        default:
+            err |= StackVerifyData(stk, 0, stk->capacity);
+            check_hash = 1;
+            break;
+    }
+
+    #ifdef HASH_PROTECTION
+
+        if (check_hash && !CheckHash(stk->data, StackPoisonedEnd(stk) * sizeof(Stack_elem), stk->hash_val))
+            make_bit_true(&err, HASH_PROTECTION_FAILED);
+
+        if (check_hash)
+            STACK_STATS_ADD(stk, hash_recounts, 1);
+
+    #else
+
+        (void) check_hash;
+
+    #endif
+
+    #ifdef STACK_STATS
+
+        StackStatsVerified(stk, err, start_ns);
+
+    #endif
+
+    STACK_LATENCY_RECORD(stk, LATENCY_VERIFY);
+
+    log_func_end(__PRETTY_FUNCTION__, err);
+    return err;
+}
+
+/**
+*   @brief Checks elements of the segment [left, right) of "Stack.data": active elements must not be poisoned,
+*   @brief non active elements must be poisoned. "right" must not be greater than "Stack.capacity".
+*   @brief In POISON_WATERMARK mode the elements above the watermark are not touched yet, so they are skipped.
+*
+*   @param   stk [in]   stk - pointer to the "Stack"
+*   @param  left [in]  left - index of the checking segment beginning
+*   @param right [in] right - index of the checking segment ending
+*
+*   @return bit-mask which encodes the errors from "enum _StackError"
+*/
+
+static unsigned StackVerifyData(Stack *stk, const size_t left, const size_t _right)
+{
+    assert(stk       != nullptr);
+    assert(stk->data != nullptr);
+    assert(_right    <= stk->capacity);
+
+    unsigned err = 0;
+
+    size_t right = (_right < StackPoisonedEnd(stk)) ? _right : StackPoisonedEnd(stk);
+
+    size_t active_end   = (stk->size < right) ? stk->size : right;
+    size_t active_begin = (left > stk->size) ? left : stk->size;
+
+    if (PoisonFind(stk->data, sizeof(Stack_elem), left, active_end, (unsigned char) POISON_BYTE,
+                                                                    (unsigned char) 0) != active_end)
+        make_bit_true(&err, ACTIVE_POISON_VALUES);
+
+    if (PoisonFind(stk->data, sizeof(Stack_elem), active_begin, right, (unsigned char) POISON_BYTE,
+                                                                       (unsigned char) 1) != right)
+        make_bit_true(&err, NON_ACTIVE_NON_POISON_VALUES);
+
+    return err;
+}
+
+#ifdef STACK_STATS
+
+    /**
+    *   @brief Copies the counters of the "Stack" usage (see "struct _StackStats") to "stats".
+    *
+    *   @param   stk [in]    stk - pointer to the "Stack"
+    *   @param stats [out] stats - pointer to the counters
+    *
+    *   @return bit-mask which encodes the errors from "enum _StackError"
+    */
+
+    static unsigned StackGetStats(const Stack *stk, StackStats *stats)
+    {
+        unsigned err = 0;
+
+        if (stk == nullptr)
+        {
+            make_bit_true(&err, STACK_NULLPTR);
+            return err;
+        }
+
+        if (!stk->is_Ctor)
+        {
+            make_bit_true(&err, STACK_NON_CTOR);
+            return err;
+        }
+
+        assert(stats != nullptr);
+
+        *stats = stk->stats;
+        return STACK_OK;
+    }
+
+    static unsigned long long stats_now_ns()
+    {
+        struct timespec now = {};
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        return (unsigned long long) now.tv_sec * 1000000000ull + (unsigned long long) now.tv_nsec;
+    }
+
+    /**
+    *   @brief Counts the "StackVerify()" call which started at "start_ns" and found "err".
+    */
+
+    static void StackStatsVerified(Stack *stk, const unsigned err, const unsigned long long start_ns)
+    {
+        ++stk->stats.verifies;
+        stk->stats.verify_ns += stats_now_ns() - start_ns;
+
+        if (err)
+            ++stk->stats.verify_fails;
+    }
+
+#endif
+
+#ifdef STACK_LATENCY
+
+    /**
+    *   @brief Copies the latency histograms of the "Stack" to "latency". The copy is the snapshot: it doesn't change
+    *   @brief with the next operations and may be merged with the snapshots of the other "Stack"s and threads.
+    *
+    *   @param     stk [in]      stk - pointer to the "Stack"
+    *   @param latency [out] latency - pointer to the histograms
+    *
+    *   @return bit-mask which encodes the errors from "enum _StackError"
+    */
+
+    static unsigned StackGetLatency(const Stack *stk, StackLatency *latency)
+    {
+        unsigned err = 0;
+
+        if (stk == nullptr)
+        {
+            make_bit_true(&err, STACK_NULLPTR);
+            return err;
+        }
+
+        if (!stk->is_Ctor)
+        {
+            make_bit_true(&err, STACK_NON_CTOR);
+            return err;
+        }
+
+        assert(latency != nullptr);
+
+        *latency = stk->latency;
+        return STACK_OK;
+    }
+
+    /**
+    *   @brief Adds the histograms of "src" to the histograms of the same operations of "dst".
+    */
+
+    static void StackLatencyMerge(StackLatency *dst, const StackLatency *src)
+    {
+        assert(dst != nullptr);
+        assert(src != nullptr);
+
+        for (int op = 0; op < LATENCY_OPS_NUM; ++op)
+            latency_merge(dst->ops + op, src->ops + op);
+    }
+
+    /**
+    *   @brief Prints p50, p99, p999 and the maximum of every operation which was recorded at least once.
+    */
+
+    static void StackLatencyPrint(FILE *stream, const StackLatency *latency)
+    {
+        assert(stream  != nullptr);
+        assert(latency != nullptr);
+
+        for (int op = 0; op < LATENCY_OPS_NUM; ++op)
+        {
+            if (latency->ops[op].count != 0)
+                latency_print(stream, LATENCY_OP_NAMES[op], latency->ops + op);
+        }
+    }
+
+#endif
+
+/**
+*   @brief Sets the level of "StackVerify()" for the "Stack" (see "enum _VerifyMode").
+*   @brief Can be called at any moment after the "Stack" construction. Unknown "mode" is rejected
+*   @brief with STACK_ARGUMENT_INVALID and the current mode is kept.
+*
+*   @param   stk [in][out]   stk - pointer to the "Stack"
+*   @param  mode [in]       mode - level of "StackVerify()"
+*   @param param [in]      param - period in VERIFY_SAMPLED mode and number of elements in VERIFY_WINDOW mode,
+*                                  ignored in other modes
+*
+*   @return bit-mask which encodes the errors from "enum _StackError"
+*/
+
+static unsigned StackSetVerifyMode(Stack *stk, const VerifyMode mode, const size_t param)
+{
+    unsigned err = 0;
+
+    if (stk == nullptr)
+    {
+        make_bit_true(&err, STACK_NULLPTR);
+        return err;
+    }
+
+    if (stk->is_Ctor != 1)
+    {
+        make_bit_true(&err, STACK_NON_CTOR);
+        return err;
+    }
+
+    if ((int) mode < VERIFY_FULL || (int) mode > VERIFY_WINDOW)
+    {
+        make_bit_true(&err, STACK_ARGUMENT_INVALID);
+        return err;
+    }
+
+    stk->verify_mode    = mode;
+    stk->verify_param   = param;
+    stk->verify_counter = 0;
+    stk->verify_cursor  = 0;
+
+    return STACK_OK;
+}
+
+/**
+*   @brief Add the element into the "Stack.data".
+*
+*   @param      stk [in][out] stk - pointer to the "Stack"
+*   @param push_val [in] push_val - value of element to put
+*
+*   @return bit-mask which encodes the errors from "enum _StackError"
+*/
+
+static unsigned StackPush(Stack *stk, const Stack_elem push_val)
+{
+    STACK_LATENCY_START();
+
+    log_push(stk, push_val);
+
+    STACK_FLIGHT_BEGIN(stk, FLIGHT_PUSH, flight_elem_arg(&push_val));
+
+    unsigned err = 0;
+    Stack_assert(stk, &err);
+
+    if (stk->size < stk->capacity)
+    {
+        #ifdef GUARD_INACTIVE
+
+            StackGuardSync(stk, stk->size + 1);
+
+        #endif
+
+        #ifdef POISON_WATERMARK
+
+            StackPoisonUpTo(stk, stk->size + 1);
+
+        #endif
+
+        #ifdef HASH_INCREMENTAL
+
+            const unsigned long long old_poly = hash_poly(stk->data + stk->size, sizeof(Stack_elem));
+
+        #endif
+
+        stk->data[stk->size++] = push_val;
+
+        STACK_STATS_PUSHED(stk, 1);
+
+        #ifdef HASH_PROTECTION
+
+            #ifdef HASH_INCREMENTAL
+
+                StackHashUpdateTop(stk, old_poly, hash_poly(stk->data + stk->size - 1, sizeof(Stack_elem)), 1, 1);
+
+            #else
+
+                StackHashRecount(stk);
+
+            #endif
+
+        #endif
+
+        Stack_assert(stk, &err);
+
+        STACK_PERSIST_COMMIT(stk);
+        STACK_LATENCY_RECORD(stk, LATENCY_PUSH);
+        STACK_FLIGHT_END(stk);
+
+        log_func_end(__PRETTY_FUNCTION__, STACK_OK);
+        return STACK_OK;
+    }
+
+    if (stk->size == stk->capacity)
+    {
+        err = StackRealloc(stk, 1);
+        if (err)
+        {
+            log_func_end(__PRETTY_FUNCTION__, err);
+            return err;
+        }
+    }
+
+    #ifdef GUARD_INACTIVE
+
+        StackGuardSync(stk, stk->size + 1);
+
+    #endif
+
+    #ifdef POISON_WATERMARK
+
+        StackPoisonUpTo(stk, stk->size + 1);
+
+    #endif
+
+    #ifdef HASH_INCREMENTAL
+
+        const unsigned long long old_poly = hash_poly(stk->data + stk->size, sizeof(Stack_elem));
+
+    #endif
+
+    stk->data[stk->size++] = push_val;
+
+    STACK_STATS_PUSHED(stk, 1);
+
+    #ifdef HASH_PROTECTION
+
+        #ifdef HASH_INCREMENTAL
+
+            StackHashUpdateTop(stk, old_poly, hash_poly(stk->data + stk->size - 1, sizeof(Stack_elem)), 1, 1);
+
+        #else
+
+            StackHashRecount(stk);
+
+        #endif
+
+    #endif
+
+    Stack_assert(stk, &err);
+
+    STACK_PERSIST_COMMIT(stk);
+    STACK_LATENCY_RECORD(stk, LATENCY_PUSH);
+    STACK_FLIGHT_END(stk);
+
+    log_func_end(__PRETTY_FUNCTION__, STACK_OK);
+    return STACK_OK;
+}
+
+/**
+*   @brief Deletes the front element of the "Stack.data". Puts the front element in variable
+*   @brief pointed by "front_val" before deliting.
+*   @brief "fron_val" is nullptr default. In this case "StackPop()" doesn't puts the front element.
+*
+*   @param       stk [in][out]   stk - pointer to the "Stack"
+*   @param front_val [out] front_val - pointer to the front element
+*
+*   @return bit-mask which encodes the errors from "enum _StackError"
+*/
+
+static unsigned StackPop(Stack *stk, Stack_elem *const front_val)
+{
+    STACK_LATENCY_START();
+
+    log_pop(stk, front_val);
+
+    STACK_FLIGHT_BEGIN(stk, FLIGHT_POP, 0);
+
+    unsigned err = 0;
+    Stack_assert(stk, &err);
+
+    if (stk->size == 0)
+    {
+        make_bit_true(&err, STACK_EMPTY);
+
+        #ifdef STACK_ERROR_DUMP
+
+            StackDump(stk, err, __FILE__, __PRETTY_FUNCTION__, __LINE__);
+
+        #endif
+
+        log_func_end(__PRETTY_FUNCTION__, err);
+        return err;
+    }
+
+    --stk->size;
+
+    #ifdef HASH_INCREMENTAL
+
+        const unsigned long long old_poly = hash_poly(stk->data + stk->size, sizeof(Stack_elem));
+
+    #endif
+
+    if (front_val != nullptr)
+        *front_val = stk->data[stk->size];
+
+    FillPoison(stk->data, sizeof(Stack_elem), stk->size, stk->size + 1, (unsigned char) POISON_BYTE);
+
+    STACK_STATS_ADD(stk, pops, 1);
+
+    #ifdef GUARD_INACTIVE
+
+        StackGuardSync(stk, stk->size);
+
+    #endif
+
+    #ifdef HASH_PROTECTION
+
+        #ifdef HASH_INCREMENTAL
+
+            StackHashUpdateTop(stk, old_poly, hash_poly(stk->data + stk->size, sizeof(Stack_elem)), 1, 0);
+
+        #else
+
+            StackHashRecount(stk);
+
+        #endif
+
+    #endif
+
+    Stack_assert(stk, &err);
+
+    err = StackRealloc(stk, 0);
+
+    if (!err)
+        STACK_PERSIST_COMMIT(stk);
+
+    STACK_LATENCY_RECORD(stk, LATENCY_POP);
+
+    if (!err)
+        STACK_FLIGHT_END(stk);
+
+    log_func_end(__PRETTY_FUNCTION__, err);
+    return err;
+}
+
+/**
+*   @brief Adds "num" elements from the array "push_vals" to the end of the "Stack.data", "push_vals[num - 1]" becomes the front.
+*   @brief Unlike "num" calls of "StackPush()" the capacity grows at most once, the elements are copied by one memcpy()
+*   @brief and "Stack" is verified and rehashed once per batch.
+*
+*   @param       stk [in][out]       stk - pointer to the "Stack"
+*   @param push_vals [in]      push_vals - pointer to the array of elements to push
+*   @param       num [in]            num - number of elements to push
+*
+*   @return bit-mask which encodes the errors from "enum _StackError"
+*/
+
+static unsigned StackPushN(Stack *stk, const Stack_elem *push_vals, const size_t num)
+{
+    STACK_LATENCY_START();
+
+    log_push_n(stk, push_vals, num);
+
+    STACK_FLIGHT_BEGIN(stk, FLIGHT_PUSH_N, num);
+
+    unsigned err = 0;
+    Stack_assert(stk, &err);
+
+    if (num == 0)
+    {
+        STACK_FLIGHT_END(stk);
+
+        log_func_end(__PRETTY_FUNCTION__, STACK_OK);
+        return STACK_OK;
+    }
+
+    assert(push_vals != nullptr);
+
+    // "stk->size + num" elements must not overflow the byte counts of the resize and memcpy()
+    if (num > SIZE_MAX / sizeof(Stack_elem) - stk->size)
+    {
+        make_bit_true(&err, MEMORY_LIMIT_EXCEEDED);
+
+        #ifdef STACK_ERROR_DUMP
+
+            StackDump(stk, err, __FILE__, __PRETTY_FUNCTION__, __LINE__);
+
+        #endif
+
+        log_func_end(__PRETTY_FUNCTION__, err);
+        return err;
+    }
+
+    if (stk->size + num > stk->capacity)
+    {
+        size_t future_capacity = StackGrowCapacity(stk, stk->size + num);
+
+        if (future_capacity == 0)
+            make_bit_true(&err, MEMORY_LIMIT_EXCEEDED);
+        else
+            err = StackResize(stk, future_capacity);
+
+        if (err)
+        {
+            log_func_end(__PRETTY_FUNCTION__, err);
+            return err;
+        }
+    }
+
+    #ifdef GUARD_INACTIVE
+
+        StackGuardSync(stk, stk->size + num);
+
+    #endif
+
+    #ifdef POISON_WATERMARK
+
+        StackPoisonUpTo(stk, stk->size + num);
+
+    #endif
+
+    #ifdef HASH_INCREMENTAL
+
+        const unsigned long long old_poly = hash_poly(stk->data + stk->size, num * sizeof(Stack_elem));
+
+    #endif
+
+    memcpy(stk->data + stk->size, push_vals, num * sizeof(Stack_elem));
+    stk->size += num;
+
+    STACK_STATS_PUSHED(stk, num);
+
+    #ifdef HASH_PROTECTION
+
+        #ifdef HASH_INCREMENTAL
+
+            StackHashUpdateTop(stk, old_poly, hash_poly(stk->data + stk->size - num, num * sizeof(Stack_elem)), num, 1);
+
+        #else
+
+            StackHashRecount(stk);
+
+        #endif
+
+    #endif
+
+    Stack_assert(stk, &err);
+
+    STACK_PERSIST_COMMIT(stk);
+    STACK_LATENCY_RECORD(stk, LATENCY_PUSH_N);
+    STACK_FLIGHT_END(stk);
+
+    log_func_end(__PRETTY_FUNCTION__, STACK_OK);
+    return STACK_OK;
+}
+
+/**
+*   @brief Deletes "num" front elements of the "Stack.data". Puts them in the array pointed by "front_vals" before deleting
+*   @brief in the order they lie in "Stack", so "StackPopN()" after "StackPushN()" returns the same array.
+*   @brief "front_vals" may be nullptr. In this case "StackPopN()" doesn't put the deleted elements.
+*   @brief If "Stack" contains less than "num" elements, nothing is deleted.
+*
+*   @param        stk [in][out]        stk - pointer to the "Stack"
+*   @param front_vals [out]     front_vals - pointer to the array of "num" elements
+*   @param        num [in]             num - number of elements to pop
+*
+*   @return bit-mask which encodes the errors from "enum _StackError"
+*/
+
+static unsigned StackPopN(Stack *stk, Stack_elem *front_vals, const size_t num)
+{
+    STACK_LATENCY_START();
+
+    log_pop_n(stk, front_vals, num);
+
+    STACK_FLIGHT_BEGIN(stk, FLIGHT_POP_N, num);
+
+    unsigned err = 0;
+    Stack_assert(stk, &err);
+
+    if (num > stk->size)
+    {
+        make_bit_true(&err, STACK_EMPTY);
+
+        #ifdef STACK_ERROR_DUMP
+
+            StackDump(stk, err, __FILE__, __PRETTY_FUNCTION__, __LINE__);
+
+        #endif
+
+        log_func_end(__PRETTY_FUNCTION__, err);
+        return err;
+    }
+
+    if (num == 0)
+    {
+        STACK_FLIGHT_END(stk);
+
+        log_func_end(__PRETTY_FUNCTION__, STACK_OK);
+        return STACK_OK;
+    }
+
+    stk->size -= num;
+
+    #ifdef HASH_INCREMENTAL
+
+        const unsigned long long old_poly = hash_poly(stk->data + stk->size, num * sizeof(Stack_elem));
+
+    #endif
+
+    if (front_vals != nullptr)
+        memcpy(front_vals, stk->data + stk->size, num * sizeof(Stack_elem));
+
+    FillPoison(stk->data, sizeof(Stack_elem), stk->size, stk->size + num, (unsigned char) POISON_BYTE);
+
+    STACK_STATS_ADD(stk, pops, num);
+
+    #ifdef GUARD_INACTIVE
+
+        StackGuardSync(stk, stk->size);
+
+    #endif
+
+    #ifdef HASH_PROTECTION
+
+        #ifdef HASH_INCREMENTAL
+
+            StackHashUpdateTop(stk, old_poly, hash_poly(stk->data + stk->size, num * sizeof(Stack_elem)), num, 0);
+
+        #else
+
+            StackHashRecount(stk);
+
+        #endif
+
+    #endif
+
+    Stack_assert(stk, &err);
+
+    err = StackRealloc(stk, 0);
+
+    if (!err)
+        STACK_PERSIST_COMMIT(stk);
+
+    STACK_LATENCY_RECORD(stk, LATENCY_POP_N);
+
+    if (!err)
+        STACK_FLIGHT_END(stk);
+
+    log_func_end(__PRETTY_FUNCTION__, err);
+    return err;
+}
+
+/**
+*   @brief Does a "Stack" memory reallocation. Can work in two modes. If "condition" is true, it allocates memory,
+*   @brief and else it frees the part of memory. New capacity is chosen by "Stack.growth" (see "struct _StackGrowth"),
+*   @brief by default capacity doubles when the "Stack" is full and becomes 2 * size when size is a quarter of capacity.
+*
+*   @param       stk [in][out]  stk - pointer to the "Stack"
+*   @param condition [in] condition - mode of "StackRealloc()"
+*
+*   @return bit-mask which encodes the errors from "enum _StackError"
+*/
+
+static unsigned StackRealloc(Stack *stk, const int condition)
+{
+    log_realloc(stk, condition);
+
+    unsigned err = 0;
+    Stack_assert(stk, &err);
+
+    size_t future_capacity = condition ? StackGrowCapacity(stk, stk->size + 1) : StackShrinkCapacity(stk);
+
+    if (condition && future_capacity == 0)
+    {
+        make_bit_true(&err, MEMORY_LIMIT_EXCEEDED);
+
+        #ifdef STACK_ERROR_DUMP
+
+            StackDump(stk, err, __FILE__, __PRETTY_FUNCTION__, __LINE__);
+
+        #endif
+
+        log_func_end(__PRETTY_FUNCTION__, err);
+        return err;
+    }
+
+    if (future_capacity == 0)
+    {
+        log_func_end(__PRETTY_FUNCTION__, STACK_OK);
+        return STACK_OK;
+    }
+
+    err = StackResize(stk, future_capacity);
+    if (err)
+    {
+        log_func_end(__PRETTY_FUNCTION__, err);
+        return err;
+    }
+
+    Stack_assert(stk, &err);
+
+    log_func_end(__PRETTY_FUNCTION__, STACK_OK);
+    return STACK_OK;
+}
+
+/**
+*   @brief Chooses the capacity for at least "needed" elements by "Stack.growth".
+*
+*   @param    stk [in]    stk - pointer to the "Stack"
+*   @param needed [in] needed - number of elements which must fit
+*
+*   @return new capacity or 0 if "needed" is more than "Stack.growth.max_capacity"
+*/
+
+static size_t StackGrowCapacity(const Stack *stk, const size_t needed)
+{
+    assert(stk != nullptr);
+
+    const StackGrowth *growth = &stk->growth;
+
+    size_t future_capacity = stk->capacity * growth->grow_percent / 100;
+
+    if (future_capacity <= stk->capacity)        future_capacity = stk->capacity + 1;
+    if (future_capacity <  growth->min_capacity) future_capacity = growth->min_capacity;
+    if (future_capacity <  needed)               future_capacity = needed;
+
+    if (growth->max_capacity != 0 && future_capacity > growth->max_capacity)
+        future_capacity = growth->max_capacity;
+
+    return (future_capacity < needed) ? 0 : future_capacity;
+}
+
+/**
+*   @brief Chooses the decreased capacity by "Stack.growth".
+*
+*   @param stk [in] stk - pointer to the "Stack"
+*
+*   @return new capacity or 0 if the capacity shouldn't change
+*/
+
+static size_t StackShrinkCapacity(const Stack *stk)
+{
+    assert(stk != nullptr);
+
+    const StackGrowth *growth = &stk->growth;
+
+    if (growth->shrink_at == 0 || stk->size == 0 || stk->capacity < growth->shrink_at * stk->size)
+        return 0;
+
+    size_t future_capacity = growth->shrink_to * stk->size;
+
+    if (future_capacity < stk->size)            future_capacity = stk->size;
+    if (future_capacity < growth->min_capacity) future_capacity = growth->min_capacity;
+    if (future_capacity < stk->reserved)        future_capacity = stk->reserved;
+
+    return (future_capacity < stk->capacity) ? future_capacity : 0;
+}
+
+/**
+*   @brief Sets the growth strategy of the "Stack" (see "struct _StackGrowth"). The capacity doesn't change until
+*   @brief the next "StackRealloc()".
+*
+*   @param    stk [in][out]    stk - pointer to the "Stack"
+*   @param growth [in]      growth - pointer to the strategy
+*
+*   @return bit-mask which encodes the errors from "enum _StackError"
+*/
+
+static unsigned StackSetGrowth(Stack *stk, const StackGrowth *growth)
+{
+    assert(growth != nullptr);
+
+    unsigned err = 0;
+
+    if (stk == nullptr)
+    {
+        make_bit_true(&err, STACK_NULLPTR);
+        return err;
+    }
+
+    if (stk->is_Ctor != 1)
+    {
+        make_bit_true(&err, STACK_NON_CTOR);
+        return err;
+    }
+
+    stk->growth = *growth;
+
+    return STACK_OK;
+}
+
+/**
+*   @brief Makes the capacity not less than "capacity" in one reallocation, so the next pushes don't call "StackRealloc()".
+*   @brief Pops don't shrink the "Stack" below the reserved capacity until "StackShrinkToFit()".
+*
+*   @param      stk [in][out]      stk - pointer to the "Stack"
+*   @param capacity [in]      capacity - needed capacity
+*
+*   @return bit-mask which encodes the errors from "enum _StackError"
+*/
+
+static unsigned StackReserve(Stack *stk, const size_t capacity)
+{
+    log_reserve(stk, capacity);
+
+    STACK_FLIGHT_BEGIN(stk, FLIGHT_RESERVE, capacity);
+
+    unsigned err = 0;
+    Stack_assert(stk, &err);
+
+    if (stk->growth.max_capacity != 0 && capacity > stk->growth.max_capacity)
+    {
+        make_bit_true(&err, MEMORY_LIMIT_EXCEEDED);
+
+        #ifdef STACK_ERROR_DUMP
+
+            StackDump(stk, err, __FILE__, __PRETTY_FUNCTION__, __LINE__);
+
+        #endif
+
+        log_func_end(__PRETTY_FUNCTION__, err);
+        return err;
+    }
+
+    if (capacity > stk->reserved)
+        stk->reserved = capacity;
+
+    if (capacity > stk->capacity)
+    {
+        err = StackResize(stk, capacity);
+        if (err)
+        {
+            log_func_end(__PRETTY_FUNCTION__, err);
+            return err;
+        }
+    }
+
+    Stack_assert(stk, &err);
+
+    STACK_PERSIST_COMMIT(stk);
+    STACK_FLIGHT_END(stk);
+
+    log_func_end(__PRETTY_FUNCTION__, STACK_OK);
+    return STACK_OK;
+}
+
+/**
+*   @brief Decreases the capacity to the size (to one element if the "Stack" is empty) and drops the reserved capacity.
+*
+*   @param stk [in][out] stk - pointer to the "Stack"
+*
+*   @return bit-mask which encodes the errors from "enum _StackError"
+*/
+
+static unsigned StackShrinkToFit(Stack *stk)
+{
+    log_shrink_to_fit(stk);
+
+    STACK_FLIGHT_BEGIN(stk, FLIGHT_SHRINK, 0);
+
+    unsigned err = 0;
+    Stack_assert(stk, &err);
+
+    stk->reserved = 0;
+
+    size_t future_capacity = (stk->size != 0) ? stk->size : 1;
+
+    if (future_capacity < stk->capacity)
+    {
+        err = StackResize(stk, future_capacity);
+        if (err)
+        {
+            log_func_end(__PRETTY_FUNCTION__, err);
+            return err;
+        }
+    }
+
+    Stack_assert(stk, &err);
+
+    STACK_PERSIST_COMMIT(stk);
+    STACK_FLIGHT_END(stk);
+
+    log_func_end(__PRETTY_FUNCTION__, STACK_OK);
+    return STACK_OK;
+}
+
+/**
+*   @brief Reallocates the elements store by "Stack.allocator". The store adopted from the snapshot file by
+*   @brief STACK_MAP_ALLOCATOR moves to STACK_DEFAULT_ALLOCATOR at the first resize and "Stack.allocator" changes too,
+*   @brief so the next resizes don't make a mapping of their own every time.
+*
+*   @param      stk [in][out]      stk - pointer to the "Stack"
+*   @param    store [in]         store - pointer to the store (with the left canary in CANARY_PROTECTION mode)
+*   @param old_size [in]      old_size - size of the store in bytes
+*   @param new_size [in]      new_size - needed size of the store in bytes
+*
+*   @return pointer to the new store or nullptr if the memory is over (the old store stays then)
+*/
+
+static void *StackStoreRealloc(Stack *stk, void *store, const size_t old_size, const size_t new_size)
+{
+    assert(stk != nullptr);
+
+    #ifdef __unix__
+
+        if (stk->allocator == &STACK_MAP_ALLOCATOR)
+        {
+            const StackAllocator *allocator = STACK_DEFAULT_ALLOCATOR;
+
+            void *new_store = allocator->alloc(allocator->ctx, new_size);
+            if (new_store == nullptr)
+                return nullptr;
+
+            if (store != nullptr) // the empty "Stack" without canaries is saved without the store
+            {
+                memcpy(new_store, store, (old_size < new_size) ? old_size : new_size);
+                stk->allocator->free(stk->allocator->ctx, store, old_size);
+            }
+
+            stk->allocator = allocator;
+
+            return new_store;
+        }
+
+    #endif
+
+    return stk->allocator->realloc(stk->allocator->ctx, store, old_size, new_size);
+}
+
+/**
+*   @brief Moves "Stack.data" to the memory of "future_capacity" elements, which must not be less than "Stack.size".
+*   @brief Fills only the added elements by poison (the old non active ones are poisoned already) and updates the hash
+*   @brief in O(|future_capacity - capacity|) in HASH_INCREMENTAL mode. Doesn't verify the "Stack".
+*   @brief In POISON_WATERMARK mode the added elements are not touched at all and the watermark only goes down.
+*
+*   @param             stk [in][out]             stk - pointer to the "Stack"
+*   @param future_capacity [in]      future_capacity - needed capacity
+*
+*   @return bit-mask which encodes the errors from "enum _StackError"
+*/
+
+static unsigned StackResize(Stack *stk, const size_t future_capacity)
+{
+    assert(stk != nullptr);
+    assert(future_capacity >= stk->size);
+
+    STACK_LATENCY_START();
+
+    unsigned err = 0;
+
+    const size_t old_end = StackPoisonedEnd(stk);
+
+    #if defined(POISON_WATERMARK)
+
+        const size_t new_end = (future_capacity < old_end) ? future_capacity : old_end;
+
+    #elif defined(HASH_INCREMENTAL)
+
+        const size_t new_end = future_capacity;
+
+    #endif
+
+    #ifdef HASH_INCREMENTAL
+
+        unsigned long long tail_poly = 0;
+
+        if (new_end < old_end)
+            tail_poly = hash_poly(stk->data + new_end, (old_end - new_end) * sizeof(Stack_elem));
+
+    #endif
+
+    #ifdef CANARY_PROTECTION
+
+        int *temp_data_store = (int *) StackStoreRealloc(stk, (unsigned *) (stk->data) - 1,
+                                                         StackStoreSize(stk->capacity),
+                                                         StackStoreSize(future_capacity));
+
+    #else
+
+        Stack_elem *temp_data_store = (Stack_elem *) StackStoreRealloc(stk, stk->data,
+                                                                       StackStoreSize(stk->capacity),
+                                                                       StackStoreSize(future_capacity));
+
+    #endif
+
+    if (temp_data_store == nullptr)
+    {
+        make_bit_true(&err, MEMORY_LIMIT_EXCEEDED);
+
+        #ifdef STACK_ERROR_DUMP
+
+            StackDump(stk, err, __FILE__, __PRETTY_FUNCTION__, __LINE__);
+
+        #endif
+
+        return err;
+    }
+
+    #ifdef CANARY_PROTECTION
+
+        stk->data = (Stack_elem *) (temp_data_store + 1);
+
+        *(int *) (stk->data + future_capacity) = RIGHT_CANARY;
+
+    #else
+
+        stk->data = temp_data_store;
+
+    #endif
+
+    STACK_STATS_ADD(stk, realloc_bytes, StackStoreSize((future_capacity < stk->capacity) ? future_capacity : stk->capacity));
+
+    if (future_capacity > stk->capacity) STACK_STATS_ADD(stk, reallocs_up,   1);
+    else                                 STACK_STATS_ADD(stk, reallocs_down, 1);
+
+    stk->capacity = future_capacity;
+
+    #ifdef GUARD_INACTIVE
+
+        stk->guard_writable = (char *) (stk->data + stk->capacity); // the new store is writable entirely
+
+    #endif
+
+    #ifdef POISON_WATERMARK
+
+        stk->poisoned = new_end; // the added elements are poisoned by the pushes which reach them
+
+    #else
+
+        if (future_capacity > old_end)
+            FillPoison(stk->data, sizeof(Stack_elem), old_end, future_capacity, (unsigned char) POISON_BYTE);
+
+    #endif
+
+    #ifdef HASH_PROTECTION
+
+        #ifdef HASH_INCREMENTAL
+
+            if (new_end > old_end)
+                tail_poly = hash_poly(stk->data + old_end, (new_end - old_end) * sizeof(Stack_elem));
+
+            StackHashResize(stk, old_end, new_end, tail_poly);
+
+        #else
+
+            StackHashRecount(stk);
+
+        #endif
+
+    #endif
+
+    #ifdef GUARD_INACTIVE
+
+        StackGuardSync(stk, stk->size);
+
+    #endif
+
+    STACK_LATENCY_RECORD(stk, LATENCY_RESIZE);
+
+    return STACK_OK;
+}
+
+#ifdef GUARD_PROTECTION
+
+    /**
+    *   @brief Constructed "Stack"s in GUARD_PROTECTION mode. The SIGSEGV handler looks here for the "Stack" whose guard
+    *   @brief page is touched. A "Stack" which doesn't fit in is still guarded, but its fault isn't dumped.
+    */
+
+    const int GUARD_STACKS_MAX = 1 << 10;
+
+    Stack           *GUARD_STACKS[GUARD_STACKS_MAX] = {};
+    struct sigaction GUARD_OLD_ACTION               = {};
+    bool             GUARD_HANDLER_SET              = false;
+
+    /**
+    *   @brief Adds the "Stack" to GUARD_STACKS, sets "guard_sigsegv_handler()" on the first call.
+    *
+    *   @param stk [in] stk - pointer to the "Stack"
+    *
+    *   @return nothing
+    */
+
+    static void StackGuardRegister(Stack *stk)
+    {
+        if (!GUARD_HANDLER_SET)
+        {
+            struct sigaction action = {};
+
+            action.sa_sigaction = guard_sigsegv_handler;
+            action.sa_flags     = SA_SIGINFO;
+            sigemptyset(&action.sa_mask);
+
+            GUARD_HANDLER_SET = (sigaction(SIGSEGV, &action, &GUARD_OLD_ACTION) == 0);
+        }
+
+        for (int counter = 0; counter < GUARD_STACKS_MAX; ++counter)
+        {
+            if (GUARD_STACKS[counter] == nullptr)
+            {
+                GUARD_STACKS[counter] = stk;
+                return;
+            }
+        }
+    }
+
+    static void StackGuardUnregister(Stack *stk)
+    {
+        for (int counter = 0; counter < GUARD_STACKS_MAX; ++counter)
+        {
+            if (GUARD_STACKS[counter] == stk)
+            {
+                GUARD_STACKS[counter] = nullptr;
+                return;
+            }
+        }
+    }
+
+    /**
+    *   @brief SIGSEGV handler. If the fault address is in a guard page (or in the write-protected non active elements
+    *   @brief in GUARD_INACTIVE mode) of a registered "Stack", dumps it with GUARD_PROTECTION_FAILED.
+    *   @brief Then restores the previous handler and returns, so the instruction faults again and the program
+    *   @brief dies as it would without the handler. Costs nothing until the fault.
+    */
+
+    static void guard_sigsegv_handler(int, siginfo_t *info, void *)
+    {
+        char *addr = (char *) info->si_addr;
+
+        for (int counter = 0; counter < GUARD_STACKS_MAX; ++counter)
+        {
+            Stack *stk = GUARD_STACKS[counter];
+
+            if (stk == nullptr || stk->data == nullptr)
+                continue;
+
+            const size_t store_size = StackStoreSize(stk->capacity);
+
+            char *left  = guard_left (stk->data, store_size);
+            char *right = guard_right(stk->data, store_size);
+
+            bool is_hit = (left  <= addr && addr < left  + guard_page_size()) ||
+                          (right <= addr && addr < right + guard_page_size());
+
+            #ifdef GUARD_INACTIVE
+
+                is_hit = is_hit || (stk->guard_writable <= addr && addr < right);
+
+            #endif
+
+            if (!is_hit)
+                continue;
+
+            unsigned err = 0;
+            make_bit_true(&err, GUARD_PROTECTION_FAILED);
+
+            #ifdef STACK_DUMPING
+
+                log_message(RED, "fault address %p, elements [%p, %p)\n", addr, stk->data, right);
+
+                StackDump(stk, err, __FILE__, __PRETTY_FUNCTION__, __LINE__);
+
+            #else
+
+                fprintf(stderr, "Stack %p: %s, fault address %p\n", (void *) stk, error_message[GUARD_PROTECTION_FAILED],
+                                                                    addr);
+
+            #endif
+
+            break;
+        }
+
+        sigaction(SIGSEGV, &GUARD_OLD_ACTION, nullptr);
+        GUARD_HANDLER_SET = false;
+    }
+
+#endif
+
+#ifdef GUARD_INACTIVE
+
+    /**
+    *   @brief Makes the pages of the first "active" elements writable and the rest of the "Stack.data" read-only.
+    *   @brief Does nothing while the border stays in the same page, so only a push or pop crossing the page border
+    *   @brief calls mprotect(). Non active elements sharing the page with the last active one stay writable.
+    *
+    *   @param    stk [in][out]    stk - pointer to the "Stack"
+    *   @param active [in]      active - number of elements which must be writable
+    *
+    *   @return nothing
+    */
+
+    static void StackGuardSync(Stack *stk, const size_t active)
+    {
+        const uintptr_t page_size = guard_page_size();
+
+        char *writable = (char *) (((uintptr_t) (stk->data + active) + page_size - 1) & ~(page_size - 1));
+
+        if (writable == stk->guard_writable)
+            return;
+
+        if (writable > stk->guard_writable)
+            mprotect(stk->guard_writable, (size_t) (writable - stk->guard_writable), PROT_READ | PROT_WRITE);
+        else
+            mprotect(writable, (size_t) (stk->guard_writable - writable), PROT_READ);
+
+        stk->guard_writable = writable;
+    }
+
+#endif
+
+/**
+*   @brief Stack destructor. Frees memory pointed by "Stack.data".
+*   @brief The persistent "Stack" (see "StackPersistOpen()") closes its file, the elements stay in it.
+*   @brief Fill all "Stack" elements besides the "Stack.is_Ctor" by poison. "Stack.is_Ctor" becomes equal to zero.
+*
+*   @param stk [in][out] stk - pointer to the "Stack"
+*
+*   @return bit-mask which encodes the errors from "enum _StackError"
+*/
+
+static unsigned StackDtor(Stack *stk)
+{
+    log_dtor(stk);
+
+    STACK_FLIGHT_BEGIN(stk, FLIGHT_DTOR, 0);
+
+    unsigned err = 0;
+    Stack_assert(stk, &err);
+
+    #ifdef GUARD_PROTECTION
+
+        StackGuardUnregister(stk);
+
+    #endif
+
+    if (stk->data != nullptr)
+    {
+        #ifdef CANARY_PROTECTION
+
+            stk->allocator->free(stk->allocator->ctx, (unsigned *) stk->data - 1, StackStoreSize(stk->capacity));
+
+        #else
+
+            stk->allocator->free(stk->allocator->ctx, stk->data, StackStoreSize(stk->capacity));
+
+        #endif
+
+        stk->data = (Stack_elem *) POISON_DATA;
+    }
+
+    #ifdef STACK_PERSISTENT
+
+        else if (stk->persist != nullptr)
+            persist_close(stk->persist); // the empty "Stack" without canaries has no store to free
+
+    #endif
+
+    stk->size     = POISON_SIZE;
+    stk->capacity = POISON_CAPACITY;
+    stk->is_Ctor  = 0;
+
+    #ifdef STACK_DUMPING
+
+        stk->info.variable_name  = stk->info.function_name = stk->info.file_name = (const char *) POISON_NAME;
+        stk->info.string_number = POISON_STRING;
+
+    #endif
+
+    #ifdef HASH_PROTECTION
+
+        stk->hash_val = 0;
+
+    #endif
+
+    #ifdef STACK_PERSISTENT
+
+        stk->persist = nullptr; // the file is closed by the free() of its allocator
+
+    #endif
+
+    STACK_FLIGHT_END(stk);
+
+    log_func_end(__PRETTY_FUNCTION__, STACK_OK);
+    return STACK_OK;
+}
+
+/*------------------------------------------------------SNAPSHOT------------------------------------------------------*/
+
+/**
+*   @brief Returns the pointer to the first byte of the elements store (the left canary in CANARY_PROTECTION mode).
+*/
+
+static inline void *StackStore(const Stack *stk)
+{
+    #ifdef CANARY_PROTECTION
+
+        return (unsigned *) stk->data - 1;
+
+    #else
+
+        return stk->data;
+
+    #endif
+}
+
+/**
+*   @brief Writes the snapshot of "Stack" into the file "file_name" (see "stack_file.h" for the format). The snapshot
+*   @brief is written into "<file_name>.tmp" which is renamed to "file_name" at the end, so the file is never half
+*   @brief written: it is either the old snapshot or the new one.
+*
+*   @param       stk [in]       stk - pointer to the "Stack"
+*   @param file_name [in] file_name - name of the snapshot file
+*
+*   @return bit-mask which encodes the errors from "enum _StackError"
+*/
+
+static unsigned StackSave(Stack *stk, const char *file_name)
+{
+    log_save(stk, file_name);
+
+    STACK_FLIGHT_BEGIN(stk, FLIGHT_SAVE, 0);
+
+    unsigned err = 0;
+    Stack_assert(stk, &err);
+
+    assert(file_name != nullptr);
+
+    StackFileHeader header = {};
+
+    memcpy(header.magic, STACK_FILE_MAGIC, sizeof(STACK_FILE_MAGIC));
+
+    header.version     = STACK_FILE_VERSION;
+    header.header_size = sizeof(StackFileHeader);
+    header.elem_size   = sizeof(Stack_elem);
+    header.flags       = STACK_FILE_FLAGS;
+    header.size        = stk->size;
+    header.capacity    = stk->capacity;
+    header.poisoned    = StackPoisonedEnd(stk);
+    header.store_size  = (stk->data != nullptr) ? StackStoreSize(stk->capacity) : 0;
+
+    #ifdef HASH_PROTECTION
+
+        header.hash_val = stk->hash_val;
+
+    #endif
+
+    #ifdef CANARY_PROTECTION
+
+        StackCheckCanary(stk, &header.left_canary, &header.right_canary);
+
+    #endif
+
+    char tmp_name[FILENAME_MAX] = "";
+    snprintf(tmp_name, sizeof(tmp_name), "%s.tmp", file_name);
+
+    FILE *file = fopen(tmp_name, "wb");
+
+    int is_written = (file != nullptr)                                                                     &&
+                     fwrite(&header, sizeof(header), 1, file) == 1                                         &&
+                     (header.store_size == 0 || fwrite(StackStore(stk), header.store_size, 1, file) == 1) &&
+                     fflush(file) == 0;
+
+    #ifdef __unix__
+
+        is_written = is_written && fsync(fileno(file)) == 0; // the rename must not get ahead of the data
+
+    #endif
+
+    if (file != nullptr && fclose(file) != 0)
+        is_written = 0;
+
+    if (!is_written || rename(tmp_name, file_name) != 0)
+    {
+        remove(tmp_name);
+
+        make_bit_true(&err, STACK_FILE_FAILED);
+
+        #ifdef STACK_ERROR_DUMP
+
+            StackDump(stk, err, __FILE__, __PRETTY_FUNCTION__, __LINE__);
+
+        #endif
+
+        log_func_end(__PRETTY_FUNCTION__, err);
+        return err;
+    }
+
+    STACK_FLIGHT_END(stk);
+
+    log_func_end(__PRETTY_FUNCTION__, STACK_OK);
+    return STACK_OK;
+}
+
+/**
+*   @brief Checks the header of the snapshot against the modes and "Stack_elem" of this build.
+*
+*   @return 1 if the snapshot can be loaded, 0 else
+*/
+
+static int StackFileHeaderFits(const StackFileHeader *header, const size_t file_size)
+{
+    if (!stack_file_header_ok(header, file_size))
+        return 0;
+
+    if (header->elem_size != sizeof(Stack_elem) || header->flags != STACK_FILE_FLAGS)
+        return 0;
+
+    if (header->capacity > ((uint64_t) SIZE_MAX - 2 * sizeof(unsigned)) / sizeof(Stack_elem))
+        return 0;
+
+    #ifndef POISON_WATERMARK
+
+        if (header->poisoned != header->capacity)
+            return 0;
+
+    #endif
+
+    #ifdef CANARY_PROTECTION
+
+        if (header->left_canary != (unsigned) LEFT_CANARY || header->right_canary != (unsigned) RIGHT_CANARY)
+            return 0;
+
+    #endif
+
+    #if defined(CANARY_PROTECTION) || defined(GUARD_PROTECTION)
+
+        return header->store_size == StackStoreSize((size_t) header->capacity);
+
+    #else
+
+        // "Stack" without canaries has no store until the first push
+        return header->store_size == StackStoreSize((size_t) header->capacity) ||
+              (header->store_size == 0 && header->capacity == 0);
+
+    #endif
+}
+
+/**
+*   @brief Constructs "Stack" from the snapshot "file_name" written by "StackSave()". Use it as the "StackLoad()"
+*   @brief macro, like "StackCtor()".
+*
+*   @brief On unix the store is not copied: the file is mapped privately (copy on write, the file never changes)
+*   @brief and the mapping becomes "Stack.data", STACK_MAP_ALLOCATOR frees it, the first change of the capacity moves
+*   @brief the store to STACK_DEFAULT_ALLOCATOR. In GUARD_PROTECTION mode and on other systems the store is read into the
+*   @brief allocated memory.
+*
+*   @brief The loaded "Stack" is checked in full regardless of "Stack.verify_mode": the canaries, the hash and
+*   @brief the poison of the non active elements. If a check fails, "Stack" is dumped, released and left not
+*   @brief constructed, so it can be loaded or constructed again.
+*
+*   @param       stk [out]       stk - pointer to the "Stack", it must be initialized by nulls
+*   @param file_name [in]  file_name - name of the snapshot file
+*   @param  stk_name [in]   stk_name - name   of the "Stack" variable
+*   @param  stk_func [in]   stk_func - name   of the function where the "Stack" variable was declared
+*   @param  stk_file [in]   stk_file - name   of the     file where the "Stack" variable was declared
+*   @param  stk_line [in]   stk_line - number of the     line where the "Stack" variable was declared
+*
+*   @return bit-mask which encodes the errors from "enum _StackError"
+*/
+
+static unsigned _StackLoad(Stack *stk, const char *file_name, const char *stk_name,
+                                                              const char *stk_func,
+                                                              const char *stk_file, const int stk_line)
+{
+    log_load(stk, file_name);
+
+    unsigned err = 0;
+
+    if (stk == nullptr)
+    {
+        make_bit_true(&err, STACK_NULLPTR);
+
+        log_func_end(__PRETTY_FUNCTION__, err);
+        return err;
+    }
+
+    assert(file_name != nullptr);
+
+    if (stk->is_Ctor == 1)
+    {
+        make_bit_true(&err, STACK_ALREADY_CTOR);
+
+        #ifdef STACK_ERROR_DUMP
+
+            StackDump(stk, err, __FILE__, __PRETTY_FUNCTION__, __LINE__);
+
+        #endif
+
+        log_func_end(__PRETTY_FUNCTION__, err);
+        return err;
+    }
+
+    STACK_FLIGHT_BEGIN(stk, FLIGHT_LOAD, 0);
+
+    StackFileHeader header    = {};
+    long            file_size = -1;
+
+    FILE *file = fopen(file_name, "rb");
+
+    if (file != nullptr && fseek(file, 0, SEEK_END) == 0)
+        file_size = ftell(file);
+
+    if (file_size < 0 || fseek(file, 0, SEEK_SET) != 0 || fread(&header, sizeof(header), 1, file) != 1)
+        make_bit_true(&err, (file_size < (long) sizeof(header) && file_size >= 0) ? STACK_FILE_INVALID : STACK_FILE_FAILED);
+
+    else if (!StackFileHeaderFits(&header, (size_t) file_size))
+        make_bit_true(&err, STACK_FILE_INVALID);
+
+    void *store = nullptr;
+
+    #if defined(__unix__) && !defined(GUARD_PROTECTION)
+
+        const StackAllocator *allocator = &STACK_MAP_ALLOCATOR;
+
+        if (!err && header.store_size != 0)
+        {
+            char *map = (char *) mmap(nullptr, header.header_size + header.store_size, PROT_READ | PROT_WRITE,
+                                      MAP_PRIVATE, fileno(file), 0);
+
+            if (map == (char *) MAP_FAILED)
+                make_bit_true(&err, STACK_FILE_FAILED);
+            else
+                store = map + header.header_size;
+        }
+
+    #else
+
+        #ifdef GUARD_PROTECTION
+
+            const StackAllocator *allocator = &STACK_GUARD_ALLOCATOR;
+
+        #else
+
+            const StackAllocator *allocator = STACK_DEFAULT_ALLOCATOR;
+
+        #endif
+
+        if (!err && header.store_size != 0)
+        {
+            store = allocator->alloc(allocator->ctx, header.store_size);
+
+            if (store == nullptr)
+                make_bit_true(&err, MEMORY_LIMIT_EXCEEDED);
+
+            else if (fread(store, header.store_size, 1, file) != 1)
+            {
+                allocator->free(allocator->ctx, store, header.store_size);
+                store = nullptr;
+
+                make_bit_true(&err, STACK_FILE_FAILED);
+            }
+        }
+
+    #endif
+
+    if (file != nullptr)
+        fclose(file); // the mapping stays after the file is closed
+
+    if (err)
+    {
+        #ifdef STACK_ERROR_DUMP
+
+            StackDump(stk, err, __FILE__, __PRETTY_FUNCTION__, __LINE__);
+
+        #endif
+
+        log_func_end(__PRETTY_FUNCTION__, err);
+        return err;
+    }
+
+    stk->is_Ctor   = 1;
+    stk->size      = (size_t) header.size;
+    stk->capacity  = (size_t) header.capacity;
+    stk->allocator = allocator;
+    stk->growth    = STACK_DEFAULT_GROWTH;
+    stk->reserved  = 0;
+
+    #ifdef CANARY_PROTECTION
+
+        stk->data = (Stack_elem *) ((unsigned *) store + 1);
+
+    #else
+
+        stk->data = (Stack_elem *) store;
+
+    #endif
+
+    #ifdef STACK_STATS
+
+        stk->stats = {};
+
+    #endif
+
+    #ifdef STACK_LATENCY
+
+        stk->latency = {};
+
+    #endif
+
+    #ifdef STACK_DUMPING
+
+        stk->info.variable_name = (stk_name != nullptr) ? stk_name + 1 : nullptr; // add 1 to skip the '&' character
+        stk->info.function_name = stk_func;
+        stk->info.file_name     = stk_file;
+        stk->info.string_number = stk_line;
+
+    #else
+
+        (void) stk_name;
+        (void) stk_func;
+        (void) stk_file;
+        (void) stk_line;
+
+    #endif
+
+    #ifdef POISON_WATERMARK
+
+        stk->poisoned = (size_t) header.poisoned;
+
+    #endif
+
+    #ifdef HASH_PROTECTION
+
+        stk->hash_val = header.hash_val;
+
+    #endif
+
+    #ifdef HASH_INCREMENTAL
+
+        stk->hash_pow = hash_power(HASH_BASE, (StackPoisonedEnd(stk) - stk->size) * sizeof(Stack_elem));
+
+    #endif
+
+    #ifdef GUARD_INACTIVE
+
+        stk->guard_writable = (char *) (stk->data + stk->capacity);
+        StackGuardSync(stk, stk->size);
+
+    #endif
+
+    #ifdef GUARD_PROTECTION
+
+        StackGuardRegister(stk);
+
+    #endif
+
+    if (stk->data != nullptr)
+    {
+        #ifdef CANARY_PROTECTION
+
+            if (!StackCheckCanary(stk))
+                make_bit_true(&err, CANARY_PROTECTION_FAILED);
+
+        #endif
+
+        #ifdef HASH_PROTECTION
+
+            if (!CheckHash(stk->data, StackPoisonedEnd(stk) * sizeof(Stack_elem), stk->hash_val))
+                make_bit_true(&err, HASH_PROTECTION_FAILED);
+
+        #endif
 
-    unsigned err = 0;
+        err |= StackVerifyData(stk, 0, stk->capacity);
+    }
 
-    if (stk == nullptr)
+    if (err)
     {
-        make_bit_true(&err, STACK_NULLPTR);
-        return err;
-    }
+        #ifdef STACK_ERROR_DUMP
 
-    if (!stk->is_Ctor)
-        make_bit_true(&err, STACK_NON_CTOR);
+            StackDump(stk, err, __FILE__, __PRETTY_FUNCTION__, __LINE__);
 
-    if (stk->data == (Stack_elem *) POISON_DATA)
-        make_bit_true(&err, ACTIVE_POISON_VALUES);
+        #endif
 
-    if ((int) stk->size < 0)
-        make_bit_true(&err, SIZE_INVALID);
+        #ifdef GUARD_PROTECTION
 
-    if ((int) stk->capacity < 0)
-        make_bit_true(&err, CAPACITY_INVALID);
+            StackGuardUnregister(stk);
 
-    if (stk->size > stk->capacity)
-    {
-        make_bit_true(&err,     SIZE_INVALID);
-        make_bit_true(&err,  CAPACITY_INVALID);
-    }
+        #endif
 
-    if ((int) stk->capacity > 0)
-    {
-        if (stk->data == nullptr)
-            make_bit_true(&err, CAPACITY_INVALID);
+        if (store != nullptr)
+            allocator->free(allocator->ctx, store, (size_t) header.store_size);
 
-        else if (stk->data != (Stack_elem *) POISON_DATA)
-        {
-            for (size_t counter = 0; counter < stk->size; ++counter)
-            {
-                if (!PoisonCheck(stk->data + counter, sizeof(Stack_elem), (unsigned char) POISON_BYTE,
-                                                                          (unsigned char) 0))
-                {
-                    make_bit_true(&err, ACTIVE_POISON_VALUES);
-                    break;
-                }
-            }
+        #ifdef FLIGHT_RECORDER
 
-            for (size_t counter = stk->size; counter < stk->capacity; ++counter)
-            {
-                if (!PoisonCheck(stk->data + counter, sizeof(Stack_elem), (unsigned char) POISON_BYTE,
-                                                                          (unsigned char) 1))
-                {
-                    make_bit_true(&err, NON_ACTIVE_NON_POISON_VALUES);
-                    break;
-                }
-            }
-        }
-    }
-    if (stk->data == (Stack_elem *) POISON_DATA || stk->data == nullptr)
-    {
-        log_func_end(__PRETTY_FUNCTION__, err);
-        return err;
-    }
+            FlightRecorder flight = stk->flight; // the failed load stays in the history
 
-    #ifdef CANARY_PROTECTION
+        #endif
 
-        if (!StackCheckCanary(stk))
-            make_bit_true(&err, CANARY_PROTECTION_FAILED);
+        *stk = {};
 
-    #endif
+        #ifdef FLIGHT_RECORDER
 
-    #ifdef HASH_PROTECTION
+            stk->flight = flight;
 
-        if (!CheckHash(stk->data, stk->capacity * sizeof(Stack_elem), stk->hash_val))
-            make_bit_true(&err, HASH_PROTECTION_FAILED);
+        #endif
 
-    #endif
+        log_func_end(__PRETTY_FUNCTION__, err);
+        return err;
+    }
 
-    log_func_end(__PRETTY_FUNCTION__, err);
-    return err;
+    STACK_FLIGHT_END(stk); // the checks above are the full "StackVerify()", it is not repeated
+
+    log_func_end(__PRETTY_FUNCTION__, STACK_OK);
+    return STACK_OK;
 }
 
+#ifdef STACK_PERSISTENT
+/*-----------------------------------------------------PERSISTENT-----------------------------------------------------*/
+
 /**
-*   @brief Makes the bit of the unsigned int true.
-*
-*   @param     num [in][out] num - pointer to the unsigned int
-*   @param bit_num [in]  bit_num - number of the bit to make true
-*
-*   @return nothing
+*   @brief Writes "Stack.size", "Stack.capacity" and "Stack.hash_val" in the file of the persistent "Stack" (see
+*   @brief "stack_persist.h"). Called at the end of every operation which changes them, so the commit in the file
+*   @brief is always the state after the last finished operation.
 */
 
-static void make_bit_true(unsigned *const num, const unsigned bit_num)
+static void StackPersistCommit(Stack *stk)
 {
-    assert (num);
+    assert(stk          != nullptr);
+    assert(stk->persist != nullptr);
+
+    PersistFile  *file   = stk->persist;
+    PersistCommit commit = {};
+
+    commit.size     = stk->size;
+    commit.capacity = stk->capacity;
+    commit.poisoned = StackPoisonedEnd(stk);
+
+    #ifdef HASH_PROTECTION
+
+        commit.hash_val = stk->hash_val;
+
+    #endif
 
-    *num = (*num) | (1 << bit_num);
+    // the operations change only the elements from the lower of the two sizes up to the right canary
+    const size_t dirty_from = (file->last.size < stk->size) ? (size_t) file->last.size : stk->size;
+
+    persist_commit(file, commit, (size_t) ((char *) (stk->data + dirty_from) - (char *) StackStore(stk)));
 }
 
 /**
-*   @brief Add the element into the "Stack.data".
+*   @brief Rolls the torn state of the reopened "Stack" back to the last consistent one. The operation which was
+*   @brief in progress during the crash has changed only the elements after the committed size (push), the right
+*   @brief canary (growth) or the top elements which it has poisoned from the lowest one (pop). So the right canary
+*   @brief is written again and the elements after the size are poisoned again: the push is rolled back and the hash
+*   @brief of the commit fits again. If it doesn't, "Stack" is cut below the lowest active element with poison:
+*   @brief the pop is completed and the hash is counted again. Other errors are not touched, "StackVerify()" finds them.
 *
-*   @param      stk [in][out] stk - pointer to the "Stack"
-*   @param push_val [in] push_val - value of element to put
+*   @param stk [in][out] stk - pointer to the "Stack" with the committed state, "Stack.data" must not be nullptr
 *
-*   @return bit-mask which encodes the errors from "enum _StackError"
+*   @return size of the "Stack" before the rollback
 */
 
-static unsigned StackPush(Stack *stk, const Stack_elem push_val)
+static size_t StackPersistRepair(Stack *stk)
 {
-    log_push(stk, push_val);
+    assert(stk       != nullptr);
+    assert(stk->data != nullptr);
 
-    unsigned err = 0;
-    Stack_assert(stk, &err);
+    const size_t committed_size = stk->size;
 
-    if (stk->size < stk->capacity)
-    {
-        stk->data[stk->size++] = push_val;
+    #ifdef CANARY_PROTECTION
 
-        #ifdef HASH_PROTECTION
+        *(unsigned *) (stk->data + stk->capacity) = (unsigned) RIGHT_CANARY;
 
-            stk->hash_val = get_hash(stk->data, stk->capacity * sizeof(Stack_elem));
+    #endif
 
-        #endif
+    if (stk->size < StackPoisonedEnd(stk))
+        FillPoison(stk->data, sizeof(Stack_elem), stk->size, StackPoisonedEnd(stk), (unsigned char) POISON_BYTE);
 
-        Stack_assert(stk, &err);
+    #ifdef HASH_PROTECTION
 
-        log_func_end(__PRETTY_FUNCTION__, STACK_OK);
-        return STACK_OK;
-    }
+        if (CheckHash(stk->data, StackPoisonedEnd(stk) * sizeof(Stack_elem), stk->hash_val))
+            return committed_size;
 
-    if (stk->size == stk->capacity)
-    {
-        err = StackRealloc(stk, 1);
-        if (err)
-        {
-            log_func_end(__PRETTY_FUNCTION__, err);
-            return err;
-        }
-    }
+    #endif
 
-    stk->data[stk->size++] = push_val;
+    stk->size = PoisonFind(stk->data, sizeof(Stack_elem), 0, committed_size, (unsigned char) POISON_BYTE,
+                                                                             (unsigned char) 0);
+    if (stk->size == committed_size)
+        return committed_size;
+
+    FillPoison(stk->data, sizeof(Stack_elem), stk->size, committed_size, (unsigned char) POISON_BYTE);
 
     #ifdef HASH_PROTECTION
 
-        stk->hash_val = get_hash(stk->data, stk->capacity * sizeof(Stack_elem));
+        StackHashRecount(stk);
 
     #endif
 
-    Stack_assert(stk, &err);
-
-    log_func_end(__PRETTY_FUNCTION__, STACK_OK);
-    return STACK_OK;
+    return committed_size;
 }
 
 /**
-*   @brief Deletes the front element of the "Stack.data". Puts the front element in variable
-*   @brief pointed by "front_val" before deliting.
-*   @brief "fron_val" is nullptr default. In this case "StackPop()" doesn't puts the front element.
+*   @brief Constructs the persistent "Stack" whose store, size and hash live in the file "file_name" (see
+*   @brief "stack_persist.h"). Use it as the "StackPersistOpen()" macro, like "StackCtor()".
 *
-*   @param       stk [in][out]   stk - pointer to the "Stack"
-*   @param front_val [out] front_val - pointer to the front element
+*   @brief If the file doesn't exist (or the process was killed before the first commit), it is created and "Stack"
+*   @brief is constructed in it with "capacity". Else "Stack" is restored in O(1) without reading the file: the file
+*   @brief is mapped and the newest whole commit gives the size, capacity and hash. Then "StackVerify()" looks for
+*   @brief the torn state left by the crash and "StackPersistRepair()" rolls it back, the result is committed again.
+*   @brief If "Stack" is still invalid, it is dumped, the file is closed and "Stack" is left not constructed.
+*
+*   @brief After every successful operation the state is committed in the file, "sync" and "sync_period" tell when
+*   @brief it is msync()-ed (see "enum _PersistSync"), "StackSync()" does it explicitly. "StackDtor()" closes the file.
+*
+*   @param         stk [out]          stk - pointer to the "Stack", it must be initialized by nulls
+*   @param   file_name [in]     file_name - name of the file
+*   @param    capacity [in]      capacity - capacity of the "Stack" in the new file, ignored for the existing one
+*   @param        sync [in]          sync - policy of the syncs
+*   @param sync_period [in]   sync_period - period of the syncs in PERSIST_SYNC_PERIOD mode
+*   @param    stk_name [in]      stk_name - name   of the "Stack" variable
+*   @param    stk_func [in]      stk_func - name   of the function where the "Stack" variable was declared
+*   @param    stk_file [in]      stk_file - name   of the     file where the "Stack" variable was declared
+*   @param    stk_line [in]      stk_line - number of the     line where the "Stack" variable was declared
 *
 *   @return bit-mask which encodes the errors from "enum _StackError"
 */
 
-static unsigned StackPop(Stack *stk, Stack_elem *const front_val)
+static unsigned _StackPersistOpen(Stack *stk, const char *file_name, const int capacity,
+                                              const PersistSync sync, const size_t sync_period,
+                                              const char *stk_name, const char *stk_func,
+                                              const char *stk_file, const int stk_line)
 {
-    fprintf(LOG_STREAM, "StackPop(stk = %p, front_val = %p)\n\n%s",
-                                  stk,      front_val, TAB_SHIFT);
-    TAB_SHIFT[TAB_NUM++] = '\t';
+    log_persist_open(stk, file_name);
 
     unsigned err = 0;
-    Stack_assert(stk, &err);
 
-    if (stk->size == 0)
+    if (stk == nullptr)
     {
-        make_bit_true(&err, STACK_EMPTY);
+        make_bit_true(&err, STACK_NULLPTR);
 
-        #ifdef STACK_DUMPING
+        log_func_end(__PRETTY_FUNCTION__, err);
+        return err;
+    }
+
+    assert(file_name != nullptr);
+
+    if (stk->is_Ctor == 1)
+    {
+        make_bit_true(&err, STACK_ALREADY_CTOR);
+
+        #ifdef STACK_ERROR_DUMP
 
             StackDump(stk, err, __FILE__, __PRETTY_FUNCTION__, __LINE__);
 
@@ -1006,81 +4445,68 @@ static unsigned StackPop(Stack *stk, Stack_elem *const front_val)
         return err;
     }
 
-    --stk->size;
-
-    if (front_val != nullptr)
-        *front_val = stk->data[stk->size];
-
-    FillPoison(stk->data, sizeof(Stack_elem), stk->size, stk->size + 1, (unsigned char) POISON_BYTE);
-
-    #ifdef HASH_PROTECTION
+    int          is_invalid = 0;
+    PersistFile *file       = persist_open(file_name, sizeof(Stack_elem), STACK_FILE_FLAGS, sync, sync_period,
+                                           &is_invalid);
+    if (file == nullptr)
+        make_bit_true(&err, is_invalid ? STACK_FILE_INVALID : STACK_FILE_FAILED);
 
-        stk->hash_val = get_hash(stk->data, stk->capacity * sizeof(Stack_elem));
+    else if (file->last.seq == 0)
+    {
+        err = _StackCtor(stk, capacity, stk_name, stk_func, stk_file, stk_line, &file->allocator);
 
-    #endif
+        if (!err)
+        {
+            stk->persist = file;
+            StackPersistCommit(stk);
 
-    Stack_assert(stk, &err);
+            log_func_end(__PRETTY_FUNCTION__, STACK_OK);
+            return STACK_OK;
+        }
+    }
 
-    err = StackRealloc(stk, 0);
+    else
+    {
+        STACK_FLIGHT_BEGIN(stk, FLIGHT_OPEN, 0);
 
-    log_func_end(__PRETTY_FUNCTION__, err);
-    return err;
-}
+        const PersistCommit *commit = &file->last;
 
-/**
-*   @brief Does a "Stack" memory reallocation. Can work in two modes. If "condition" is true, it allocates memory,
-*   @brief and else it frees the part of memory.
-*   @brief Memory allocation occurs acording the folowing strategy: if "Stack.size" = "Stack.capacity", capacity doubles.
-*   @brief Memory    freeing occurs acording the folowing strategy: if "Stack.size" equal or less than a quarter of
-*   @brief "Stack.capacity", capacity is halved
-*
-*   @param       stk [in][out]  stk - pointer to the "Stack"
-*   @param condition [in] condition - mode of "StackRealloc()"
-*
-*   @return bit-mask which encodes the errors from "enum _StackError"
-*/
+        int is_fit = commit->size <= commit->capacity && commit->poisoned <= commit->capacity &&
+                     commit->capacity <= ((uint64_t) SIZE_MAX - 2 * sizeof(unsigned)) / sizeof(Stack_elem) &&
+                     sizeof(PersistHeader) + StackStoreSize((size_t) commit->capacity) <= file->file_size;
 
-static unsigned StackRealloc(Stack *stk, const int condition)
-{
-    fprintf(LOG_STREAM, "StackRealloc(stk = %p, condition = %d)\n\n%s",
-                                      stk,      condition, TAB_SHIFT);
-    TAB_SHIFT[TAB_NUM++] = '\t';
+        #ifndef POISON_WATERMARK
 
-    unsigned err = 0;
-    Stack_assert(stk, &err);
+            is_fit = is_fit && commit->poisoned == commit->capacity;
 
-    int future_capacity = 0;
+        #endif
 
-    if (condition)
-    {
-            future_capacity = 2 *  stk->capacity;
-        if (future_capacity < 4) future_capacity = 4; //default elementary capacity
+        if (!is_fit)
+            make_bit_true(&err, STACK_FILE_INVALID);
     }
-    else
+
+    if (err)
     {
-        if ((stk->size != 0) && (stk->capacity >= 4 * stk->size)) future_capacity = 2 * stk->size;
-    }
+        #ifdef STACK_ERROR_DUMP
 
-    if (future_capacity == 0)
-        return STACK_OK;
+            if (file == nullptr || file->last.seq != 0) // the failed constructor has dumped itself
+                StackDump(stk, err, __FILE__, __PRETTY_FUNCTION__, __LINE__);
 
-    #ifdef CANARY_PROTECTION
+        #endif
 
-        int *temp_data_store = (int *) realloc((unsigned *) (stk->data) - 1, 8 + sizeof(Stack_elem) * future_capacity);
+        persist_close(file);
 
-    #else
+        #ifdef FLIGHT_RECORDER
 
-        Stack_elem *temp_data_store = (Stack_elem *) realloc(stk->data, sizeof(Stack_elem) * future_capacity);
+            FlightRecorder flight = stk->flight;
 
-    #endif
+        #endif
 
-    if (temp_data_store == nullptr)
-    {
-        make_bit_true(&err, MEMORY_LIMIT_EXCEEDED);
+        *stk = {};
 
-        #ifdef STACK_DUMPING
+        #ifdef FLIGHT_RECORDER
 
-            StackDump(stk, err, __FILE__, __PRETTY_FUNCTION__, __LINE__);
+            stk->flight = flight;
 
         #endif
 
@@ -1088,87 +4514,137 @@ static unsigned StackRealloc(Stack *stk, const int condition)
         return err;
     }
 
+    stk->is_Ctor   = 1;
+    stk->size      = (size_t) file->last.size;
+    stk->capacity  = (size_t) file->last.capacity;
+    stk->allocator = &file->allocator;
+    stk->growth    = STACK_DEFAULT_GROWTH;
+    stk->reserved  = 0;
+    stk->persist   = file;
 
     #ifdef CANARY_PROTECTION
 
-        stk->data = (Stack_elem *) (temp_data_store + 1);
+        stk->data = (Stack_elem *) ((unsigned *) persist_store(file) + 1);
 
-        *(int *) (stk->data + future_capacity) = RIGHT_CANARY;
+    #else
+
+        stk->data = (stk->capacity != 0) ? (Stack_elem *) persist_store(file) : nullptr;
+
+    #endif
+
+    #ifdef STACK_STATS
+
+        stk->stats = {};
+
+    #endif
+
+    #ifdef STACK_LATENCY
+
+        stk->latency = {};
+
+    #endif
+
+    #ifdef STACK_DUMPING
+
+        stk->info.variable_name = (stk_name != nullptr) ? stk_name + 1 : nullptr; // add 1 to skip the '&' character
+        stk->info.function_name = stk_func;
+        stk->info.file_name     = stk_file;
+        stk->info.string_number = stk_line;
 
     #else
 
-        stk->data = temp_data_store;
+        (void) stk_name;
+        (void) stk_func;
+        (void) stk_file;
+        (void) stk_line;
 
     #endif
 
-    stk->capacity = future_capacity;
+    #ifdef POISON_WATERMARK
 
-    FillPoison(stk->data, sizeof(Stack_elem), stk->size, stk->capacity, (unsigned char) POISON_BYTE);
+        stk->poisoned = (size_t) file->last.poisoned;
+
+    #endif
 
     #ifdef HASH_PROTECTION
 
-        stk->hash_val = get_hash(stk->data, stk->capacity * sizeof(Stack_elem));
+        stk->hash_val = file->last.hash_val;
 
     #endif
 
-    Stack_assert(stk, &err);
+    #ifdef HASH_INCREMENTAL
 
-    log_func_end(__PRETTY_FUNCTION__, STACK_OK);
-    return STACK_OK;
-}
+        stk->hash_pow = hash_power(HASH_BASE, (StackPoisonedEnd(stk) - stk->size) * sizeof(Stack_elem));
 
-/**
-*   @brief Stack destructor. Frees memory pointed by "Stack.data".
-*   @brief Fill all "Stack" elements besides the "Stack.is_Ctor" by poison. "Stack.is_Ctor" becomes equal to zero.
-*
-*   @param stk [in][out] stk - pointer to the "Stack"
-*
-*   @return bit-mask which encodes the errors from "enum _StackError"
-*/
+    #endif
 
-static unsigned StackDtor(Stack *stk)
-{
-    fprintf(LOG_STREAM, "StackDtor(stk = %p)\n\n%s",
-                                   stk, TAB_SHIFT);
-    TAB_SHIFT[TAB_NUM++] = '\t';
+    err = StackVerify(stk);
 
-    unsigned err = 0;
-    Stack_assert(stk, &err);
+    if (err && stk->data != nullptr)
+    {
+        log_persist_repair(stk, StackPersistRepair(stk));
 
-    if (stk->data != nullptr)
+        if (!(err = StackVerify(stk)))
+            StackPersistCommit(stk);
+    }
+
+    if (err)
     {
-        #ifdef CANARY_PROTECTION
+        #ifdef STACK_ERROR_DUMP
 
-            free((unsigned *) stk->data - 1);
+            StackDump(stk, err, __FILE__, __PRETTY_FUNCTION__, __LINE__);
 
-        #else
+        #endif
+
+        persist_close(file);
 
-            free(stk->data);
+        #ifdef FLIGHT_RECORDER
+
+            FlightRecorder flight = stk->flight; // the failed open stays in the history
 
         #endif
 
-        stk->data = (Stack_elem *) POISON_DATA;
-    }
+        *stk = {};
 
-    stk->size     = POISON_SIZE;
-    stk->capacity = POISON_CAPACITY;
-    stk->is_Ctor  = 0;
+        #ifdef FLIGHT_RECORDER
 
-    #ifdef STACK_DUMPING
+            stk->flight = flight;
 
-        stk->info.variable_name  = stk->info.function_name = stk->info.file_name = (const char *) POISON_NAME;
-        stk->info.string_number = POISON_STRING;
+        #endif
 
-    #endif
+        log_func_end(__PRETTY_FUNCTION__, err);
+        return err;
+    }
 
-    #ifdef HASH_PROTECTION
+    STACK_FLIGHT_END(stk);
 
-        stk->hash_val = 0;
+    log_func_end(__PRETTY_FUNCTION__, STACK_OK);
+    return STACK_OK;
+}
 
-    #endif
+/**
+*   @brief msync()-s the elements and the commit of the persistent "Stack", so they survive the power loss.
+*   @brief Does nothing for the other "Stack".
+*
+*   @param stk [in] stk - pointer to the "Stack"
+*
+*   @return bit-mask which encodes the errors from "enum _StackError"
+*/
+
+static unsigned StackSync(Stack *stk)
+{
+    log_sync(stk);
+
+    unsigned err = 0;
+    Stack_assert(stk, &err);
+
+    if (stk->persist != nullptr)
+        persist_sync(stk->persist);
 
     log_func_end(__PRETTY_FUNCTION__, STACK_OK);
     return STACK_OK;
 }
 
+#endif
+
 #endif //STACK
@@ -0,0 +1,582 @@
+/** @file */
+
+#ifndef STACK_ALLOC_H
+#define STACK_ALLOC_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+
+#ifdef __unix__
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+/**
+*   @brief Allocators of the "Stack" elements store. "Stack" never calls malloc() directly, it calls the functions
+*   @brief of its "StackAllocator" with the exact size of the store (elements plus canaries), so an allocator
+*   @brief doesn't need the header in front of the block to know its size.
+*
+*   @brief Built-in allocators:
+*   @brief   STACK_SYSTEM_ALLOCATOR - malloc(), realloc(), free()
+*   @brief   STACK_POOL_ALLOCATOR   - power-of-two size classes with per-thread caches of free blocks
+*   @brief   STACK_VM_ALLOCATOR     - reserves the virtual range and commits pages as the block grows (only on unix)
+*   @brief   STACK_GUARD_ALLOCATOR  - puts the block between two PROT_NONE pages (only on unix)
+*   @brief   STACK_MAP_ALLOCATOR    - every block is a mapping of its own, so it frees the file mapping adopted by
+*   @brief                            "StackLoad()" too (only on unix)
+*/
+
+/**
+*   @brief Allocator interface.
+*
+*   @param   alloc - returns the block of "size" bytes or nullptr, the content is not initialized
+*   @param realloc - moves the block to the block of "new_size" bytes, keeps min(old_size, new_size) first bytes,
+*                    returns nullptr and keeps the old block if there is no memory
+*   @param    free - frees the block of "size" bytes
+*   @param     ctx - user data passed to all functions
+*/
+
+typedef struct _StackAllocator
+{
+    void *(*alloc)   (void *ctx, size_t size);
+    void *(*realloc) (void *ctx, void *ptr, size_t old_size, size_t new_size);
+    void  (*free)    (void *ctx, void *ptr, size_t size);
+
+    void *ctx;
+
+} StackAllocator;
+
+/*-------------------------------------------------SYSTEM_ALLOCATOR--------------------------------------------------*/
+
+static void *system_alloc(void *, size_t size)
+{
+    return malloc(size);
+}
+
+static void *system_realloc(void *, void *ptr, size_t, size_t new_size)
+{
+    return realloc(ptr, new_size);
+}
+
+static void system_free(void *, void *ptr, size_t)
+{
+    free(ptr);
+}
+
+const StackAllocator STACK_SYSTEM_ALLOCATOR = {system_alloc, system_realloc, system_free, nullptr};
+
+/*--------------------------------------------------POOL_ALLOCATOR---------------------------------------------------*/
+
+/**
+*   @brief Constants of the pool.
+*
+*   @param POOL_MIN_CLASS   - log2 of the smallest block, smaller queries get it too
+*   @param POOL_MAX_CLASS   - log2 of the biggest  block, bigger  queries go to the system allocator
+*   @param POOL_CACHE_BYTES - maximum size of free blocks of one class kept by one thread
+*/
+
+enum _PoolConst
+{
+    POOL_MIN_CLASS   = 5,
+    POOL_MAX_CLASS   = 20,
+    POOL_CACHE_BYTES = 1 << 20
+};
+
+/**
+*   @brief Free blocks of one size class kept by one thread. The blocks are linked through their first bytes.
+*
+*   @param  head - first free block
+*   @param count - number of free blocks
+*/
+
+typedef struct _PoolBin
+{
+    void  *head;
+    size_t count;
+
+} PoolBin;
+
+/**
+*   @brief Per-thread cache of the pool. Gives the cached blocks back to the system when the thread exits.
+*   @brief Destructors of the other thread_local objects may run after it and still free blocks of the thread,
+*   @brief so the exited cache is bypassed instead of being filled again and leaked.
+*
+*   @param      bins - free blocks of every size class
+*   @param is_exited - the destructor has already drained the bins
+*/
+
+struct PoolCache
+{
+    PoolBin bins[POOL_MAX_CLASS + 1];
+    bool    is_exited;
+
+    ~PoolCache()
+    {
+        is_exited = true;
+
+        for (int class_num = POOL_MIN_CLASS; class_num <= POOL_MAX_CLASS; ++class_num)
+        {
+            while (bins[class_num].head != nullptr)
+            {
+                void *block = bins[class_num].head;
+
+                bins[class_num].head = *(void **) block;
+                free(block);
+            }
+        }
+    }
+};
+
+static thread_local PoolCache POOL_CACHE = {};
+
+/**
+*   @brief Finds the size class of the block.
+*
+*   @param size [in] size - needed size of the block
+*
+*   @return log2 of the block size, which is not less than "size", or POOL_MAX_CLASS + 1 if the block is too big
+*/
+
+static inline int pool_class(const size_t size)
+{
+    int class_num = POOL_MIN_CLASS;
+
+    while (class_num <= POOL_MAX_CLASS && ((size_t) 1 << class_num) < size)
+        ++class_num;
+
+    return class_num;
+}
+
+static void *pool_alloc(void *, size_t size)
+{
+    int class_num = pool_class(size);
+
+    if (class_num > POOL_MAX_CLASS)
+        return malloc(size);
+
+    PoolBin *bin = POOL_CACHE.bins + class_num;
+
+    if (bin->head != nullptr && !POOL_CACHE.is_exited)
+    {
+        void *block = bin->head;
+
+        bin->head = *(void **) block;
+        --bin->count;
+
+        return block;
+    }
+
+    return malloc((size_t) 1 << class_num);
+}
+
+static void pool_free(void *, void *ptr, size_t size)
+{
+    if (ptr == nullptr)
+        return;
+
+    int class_num = pool_class(size);
+
+    if (class_num > POOL_MAX_CLASS)
+    {
+        free(ptr);
+        return;
+    }
+
+    PoolBin *bin = POOL_CACHE.bins + class_num;
+
+    if ((bin->count + 1) << class_num > POOL_CACHE_BYTES || POOL_CACHE.is_exited)
+    {
+        free(ptr);
+        return;
+    }
+
+    *(void **) ptr = bin->head;
+    bin->head      = ptr;
+    ++bin->count;
+}
+
+/**
+*   @brief Moves the block only if the size class changes, so most of "StackRealloc()" calls are free.
+*/
+
+static void *pool_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size)
+{
+    if (ptr == nullptr)
+        return pool_alloc(ctx, new_size);
+
+    int old_class = pool_class(old_size);
+    int new_class = pool_class(new_size);
+
+    if (old_class > POOL_MAX_CLASS && new_class > POOL_MAX_CLASS)
+        return realloc(ptr, new_size);
+
+    if (old_class == new_class)
+        return ptr;
+
+    void *new_ptr = pool_alloc(ctx, new_size);
+    if (new_ptr == nullptr)
+        return nullptr;
+
+    memcpy(new_ptr, ptr, (old_size < new_size) ? old_size : new_size);
+
+    pool_free(ctx, ptr, old_size);
+
+    return new_ptr;
+}
+
+const StackAllocator STACK_POOL_ALLOCATOR = {pool_alloc, pool_realloc, pool_free, nullptr};
+
+/*---------------------------------------------------VM_ALLOCATOR----------------------------------------------------*/
+
+#ifdef __unix__
+
+/**
+*   @brief Settings of the virtual memory allocator, "StackAllocator.ctx" points to them.
+*
+*   @param reserve_bytes - size of the virtual range reserved for one block, the block grows inside it without moving
+*   @param    huge_pages - asks the kernel to back the range by transparent huge pages (madvise(MADV_HUGEPAGE))
+*   @param          lock - locks the committed pages in RAM (mlock()), so the latency-critical "Stack" never waits for swap
+*/
+
+typedef struct _StackVmConfig
+{
+    size_t reserve_bytes;
+    bool   huge_pages;
+    bool   lock;
+
+} StackVmConfig;
+
+StackVmConfig STACK_VM_CONFIG = {(size_t) 1 << 30, false, false};
+
+/**
+*   @brief Header at the beginning of the reserved range. The block starts right after it.
+*
+*   @param  reserved - size of the reserved range (including the header)
+*   @param committed - size of the readable and writable prefix of the range (including the header)
+*/
+
+typedef struct alignas(64) _VmHeader
+{
+    size_t reserved;
+    size_t committed;
+
+} VmHeader;
+
+static inline size_t vm_page_round(const size_t size)
+{
+    static const size_t page_size = (size_t) sysconf(_SC_PAGESIZE);
+
+    return (size + page_size - 1) / page_size * page_size;
+}
+
+static inline VmHeader *vm_header(void *ptr)
+{
+    return (VmHeader *) ptr - 1;
+}
+
+/**
+*   @brief Makes the prefix of "committed" bytes of the range readable and writable, releases the pages after it.
+*
+*   @param    config [in]         config - settings of the allocator
+*   @param    header [in][out]    header - header of the range
+*   @param committed [in]      committed - needed size of the prefix, page aligned
+*
+*   @return true if it is done and false if the kernel has refused
+*/
+
+static bool vm_commit(const StackVmConfig *config, VmHeader *header, const size_t committed)
+{
+    char *base = (char *) header;
+
+    if (committed > header->committed)
+    {
+        if (mprotect(base + header->committed, committed - header->committed, PROT_READ | PROT_WRITE))
+            return false;
+
+        if (config->lock)
+            mlock(base + header->committed, committed - header->committed);
+    }
+    else if (committed < header->committed)
+    {
+        if (config->lock)
+            munlock(base + committed, header->committed - committed);
+
+        madvise (base + committed, header->committed - committed, MADV_DONTNEED);
+        mprotect(base + committed, header->committed - committed, PROT_NONE);
+    }
+
+    header->committed = committed;
+
+    return true;
+}
+
+/**
+*   @brief Reserves the range of "reserved" bytes without any memory behind it.
+*
+*   @return pointer to the range or nullptr
+*/
+
+static void *vm_reserve(const StackVmConfig *config, const size_t reserved)
+{
+    void *base = mmap(nullptr, reserved, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (base == MAP_FAILED)
+        return nullptr;
+
+    #ifdef MADV_HUGEPAGE
+
+        if (config->huge_pages)
+            madvise(base, reserved, MADV_HUGEPAGE);
+
+    #else
+
+        (void) config;
+
+    #endif
+
+    return base;
+}
+
+static void *vm_alloc(void *ctx, size_t size)
+{
+    const StackVmConfig *config = (const StackVmConfig *) ctx;
+    assert(config != nullptr);
+
+    size_t need     = vm_page_round(sizeof(VmHeader) + size);
+    size_t reserved = vm_page_round(config->reserve_bytes);
+
+    if (reserved < need)
+        reserved = need;
+
+    VmHeader *header = (VmHeader *) vm_reserve(config, reserved);
+    if (header == nullptr)
+        return nullptr;
+
+    if (mprotect(header, vm_page_round(sizeof(VmHeader)), PROT_READ | PROT_WRITE))
+    {
+        munmap(header, reserved);
+        return nullptr;
+    }
+
+    header->reserved  = reserved;
+    header->committed = vm_page_round(sizeof(VmHeader));
+
+    if (!vm_commit(config, header, need))
+    {
+        munmap(header, reserved);
+        return nullptr;
+    }
+
+    return header + 1;
+}
+
+static void vm_free(void *ctx, void *ptr, size_t)
+{
+    (void) ctx;
+
+    if (ptr == nullptr)
+        return;
+
+    VmHeader *header = vm_header(ptr);
+
+    munmap(header, header->reserved);
+}
+
+/**
+*   @brief Commits or releases the pages at the end of the block, the block doesn't move while it fits in the range.
+*   @brief A bigger block moves the whole range by mremap() (page tables only, the data is not copied) on Linux
+*   @brief and by the copy on other systems.
+*/
+
+static void *vm_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size)
+{
+    const StackVmConfig *config = (const StackVmConfig *) ctx;
+    assert(config != nullptr);
+
+    if (ptr == nullptr)
+        return vm_alloc(ctx, new_size);
+
+    VmHeader *header = vm_header(ptr);
+    size_t    need   = vm_page_round(sizeof(VmHeader) + new_size);
+
+    if (need <= header->reserved)
+        return vm_commit(config, header, need) ? ptr : nullptr;
+
+    size_t reserved = 2 * header->reserved;
+    if (reserved < need)
+        reserved = need;
+
+    #ifdef __linux__
+
+        (void) old_size;
+
+        const size_t old_reserved  = header->reserved;
+        const size_t old_committed = header->committed;
+
+        VmHeader *new_header = (VmHeader *) vm_reserve(config, reserved);
+        if (new_header == nullptr)
+            return nullptr;
+
+        // the grown part is committed before the move, so if the kernel refuses, the old block is still intact
+        char *grown = (char *) new_header + old_committed;
+
+        if (mprotect(grown, need - old_committed, PROT_READ | PROT_WRITE))
+        {
+            munmap(new_header, reserved);
+            return nullptr;
+        }
+
+        if (config->lock)
+            mlock(grown, need - old_committed);
+
+        // only the committed prefix is moved: mremap() can't move the range of the pages with different protection
+        if (mremap(header, old_committed, old_committed, MREMAP_MAYMOVE | MREMAP_FIXED, new_header) == MAP_FAILED)
+        {
+            munmap(new_header, reserved);
+            return nullptr;
+        }
+
+        munmap(header, old_reserved);
+
+        new_header->reserved  = reserved;
+        new_header->committed = need;
+
+        return new_header + 1;
+
+    #else
+
+        void *new_ptr = vm_alloc(ctx, new_size);
+        if (new_ptr == nullptr)
+            return nullptr;
+
+        memcpy(new_ptr, ptr, old_size);
+        vm_free(ctx, ptr, old_size);
+
+        return new_ptr;
+
+    #endif
+}
+
+const StackAllocator STACK_VM_ALLOCATOR = {vm_alloc, vm_realloc, vm_free, &STACK_VM_CONFIG};
+
+/*--------------------------------------------------GUARD_ALLOCATOR--------------------------------------------------*/
+
+/**
+*   @brief The block of "size" bytes ends exactly at the page boundary, the page after it and the page before its first
+*   @brief page are PROT_NONE. So the first byte after the block faults on access, an underrun faults when it passes
+*   @brief the beginning of the first page of the block (the gap is less than a page).
+*   @brief The layout is computed from "size" only, so the allocator keeps no headers:
+*   @brief   [left guard page][pages of the block, the block is at their end][right guard page]
+*/
+
+static inline size_t guard_page_size()
+{
+    static const size_t page_size = (size_t) sysconf(_SC_PAGESIZE);
+
+    return page_size;
+}
+
+static inline char *guard_left(void *ptr, const size_t size)
+{
+    return (char *) ptr + size - vm_page_round(size) - guard_page_size();
+}
+
+static inline char *guard_right(void *ptr, const size_t size)
+{
+    return (char *) ptr + size;
+}
+
+static void *guard_alloc(void *, size_t size)
+{
+    const size_t page_size = guard_page_size();
+    const size_t pages     = vm_page_round(size);
+
+    char *base = (char *) mmap(nullptr, pages + 2 * page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == (char *) MAP_FAILED)
+        return nullptr;
+
+    mprotect(base,                     page_size, PROT_NONE);
+    mprotect(base + page_size + pages, page_size, PROT_NONE);
+
+    return base + page_size + pages - size;
+}
+
+static void guard_free(void *, void *ptr, size_t size)
+{
+    if (ptr == nullptr)
+        return;
+
+    munmap(guard_left(ptr, size), vm_page_round(size) + 2 * guard_page_size());
+}
+
+/**
+*   @brief The block is aligned to its end, so it always moves.
+*/
+
+static void *guard_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size)
+{
+    void *new_ptr = guard_alloc(ctx, new_size);
+    if (new_ptr == nullptr)
+        return nullptr;
+
+    if (ptr != nullptr)
+    {
+        // the non active part of the old block may be read-only, but never PROT_NONE
+        memcpy(new_ptr, ptr, (old_size < new_size) ? old_size : new_size);
+        guard_free(ctx, ptr, old_size);
+    }
+
+    return new_ptr;
+}
+
+const StackAllocator STACK_GUARD_ALLOCATOR = {guard_alloc, guard_realloc, guard_free, nullptr};
+
+/*---------------------------------------------------MAP_ALLOCATOR---------------------------------------------------*/
+
+/**
+*   @brief Every block begins in the first page of its own mapping, so the mapping is found from the block alone:
+*   @brief it begins at the page of the block and ends at the page of its last byte. The block of the file mapping
+*   @brief begins after the file header, the blocks of "map_alloc()" begin at the mapping.
+*/
+
+static void *map_alloc(void *, size_t size)
+{
+    void *block = mmap(nullptr, (size != 0) ? size : 1, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    return (block != MAP_FAILED) ? block : nullptr;
+}
+
+static void map_free(void *, void *ptr, size_t size)
+{
+    if (ptr == nullptr)
+        return;
+
+    char *base = (char *) ((uintptr_t) ptr / guard_page_size() * guard_page_size());
+
+    munmap(base, (size_t) ((char *) ptr - base) + ((size != 0) ? size : 1));
+}
+
+/**
+*   @brief The file mapping can't grow after the end of the file, so the block always moves to the anonymous mapping.
+*/
+
+static void *map_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size)
+{
+    void *new_ptr = map_alloc(ctx, new_size);
+    if (new_ptr == nullptr)
+        return nullptr;
+
+    if (ptr != nullptr)
+    {
+        memcpy(new_ptr, ptr, (old_size < new_size) ? old_size : new_size);
+        map_free(ctx, ptr, old_size);
+    }
+
+    return new_ptr;
+}
+
+const StackAllocator STACK_MAP_ALLOCATOR = {map_alloc, map_realloc, map_free, nullptr};
+
+#endif
+
+#endif //STACK_ALLOC_H
@@ -0,0 +1,155 @@
+/** @file */
+
+#ifndef STACK_COMMON_H
+#define STACK_COMMON_H
+
+#include <assert.h>
+
+/**
+*   @brief Definitions which don't depend on the type of "Stack" elements.
+*   @brief They are shared by all "Stack" implementations, so all of them report errors in the same way.
+*/
+
+/**
+*   @brief The enum contains Stack errors.
+*
+*   @param STACK_OK           - Stack is OK
+*   @param STACK_NULLPTR      - pointer to the Stack is nullptr
+*   @param STACK_NON_CTOR     - Stack is not     constructed
+*   @param STACK_ALREADY_CTOR - Stack is already constructed
+*   @param STACK_EMPTY        - Stack is empty
+*
+*   @param CAPACITY_INVALID   - Stack's capacity is invalid(lower than zero or less then     size)
+*   @param SIZE_INVALID       - Stack's     size is invalid(lower than zero or more than capacity)
+*
+*   @param ACTIVE_POISON_VALUES         - poison-values   are active
+*   @param NON_ACTIVE_NON_POISON_VALUES - refuse elements are non-poison
+*
+*   @param MEMORY_LIMIT_EXCEEDED        - memory allocation query is failed
+*
+*   @param CANARY_PROTECTION_FAILED     - canary protection is failed
+*   @param HASH_PROTECTION_FAILED       - hash   protection is failed
+*   @param GUARD_PROTECTION_FAILED      - guard page or write-protected non active element is touched
+*
+*   @param STACK_FILE_FAILED            - file of "StackSave()" or "StackLoad()" can't be opened, written or read
+*   @param STACK_FILE_INVALID           - file of "StackLoad()" has the wrong format, version or modes
+*
+*   @param STACK_ARGUMENT_INVALID       - argument of a setter is out of its range
+*/
+
+typedef enum _StackError
+{
+    STACK_OK                     = 0,
+    STACK_NULLPTR                = 1,
+    STACK_NON_CTOR               = 2,
+    STACK_ALREADY_CTOR           = 3,
+    STACK_EMPTY                  = 4,
+
+    CAPACITY_INVALID             = 5,
+    SIZE_INVALID                 = 6,
+
+    ACTIVE_POISON_VALUES         = 7,
+    NON_ACTIVE_NON_POISON_VALUES = 8,
+
+    MEMORY_LIMIT_EXCEEDED        = 9,
+
+    CANARY_PROTECTION_FAILED     = 10,
+    HASH_PROTECTION_FAILED       = 11,
+    GUARD_PROTECTION_FAILED      = 12,
+
+    STACK_FILE_FAILED            = 13,
+    STACK_FILE_INVALID           = 14,
+
+    STACK_ARGUMENT_INVALID       = 15
+
+} StackError;
+
+/**
+*   @brief Messages needed to write in log-file in case of errors in "Stack".
+*   @brief Index of message is equal to corresponding error-value in the "enum _StackError".
+*/
+
+const char *error_message[] =
+{
+    "OK",                                    // 0
+    "pointer to the stack is nullptr",       // 1
+    "stack is not constructed",              // 2
+    "stack is already constructed",          // 3
+    "stack is empty",                        // 4
+    "capacity invalid",                      // 5
+    "size invalid",                          // 6
+    "active variables are poisoned",         // 7
+    "non active variables are non poisoned", // 8
+    "memory limit exceeded",                 // 9
+    "canary protection failed",              // 10
+    "hash   protection failed",              // 11
+    "guard  protection failed",              // 12
+    "file operation failed",                 // 13
+    "file format is invalid",                // 14
+    "argument is invalid"                    // 15
+};
+
+/**
+*   @brief The enum contains poison-values for Stack's elements.
+*
+*   @param POISON_DATA       - poison-value for "Stack_elem *data"
+*   @param POISON_BYTE       - poison-value for byte of elements of "data"
+*   @param POISON_SIZE       - poison-value for "size_t size"
+*   @param POISON_CAPACITY   - poison-value for "size_t capacity"
+*   @param POISON_NAME       - poison-value for StackDeclaration's elements: variable_name, function_name, file_name
+*   @param POISON_STRING     - poison-value fors StackDeclaration's element "string_number"
+*/
+
+typedef enum _Poison
+{
+    POISON_DATA       = 7,
+    POISON_BYTE       = unsigned(-345),
+    POISON_SIZE       = -1,
+    POISON_CAPACITY   = -1,
+    POISON_NAME       = 7,
+    POISON_STRING     = 0
+
+} Poison;
+
+/**
+*   @brief The enum contains any protection constants.
+*
+*   @param LEFT_CANARY  - value for the  left canary protection
+*   @param RIGHT_CANARY - value for the right canary protection
+*
+*   @param HASH_START   - begining value of the hash
+*   @param HASH_BASE    - multiplier of the hash
+*/
+
+typedef enum _Protection
+{
+    LEFT_CANARY  = 0xBAADF00D,
+    RIGHT_CANARY = 0xDEADBEEF,
+    HASH_START   = 0xFEEDFACE,
+    HASH_BASE    = 33
+
+} Protection;
+
+/*---------------------------------------------FUNCTIONS_DECLARATION--------------------------------------------------*/
+
+static void make_bit_true(unsigned *const num, const unsigned bit_num);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/**
+*   @brief Makes the bit of the unsigned int true.
+*
+*   @param     num [in][out] num - pointer to the unsigned int
+*   @param bit_num [in]  bit_num - number of the bit to make true
+*
+*   @return nothing
+*/
+
+static void make_bit_true(unsigned *const num, const unsigned bit_num)
+{
+    assert (num);
+
+    *num = (*num) | (1 << bit_num);
+}
+
+#endif //STACK_COMMON_H
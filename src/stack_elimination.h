@@ -0,0 +1,333 @@
+/** @file */
+
+#ifndef STACK_ELIMINATION_H
+#define STACK_ELIMINATION_H
+
+#include "stack_lockfree.h"
+
+/**
+*   @brief Elimination-backoff "Stack": "LockFreeStack" with the elimination array in front of it.
+*   @brief "Stack_elem" must be defined before the header the same way as for "stack.h".
+*
+*   @brief Push and pop try the CAS on the head once. If it loses the race, the thread backs off to a random slot of
+*   @brief the elimination array instead of retrying: a push and a pop which meet in one slot exchange the node
+*   @brief directly and never touch the head. If no partner comes during ELIM_SPIN iterations, the thread withdraws
+*   @brief and goes back to the head. So under low contention it works as "LockFreeStack", under high contention
+*   @brief a part of the operations is served by the slots in parallel.
+*
+*   @brief A slot is a tagged word like the head of "LockFreeStack", its index part is:
+*   @brief   LF_NULL                  - slot is free
+*   @brief   node                     - a push waits with its node, a pop may take it
+*   @brief   ELIM_POP_WAIT            - a pop waits, a push may deliver its node
+*   @brief   node | ELIM_DELIVERED    - the node delivered to the waiting pop, only that pop takes it
+*
+*   @brief Errors are reported by the same bit-mask of "enum _StackError" as "StackPush()" and "StackPop()" do.
+*/
+
+/**
+*   @brief Constants of the elimination array.
+*
+*   @param ELIM_SLOTS     - number of slots
+*   @param ELIM_SPIN      - number of checks of the slot by the waiting thread before it withdraws
+*   @param ELIM_POP_WAIT  - slot is occupied by the waiting pop
+*   @param ELIM_DELIVERED - flag of the node delivered to the waiting pop
+*/
+
+enum _EliminationConst
+{
+    ELIM_SLOTS     = 16,
+    ELIM_SPIN      = 256,
+    ELIM_POP_WAIT  = 0x80000000u,
+    ELIM_DELIVERED = 0x40000000u
+};
+
+/**
+*   @brief Slot of the elimination array, aligned to the cache line, so the waiting threads don't share lines.
+*/
+
+typedef struct alignas(64) _EliminationSlot
+{
+    std::atomic<uint64_t> state;
+
+} EliminationSlot;
+
+/**
+*   @brief Elimination-backoff "Stack".
+*
+*   @param   stk - the underlying "LockFreeStack"
+*   @param slots - elimination array
+*/
+
+typedef struct _EliminationStack
+{
+    LockFreeStack   stk;
+    EliminationSlot slots[ELIM_SLOTS];
+
+} EliminationStack;
+
+/*---------------------------------------------FUNCTIONS_DECLARATION--------------------------------------------------*/
+
+static unsigned EliminationStackCtor(EliminationStack *stk);
+static unsigned EliminationStackDtor(EliminationStack *stk);
+
+static unsigned EliminationStackPush(EliminationStack *stk, const Stack_elem push_val);
+static unsigned EliminationStackPop (EliminationStack *stk,       Stack_elem *const front_val = nullptr);
+
+static EliminationSlot *elim_slot    (EliminationStack *stk);
+static bool             elim_try_push(EliminationStack *stk, const uint32_t  index);
+static bool             elim_try_pop (EliminationStack *stk,       uint32_t *index);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/**
+*   @brief Chooses a random slot by the thread local xorshift generator.
+*
+*   @param stk [in] stk - pointer to the "EliminationStack"
+*
+*   @return pointer to the slot
+*/
+
+static EliminationSlot *elim_slot(EliminationStack *stk)
+{
+    static thread_local uint32_t seed = 0;
+
+    if (seed == 0)
+        seed = (uint32_t) (uintptr_t) &seed | 1;
+
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed <<  5;
+
+    return stk->slots + seed % ELIM_SLOTS;
+}
+
+/**
+*   @brief Tries to hand the node over to a pop through a random slot.
+*
+*   @param   stk [in][out]   stk - pointer to the "EliminationStack"
+*   @param index [in]      index - index of the node owned by the current thread
+*
+*   @return true if a pop has taken the node and false if the push must go back to the head
+*/
+
+static bool elim_try_push(EliminationStack *stk, const uint32_t index)
+{
+    std::atomic<uint64_t> *slot = &elim_slot(stk)->state;
+
+    uint64_t old_state = slot->load(std::memory_order_acquire);
+
+    if (lf_index(old_state) == ELIM_POP_WAIT)
+    {
+        return slot->compare_exchange_strong(old_state, lf_tagged(lf_tag(old_state) + 1, index | ELIM_DELIVERED),
+                                                        std::memory_order_acq_rel);
+    }
+
+    if (lf_index(old_state) != LF_NULL)
+        return false;
+
+    uint64_t wait_state = lf_tagged(lf_tag(old_state) + 1, index);
+
+    if (!slot->compare_exchange_strong(old_state, wait_state, std::memory_order_acq_rel))
+        return false;
+
+    for (unsigned counter = 0; counter < ELIM_SPIN; ++counter)
+    {
+        if (slot->load(std::memory_order_acquire) != wait_state)
+            return true;
+    }
+
+    // withdraw, if it fails, a pop has taken the node in the meantime
+    return !slot->compare_exchange_strong(wait_state, lf_tagged(lf_tag(wait_state) + 1, LF_NULL),
+                                                      std::memory_order_acq_rel);
+}
+
+/**
+*   @brief Tries to take the node of a push through a random slot.
+*
+*   @param   stk [in][out]   stk - pointer to the "EliminationStack"
+*   @param index [out]     index - index of the taken node, which is owned by the current thread
+*
+*   @return true if the node is taken and false if the pop must go back to the head
+*/
+
+static bool elim_try_pop(EliminationStack *stk, uint32_t *index)
+{
+    std::atomic<uint64_t> *slot = &elim_slot(stk)->state;
+
+    uint64_t old_state = slot->load(std::memory_order_acquire);
+
+    if (lf_index(old_state) != LF_NULL)
+    {
+        if (lf_index(old_state) & (ELIM_POP_WAIT | ELIM_DELIVERED))
+            return false;
+
+        uint32_t offered = lf_index(old_state);
+
+        if (!slot->compare_exchange_strong(old_state, lf_tagged(lf_tag(old_state) + 1, LF_NULL),
+                                                      std::memory_order_acq_rel))
+            return false;
+
+        *index = offered;
+        return true;
+    }
+
+    uint64_t wait_state = lf_tagged(lf_tag(old_state) + 1, ELIM_POP_WAIT);
+
+    if (!slot->compare_exchange_strong(old_state, wait_state, std::memory_order_acq_rel))
+        return false;
+
+    for (unsigned counter = 0; counter < ELIM_SPIN; ++counter)
+    {
+        if (slot->load(std::memory_order_acquire) != wait_state)
+            break;
+    }
+
+    if (slot->compare_exchange_strong(wait_state, lf_tagged(lf_tag(wait_state) + 1, LF_NULL),
+                                                  std::memory_order_acq_rel))
+        return false;
+
+    // the failed CAS has loaded the delivered node, only this thread may free the slot now
+    *index = lf_index(wait_state) & ~(uint32_t) ELIM_DELIVERED;
+
+    slot->store(lf_tagged(lf_tag(wait_state) + 1, LF_NULL), std::memory_order_release);
+
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/**
+*   @brief "EliminationStack" constructor. Must not be called concurrently with other functions on the same "stk".
+*
+*   @param stk [out] stk - pointer to the "EliminationStack"
+*
+*   @return bit-mask which encodes the errors from "enum _StackError"
+*/
+
+static unsigned EliminationStackCtor(EliminationStack *stk)
+{
+    if (stk == nullptr)
+    {
+        unsigned err = 0;
+        make_bit_true(&err, STACK_NULLPTR);
+        return err;
+    }
+
+    for (unsigned counter = 0; counter < ELIM_SLOTS; ++counter)
+        stk->slots[counter].state.store(lf_tagged(0, LF_NULL));
+
+    return LockFreeStackCtor(&stk->stk);
+}
+
+/**
+*   @brief "EliminationStack" destructor. Must not be called concurrently with other functions on the same "stk".
+*
+*   @param stk [in][out] stk - pointer to the "EliminationStack"
+*
+*   @return bit-mask which encodes the errors from "enum _StackError"
+*/
+
+static unsigned EliminationStackDtor(EliminationStack *stk)
+{
+    if (stk == nullptr)
+    {
+        unsigned err = 0;
+        make_bit_true(&err, STACK_NULLPTR);
+        return err;
+    }
+
+    return LockFreeStackDtor(&stk->stk);
+}
+
+/**
+*   @brief Adds the element to the front of the "EliminationStack". Thread safe.
+*
+*   @param      stk [in][out]      stk - pointer to the "EliminationStack"
+*   @param push_val [in]      push_val - value to push
+*
+*   @return bit-mask which encodes the errors from "enum _StackError"
+*/
+
+static unsigned EliminationStackPush(EliminationStack *stk, const Stack_elem push_val)
+{
+    unsigned err = 0;
+
+    if (stk == nullptr)
+    {
+        make_bit_true(&err, STACK_NULLPTR);
+        return err;
+    }
+
+    err = LockFreeStackVerify(&stk->stk);
+    if (err)
+        return err;
+
+    uint32_t index = lf_node_alloc(&stk->stk);
+    if (index == LF_NULL)
+    {
+        make_bit_true(&err, MEMORY_LIMIT_EXCEEDED);
+        return err;
+    }
+
+    lf_node(&stk->stk, index)->val = push_val;
+
+    stk->stk.size.fetch_add(1, std::memory_order_relaxed);
+
+    while (!lf_list_try_push(&stk->stk, &stk->stk.head, index))
+    {
+        if (elim_try_push(stk, index))
+            break;
+    }
+
+    return STACK_OK;
+}
+
+/**
+*   @brief Deletes the front element of the "EliminationStack". Puts it in variable pointed by "front_val"
+*   @brief if it isn't nullptr. Thread safe.
+*
+*   @param       stk [in][out]       stk - pointer to the "EliminationStack"
+*   @param front_val [out]     front_val - pointer to the front element
+*
+*   @return bit-mask which encodes the errors from "enum _StackError"
+*/
+
+static unsigned EliminationStackPop(EliminationStack *stk, Stack_elem *const front_val)
+{
+    unsigned err = 0;
+
+    if (stk == nullptr)
+    {
+        make_bit_true(&err, STACK_NULLPTR);
+        return err;
+    }
+
+    err = LockFreeStackVerify(&stk->stk);
+    if (err)
+        return err;
+
+    uint32_t index = LF_NULL;
+
+    while (!lf_list_try_pop(&stk->stk, &stk->stk.head, &index))
+    {
+        if (elim_try_pop(stk, &index))
+            break;
+    }
+
+    if (index == LF_NULL)
+    {
+        make_bit_true(&err, STACK_EMPTY);
+        return err;
+    }
+
+    stk->stk.size.fetch_sub(1, std::memory_order_relaxed);
+
+    if (front_val != nullptr)
+        *front_val = lf_node(&stk->stk, index)->val;
+
+    lf_list_push(&stk->stk, &stk->stk.free_head, index);
+
+    return STACK_OK;
+}
+
+#endif //STACK_ELIMINATION_H
@@ -0,0 +1,105 @@
+/** @file */
+
+#ifndef STACK_FILE_H
+#define STACK_FILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+*   @brief Binary snapshot of a "Stack" (see "StackSave()" and "StackLoad()" of "stack.h").
+*
+*   @brief Layout: [StackFileHeader][elements store]. The store is written byte by byte as "Stack" keeps it in memory:
+*   @brief the left canary, "capacity" elements and the right canary in CANARY_PROTECTION mode, "capacity" elements
+*   @brief without it. The header is 128 bytes, so the store begins at the aligned offset inside the first page of the
+*   @brief file and the mapping of the file is used as the store without copying.
+*
+*   @brief The numbers are in the byte order of the machine which saved the file. Any change of the layout increments
+*   @brief STACK_FILE_VERSION, "StackLoad()" refuses the other versions.
+*/
+
+/**
+*   @brief Modes of "stack.h" which change the store or the hash, the file is loaded only by the build with the same ones.
+*
+*   @param STACK_FILE_CANARY    - CANARY_PROTECTION
+*   @param STACK_FILE_HASH      - HASH_PROTECTION
+*   @param STACK_FILE_CRC32C    - HASH_CRC32C
+*   @param STACK_FILE_MUL64     - HASH_MUL64
+*   @param STACK_FILE_WATERMARK - POISON_WATERMARK
+*/
+
+typedef enum _StackFileFlag
+{
+    STACK_FILE_CANARY    = 1 << 0,
+    STACK_FILE_HASH      = 1 << 1,
+    STACK_FILE_CRC32C    = 1 << 2,
+    STACK_FILE_MUL64     = 1 << 3,
+    STACK_FILE_WATERMARK = 1 << 4
+
+} StackFileFlag;
+
+/**
+*   @brief Header of the snapshot.
+*
+*   @param        magic - STACK_FILE_MAGIC
+*   @param      version - STACK_FILE_VERSION
+*   @param  header_size - sizeof(StackFileHeader), offset of the store in the file
+*   @param    elem_size - sizeof(Stack_elem) of the saved "Stack"
+*   @param        flags - modes of the saved "Stack", bit-mask of "enum _StackFileFlag"
+*   @param         size - "Stack.size"
+*   @param     capacity - "Stack.capacity"
+*   @param     poisoned - "Stack.poisoned" in POISON_WATERMARK mode, "capacity" without it
+*   @param   store_size - size (in bytes) of the store after the header
+*   @param     hash_val - "Stack.hash_val", 0 without HASH_PROTECTION
+*   @param  left_canary - value of the  left canary of the store, 0 without CANARY_PROTECTION
+*   @param right_canary - value of the right canary of the store, 0 without CANARY_PROTECTION
+*/
+
+typedef struct alignas(64) _StackFileHeader
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t elem_size;
+    uint32_t flags;
+
+    uint64_t size;
+    uint64_t capacity;
+    uint64_t poisoned;
+    uint64_t store_size;
+
+    uint64_t hash_val;
+    uint32_t left_canary;
+    uint32_t right_canary;
+
+} StackFileHeader;
+
+const char     STACK_FILE_MAGIC[8] = {'S', 'T', 'K', 'S', 'N', 'A', 'P', '\0'};
+const uint32_t STACK_FILE_VERSION  = 1;
+
+/**
+*   @brief Checks the fields of "header" which don't depend on the "Stack": magic, version, header size,
+*   @brief the size of the file.
+*
+*   @return 1 if they are OK, 0 else
+*/
+
+static int stack_file_header_ok(const StackFileHeader *header, const size_t file_size)
+{
+    if (file_size < sizeof(StackFileHeader))
+        return 0;
+
+    if (memcmp(header->magic, STACK_FILE_MAGIC, sizeof(STACK_FILE_MAGIC)) != 0)
+        return 0;
+
+    if (header->version != STACK_FILE_VERSION || header->header_size != sizeof(StackFileHeader))
+        return 0;
+
+    if (header->size > header->capacity || header->poisoned > header->capacity)
+        return 0;
+
+    return header->store_size <= file_size - sizeof(StackFileHeader);
+}
+
+#endif //STACK_FILE_H
@@ -0,0 +1,123 @@
+/** @file */
+
+#ifndef STACK_FLIGHT_H
+#define STACK_FLIGHT_H
+
+#include <stddef.h>
+#include <inttypes.h>
+#include <assert.h>
+
+#include "stack_latency.h"
+
+/**
+*   @brief Flight recorder: the ring of the last FLIGHT_RECORDS operations of one "Stack".
+*
+*   @brief Recording is a few stores into the ring and one tick read, no branches, no allocations and no log I/O,
+*   @brief so it is cheap enough for the production builds. The ring is written into the log-file only when an error
+*   @brief is found (see "StackDump()" of "stack.h"), so it shows what led up to the error.
+*
+*   @brief Every operation is recorded twice: "flight_begin()" keeps the operation, its argument, size and capacity
+*   @brief before it, "flight_end()" completes the same record by the size and capacity after it. The operation which
+*   @brief failed or is in progress during the dump has no "after" part.
+*/
+
+#ifndef FLIGHT_RECORDS
+    #define FLIGHT_RECORDS 64 ///< number of the kept operations, must be a power of two
+#endif
+
+static_assert((FLIGHT_RECORDS & (FLIGHT_RECORDS - 1)) == 0, "FLIGHT_RECORDS must be a power of two");
+
+const size_t FLIGHT_NOT_ENDED = (size_t) -1; ///< "size_after" of the record whose operation has not ended
+
+/**
+*   @brief One operation in the flight recorder.
+*
+*   @param           op - operation, the "Stack" code knows the values
+*   @param          arg - argument of the operation (pushed value, number of elements, capacity...)
+*   @param        ticks - time of the beginning (see "latency_ticks()")
+*   @param  size_before - size     before the operation
+*   @param   cap_before - capacity before the operation
+*   @param   size_after - size     after  the operation, FLIGHT_NOT_ENDED if it has not ended
+*   @param    cap_after - capacity after  the operation
+*/
+
+typedef struct _FlightRecord
+{
+    unsigned op;
+    uint64_t arg;
+    uint64_t ticks;
+
+    size_t size_before;
+    size_t  cap_before;
+    size_t size_after;
+    size_t  cap_after;
+
+} FlightRecord;
+
+/**
+*   @brief Ring of the last FLIGHT_RECORDS operations.
+*
+*   @param records - the ring, the operation number "count - 1" is the newest one
+*   @param   count - number of the operations recorded ever
+*/
+
+typedef struct _FlightRecorder
+{
+    FlightRecord records[FLIGHT_RECORDS];
+    uint64_t     count;
+
+} FlightRecorder;
+
+/**
+*   @brief Records the beginning of the operation "op".
+*/
+
+static inline void flight_begin(FlightRecorder *flight, const unsigned op, const uint64_t arg,
+                                                        const size_t size, const size_t capacity)
+{
+    assert(flight != nullptr);
+
+    FlightRecord *record = flight->records + (flight->count++ & (FLIGHT_RECORDS - 1));
+
+    record->op          = op;
+    record->arg         = arg;
+    record->ticks       = latency_ticks();
+    record->size_before = size;
+    record->cap_before  = capacity;
+    record->size_after  = FLIGHT_NOT_ENDED;
+    record->cap_after   = 0;
+}
+
+/**
+*   @brief Completes the newest record by the size and capacity after the operation.
+*/
+
+static inline void flight_end(FlightRecorder *flight, const size_t size, const size_t capacity)
+{
+    assert(flight != nullptr);
+
+    if (flight->count == 0)
+        return;
+
+    FlightRecord *record = flight->records + ((flight->count - 1) & (FLIGHT_RECORDS - 1));
+
+    record->size_after = size;
+    record->cap_after  = capacity;
+}
+
+/**
+*   @brief Returns the record which is "back" operations older than the newest one ("back" = 0 is the newest),
+*   @brief nullptr if it is not kept.
+*/
+
+static inline const FlightRecord *flight_get(const FlightRecorder *flight, const uint64_t back)
+{
+    assert(flight != nullptr);
+
+    if (back >= flight->count || back >= FLIGHT_RECORDS)
+        return nullptr;
+
+    return flight->records + ((flight->count - 1 - back) & (FLIGHT_RECORDS - 1));
+}
+
+#endif //STACK_FLIGHT_H
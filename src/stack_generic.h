@@ -0,0 +1,112 @@
+#ifndef STACK_GENERIC_H
+#define STACK_GENERIC_H
+
+#include "../lib/var_declaration.h"
+
+/**
+*   @brief Type-erased "Stack": elements of any type are stored as "elem_size" raw bytes,
+*   @brief so one binary may hold stacks of many element types. Implemented in "stack.cpp".
+*
+*   @param          data - pointer to the elements store
+*   @param     elem_size - size (in bytes) of one element
+*   @param     data_size - number of elements in the "Stack"
+*   @param data_capacity - number of elements which may be fit in allocated memory
+*   @param       is_ctor - marker if "Stack" already constructed
+*   @param     elem_copy - copy routine specialized for the "elem_size" (see "Stack_ctor()")
+*   @param      var_info - information about "Stack" variable declaration
+*/
+
+typedef void (*elem_copy_t) (void *dest, const void *src, const int elem_size);
+
+struct Stack
+{
+    void *data;
+
+    int elem_size;
+    int data_size;
+    int data_capacity;
+
+    bool is_ctor;
+
+    elem_copy_t elem_copy;
+
+    var_declaration var_info;
+};
+
+enum STACK_ERRORS
+{
+    OK                      ,
+
+    NULLPTR_STACK           ,
+    NULLPTR_STACK_INFO      ,
+
+    ALREADY_CTORED          ,
+    NOT_YET_CTORED          ,
+
+    NEGATIVE_ELEM_SIZE      ,
+    NEGATIVE_DATA_SIZE      ,
+    NEGATIVE_DATA_CAPCITY   ,
+
+    INVALID_CAPACITY        ,
+    INVALID_DATA            ,
+
+    MEMORY_LIMIT_EXCEEDED   ,
+
+    EMPTY_STACK             ,
+};
+
+/*___________________________FUNCTION_DECLARATION___________________________*/
+
+/**
+*   @brief "Stack" constructor. Use "stack_ctor" macros to fill the declaration information automatically.
+*
+*   @param       stk [out] - pointer to the "Stack" to construct
+*   @param elem_size [in]  - size (in bytes) of one element, must be positive
+*   @param      file [in]  - name of the file     where the "Stack" variable was declared
+*   @param      func [in]  - name of the function where the "Stack" variable was declared
+*   @param      name [in]  - name of the "Stack" variable with '&' before
+*   @param      line [in]  - number of the line   where the "Stack" variable was declared
+*
+*   @return bit-mask which encodes the errors from "enum STACK_ERRORS"
+*/
+unsigned int Stack_ctor (Stack *const stk, const int elem_size, const char *file, const char *func, const char *name, const int line);
+
+/**
+*   @brief "Stack" destructor. Frees the elements store and fills "Stack" by poison-values.
+*
+*   @return bit-mask which encodes the errors from "enum STACK_ERRORS"
+*/
+unsigned int Stack_dtor (Stack *const stk);
+
+/**
+*   @brief Checks if "Stack" is invalid.
+*
+*   @return bit-mask which encodes the errors from "enum STACK_ERRORS"
+*/
+unsigned int Stack_verify (Stack *const stk);
+
+/**
+*   @brief Adds the element to the end of "Stack".
+*
+*   @param      stk [in][out] - pointer to the "Stack"
+*   @param push_val [in]      - pointer to the "elem_size" bytes of element to put
+*
+*   @return bit-mask which encodes the errors from "enum STACK_ERRORS"
+*/
+unsigned int Stack_push (Stack *const stk, const void *push_val);
+
+/**
+*   @brief Deletes the element from the end of "Stack".
+*
+*   @param       stk [in][out] - pointer to the "Stack"
+*   @param front_val [out]     - pointer to the "elem_size" bytes to put the deleted element, may be nullptr
+*
+*   @return bit-mask which encodes the errors from "enum STACK_ERRORS"
+*/
+unsigned int Stack_pop (Stack *const stk, void *front_val);
+
+/*__________________________________________________________________________*/
+
+#define stack_ctor(stk, elem_size) Stack_ctor(stk, elem_size, __FILE__, __PRETTY_FUNCTION__, #stk, __LINE__)
+
+#endif //STACK_GENERIC_H
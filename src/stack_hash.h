@@ -0,0 +1,372 @@
+/** @file */
+
+#ifndef STACK_HASH_H
+#define STACK_HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+    #define HASH_X86
+#endif
+
+/**
+*   @brief Hash functions of the elements store. All of them are seeded by "seed" and hash "len" bytes of "buf".
+*
+*   @brief hash_djb2()   - legacy byte-serial djb2 (hash * 33 + byte), about one byte per cycle. It is the polynomial
+*   @brief                 of bytes, so HASH_INCREMENTAL mode updates it in O(changed bytes).
+*   @brief hash_crc32c() - CRC32C, by the SSE4.2 crc32 instruction in 3 interleaved streams if the CPU has it,
+*   @brief                 by the table otherwise. The result has 32 significant bits.
+*   @brief hash_mul64()  - polynomial of 64-bit words modulo 2^64 with an odd multiplier, computed in 4 independent
+*   @brief                 lanes (8 lanes of AVX-512DQ if the CPU has it) and mixed by the finalizer. Any change of
+*   @brief                 one word always changes the result, as for djb2.
+*
+*   @brief Kernels are chosen once at the first call by cpuid, the result doesn't depend on the chosen kernel.
+*/
+
+/*------------------------------------------------------DJB2----------------------------------------------------------*/
+
+static unsigned long long hash_djb2(const void *_buf, const size_t len, const unsigned long long seed)
+{
+    assert(_buf != nullptr || len == 0);
+
+    const unsigned char *buf = (const unsigned char *) _buf;
+    unsigned long long   ret = seed;
+
+    for (size_t counter = 0; counter < len; ++counter)
+    {
+        ret = ((ret << 5) + ret) + buf[counter];
+    }
+
+    return ret;
+}
+
+/*-----------------------------------------------------CRC32C---------------------------------------------------------*/
+
+/**
+*   @brief Constants of CRC32C.
+*
+*   @param CRC32C_POLY  - reflected Castagnoli polynomial
+*   @param CRC32C_BLOCK - size (in bytes) of one of the 3 streams of the hardware kernel
+*/
+
+enum _Crc32cConst
+{
+    CRC32C_POLY  = 0x82F63B78u,
+    CRC32C_BLOCK = 8192
+};
+
+static const uint32_t *crc32c_table()
+{
+    static uint32_t table[256] = {};
+    static bool     is_ready   = [] ()
+    {
+        for (uint32_t byte = 0; byte < 256; ++byte)
+        {
+            uint32_t crc = byte;
+
+            for (int bit = 0; bit < 8; ++bit)
+                crc = (crc >> 1) ^ (CRC32C_POLY & (0u - (crc & 1u)));
+
+            table[byte] = crc;
+        }
+        return true;
+    } ();
+
+    (void) is_ready;
+    return table;
+}
+
+static uint32_t crc32c_sw(uint32_t crc, const unsigned char *buf, size_t len)
+{
+    const uint32_t *table = crc32c_table();
+
+    for (size_t counter = 0; counter < len; ++counter)
+        crc = table[(crc ^ buf[counter]) & 0xFFu] ^ (crc >> 8);
+
+    return crc;
+}
+
+/**
+*   @brief Operator of appending CRC32C_BLOCK zero bytes to the CRC state: column "i" is the state after appending
+*   @brief the zeros to the state with the only bit "i". It is linear, so it moves the CRC of a stream to the end of
+*   @brief the next stream.
+*/
+
+static const uint32_t *crc32c_shift_operator()
+{
+    static uint32_t columns[32] = {};
+    static bool     is_ready    = [] ()
+    {
+        static const unsigned char zeros[CRC32C_BLOCK] = {};
+
+        for (int bit = 0; bit < 32; ++bit)
+            columns[bit] = crc32c_sw(1u << bit, zeros, CRC32C_BLOCK);
+
+        return true;
+    } ();
+
+    (void) is_ready;
+    return columns;
+}
+
+static inline uint32_t crc32c_shift(const uint32_t *columns, uint32_t crc)
+{
+    uint32_t ret = 0;
+
+    for (int bit = 0; crc != 0; ++bit, crc >>= 1)
+    {
+        if (crc & 1u)
+            ret ^= columns[bit];
+    }
+
+    return ret;
+}
+
+#ifdef HASH_X86
+
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_hw(uint32_t crc, const unsigned char *buf, size_t len)
+{
+    // latency of crc32 is 3 cycles and throughput is 1, so 3 independent streams keep the unit busy
+    if (len >= 3 * CRC32C_BLOCK)
+    {
+        const uint32_t *columns = crc32c_shift_operator();
+
+        for (; len >= 3 * CRC32C_BLOCK; buf += 3 * CRC32C_BLOCK, len -= 3 * CRC32C_BLOCK)
+        {
+            uint64_t crc0 = crc, crc1 = 0, crc2 = 0;
+
+            for (size_t counter = 0; counter < CRC32C_BLOCK; counter += sizeof(uint64_t))
+            {
+                uint64_t word0 = 0, word1 = 0, word2 = 0;
+
+                memcpy(&word0, buf                    + counter, sizeof(uint64_t));
+                memcpy(&word1, buf +     CRC32C_BLOCK + counter, sizeof(uint64_t));
+                memcpy(&word2, buf + 2 * CRC32C_BLOCK + counter, sizeof(uint64_t));
+
+                crc0 = _mm_crc32_u64(crc0, word0);
+                crc1 = _mm_crc32_u64(crc1, word1);
+                crc2 = _mm_crc32_u64(crc2, word2);
+            }
+
+            crc = crc32c_shift(columns, (uint32_t) crc0) ^ (uint32_t) crc1;
+            crc = crc32c_shift(columns, crc)             ^ (uint32_t) crc2;
+        }
+    }
+
+    uint64_t crc64 = crc;
+
+    for (; len >= sizeof(uint64_t); buf += sizeof(uint64_t), len -= sizeof(uint64_t))
+    {
+        uint64_t word = 0;
+        memcpy(&word, buf, sizeof(uint64_t));
+
+        crc64 = _mm_crc32_u64(crc64, word);
+    }
+
+    crc = (uint32_t) crc64;
+
+    for (; len > 0; ++buf, --len)
+        crc = _mm_crc32_u8(crc, *buf);
+
+    return crc;
+}
+
+#endif //HASH_X86
+
+/*------------------------------------------------------MUL64---------------------------------------------------------*/
+
+/**
+*   @brief HASH_MUL_K - multiplier of "hash_mul64()", odd, so the weight of every word is invertible modulo 2^64
+*/
+
+const uint64_t HASH_MUL_K = 0x9E3779B97F4A7C15ull;
+
+static inline uint64_t hash_mul_pow(uint64_t base, unsigned exp)
+{
+    uint64_t ret = 1;
+
+    for (; exp; exp >>= 1, base *= base)
+    {
+        if (exp & 1u)
+            ret *= base;
+    }
+
+    return ret;
+}
+
+/**
+*   @brief Adds the words and the tail bytes after the lanes to the polynomial "poly" and mixes the result.
+*/
+
+static uint64_t hash_mul_finish(uint64_t poly, const unsigned char *buf, size_t rest, const size_t len)
+{
+    for (; rest >= sizeof(uint64_t); buf += sizeof(uint64_t), rest -= sizeof(uint64_t))
+    {
+        uint64_t word = 0;
+        memcpy(&word, buf, sizeof(uint64_t));
+
+        poly = poly * HASH_MUL_K + word;
+    }
+
+    if (rest > 0)
+    {
+        uint64_t word = 0;
+        memcpy(&word, buf, rest);
+
+        poly = poly * HASH_MUL_K + word;
+    }
+
+    // finalizer of MurmurHash3 is a bijection, so it keeps the different polynomials different
+    poly ^= len;
+    poly ^= poly >> 33;
+    poly *= 0xFF51AFD7ED558CCDull;
+    poly ^= poly >> 33;
+    poly *= 0xC4CEB9FE1A85EC53ull;
+    poly ^= poly >> 33;
+
+    return poly;
+}
+
+static uint64_t hash_mul64_scalar(const unsigned char *buf, const size_t len, const uint64_t seed)
+{
+    static const uint64_t K2 = HASH_MUL_K * HASH_MUL_K;
+    static const uint64_t K3 = K2 * HASH_MUL_K;
+    static const uint64_t K4 = K2 * K2;
+
+    // seed is in the last lane, so it gets the weight K^(number of words) for any number of lanes
+    uint64_t acc0 = 0, acc1 = 0, acc2 = 0, acc3 = seed;
+
+    size_t counter = 0;
+
+    for (; counter + 4 * sizeof(uint64_t) <= len; counter += 4 * sizeof(uint64_t))
+    {
+        uint64_t words[4] = {};
+        memcpy(words, buf + counter, sizeof(words));
+
+        acc0 = acc0 * K4 + words[0];
+        acc1 = acc1 * K4 + words[1];
+        acc2 = acc2 * K4 + words[2];
+        acc3 = acc3 * K4 + words[3];
+    }
+
+    uint64_t poly = acc0 * K3 + acc1 * K2 + acc2 * HASH_MUL_K + acc3;
+
+    return hash_mul_finish(poly, buf + counter, len - counter, len);
+}
+
+#ifdef HASH_X86
+
+__attribute__((target("avx512f,avx512dq")))
+static uint64_t hash_mul64_avx512(const unsigned char *buf, const size_t len, const uint64_t seed)
+{
+    static const uint64_t K8 = hash_mul_pow(HASH_MUL_K, 8);
+
+    const __m512i k8  = _mm512_set1_epi64((long long) K8);
+    __m512i       acc = _mm512_set_epi64((long long) seed, 0, 0, 0, 0, 0, 0, 0);
+
+    size_t counter = 0;
+
+    for (; counter + 64 <= len; counter += 64)
+    {
+        __m512i words = _mm512_loadu_si512((const void *) (buf + counter));
+
+        acc = _mm512_add_epi64(_mm512_mullo_epi64(acc, k8), words);
+    }
+
+    uint64_t lanes[8] = {};
+    _mm512_storeu_si512((void *) lanes, acc);
+
+    uint64_t poly = 0;
+
+    for (int lane = 0; lane < 8; ++lane)
+        poly = poly * HASH_MUL_K + lanes[lane];
+
+    return hash_mul_finish(poly, buf + counter, len - counter, len);
+}
+
+#endif //HASH_X86
+
+/*----------------------------------------------------DISPATCH--------------------------------------------------------*/
+
+/**
+*   @brief Kernels chosen for the current CPU.
+*
+*   @param crc32c - kernel of "hash_crc32c()", updates the CRC state without the inversions
+*   @param  mul64 - kernel of "hash_mul64()"
+*/
+
+typedef struct _HashKernels
+{
+    uint32_t (*crc32c)(uint32_t crc, const unsigned char *buf, size_t len);
+    uint64_t (*mul64) (const unsigned char *buf, const size_t len, const uint64_t seed);
+
+} HashKernels;
+
+static HashKernels hash_kernels_detect()
+{
+    HashKernels kernels = {crc32c_sw, hash_mul64_scalar};
+
+    #ifdef HASH_X86
+
+        __builtin_cpu_init();
+
+        if (__builtin_cpu_supports("sse4.2"))
+            kernels.crc32c = crc32c_hw;
+
+        if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq"))
+            kernels.mul64 = hash_mul64_avx512;
+
+    #endif
+
+    return kernels;
+}
+
+static const HashKernels *hash_kernels()
+{
+    static const HashKernels kernels = hash_kernels_detect();
+
+    return &kernels;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/**
+*   @brief Counts CRC32C of the buffer.
+*
+*   @param _buf [in] _buf - pointer to the buffer
+*   @param  len [in]  len - size (in bytes) of the buffer
+*   @param seed [in] seed - initial value, only the low 32 bits are used
+*
+*   @return CRC32C
+*/
+
+static inline unsigned long long hash_crc32c(const void *_buf, const size_t len, const unsigned long long seed)
+{
+    assert(_buf != nullptr || len == 0);
+
+    return ~hash_kernels()->crc32c(~(uint32_t) seed, (const unsigned char *) _buf, len);
+}
+
+/**
+*   @brief Counts the multiply-based 64-bit hash of the buffer.
+*
+*   @param _buf [in] _buf - pointer to the buffer
+*   @param  len [in]  len - size (in bytes) of the buffer
+*   @param seed [in] seed - initial value
+*
+*   @return hash value
+*/
+
+static inline unsigned long long hash_mul64(const void *_buf, const size_t len, const unsigned long long seed)
+{
+    assert(_buf != nullptr || len == 0);
+
+    return hash_kernels()->mul64((const unsigned char *) _buf, len, seed);
+}
+
+#endif //STACK_HASH_H
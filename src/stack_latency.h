@@ -0,0 +1,275 @@
+/** @file */
+
+#ifndef STACK_LATENCY_H
+#define STACK_LATENCY_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <inttypes.h>
+#include <time.h>
+#include <assert.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+    #define LATENCY_X86
+#endif
+
+/**
+*   @brief Log-linear (HDR-style) histograms of the operation latencies.
+*
+*   @brief Latencies are recorded in ticks: TSC on x86, nanoseconds of CLOCK_MONOTONIC on the other targets.
+*   @brief Every power of two [2^k, 2^(k+1)) is split into LATENCY_SUB_HALF equal buckets, so the error of any
+*   @brief reported value is less than 1 / LATENCY_SUB_HALF of it, and the values below LATENCY_SUB_COUNT are exact.
+*   @brief "latency_record()" is constant time: one bsr, one shift and one increment, no branches over the buckets.
+*
+*   @brief The ticks are converted to nanoseconds only by the reports ("latency_percentile()", "latency_print()"),
+*   @brief the TSC frequency is measured once at the first report. Histograms of one process have the same ticks,
+*   @brief so they can be merged.
+*/
+
+/**
+*   @brief Constants of the histogram.
+*
+*   @param LATENCY_SUB_BITS  - bits of the value kept by the bucket index (precision is 2^-(LATENCY_SUB_BITS - 1))
+*   @param LATENCY_SUB_COUNT - number of the exact buckets of the small values
+*   @param LATENCY_SUB_HALF  - number of the buckets of every next power of two
+*   @param LATENCY_MAX_BITS  - values since 2^LATENCY_MAX_BITS ticks (minutes) are counted in the last bucket
+*   @param LATENCY_BUCKETS   - number of the buckets
+*/
+
+enum _LatencyConst
+{
+    LATENCY_SUB_BITS  = 5,
+    LATENCY_SUB_COUNT = 1 << LATENCY_SUB_BITS,
+    LATENCY_SUB_HALF  = LATENCY_SUB_COUNT / 2,
+    LATENCY_MAX_BITS  = 40,
+    LATENCY_BUCKETS   = (LATENCY_MAX_BITS - LATENCY_SUB_BITS + 2) * LATENCY_SUB_HALF
+};
+
+/**
+*   @brief Histogram of the latencies of one operation.
+*
+*   @param   count - number of recorded values
+*   @param     sum - sum of recorded values (in ticks)
+*   @param     min - minimal recorded value (in ticks), exact
+*   @param     max - maximal recorded value (in ticks), exact
+*   @param buckets - counters of the log-linear buckets
+*/
+
+typedef struct _LatencyHist
+{
+    uint64_t count;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+
+    uint64_t buckets[LATENCY_BUCKETS];
+
+} LatencyHist;
+
+/*------------------------------------------------------TICKS---------------------------------------------------------*/
+
+static inline uint64_t latency_ticks()
+{
+    #ifdef LATENCY_X86
+
+        return __rdtsc();
+
+    #else
+
+        struct timespec now = {};
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        return (uint64_t) now.tv_sec * 1000000000ull + (uint64_t) now.tv_nsec;
+
+    #endif
+}
+
+static double latency_calibrate()
+{
+    #ifdef LATENCY_X86
+
+        struct timespec start = {}, now = {};
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
+        uint64_t start_ticks = __rdtsc();
+        double   elapsed_ns  = 0;
+
+        // 10 ms keep the error of the frequency below 0.1% even with the coarse clock
+        do
+        {
+            clock_gettime(CLOCK_MONOTONIC, &now);
+
+            elapsed_ns = (double) (now.tv_sec - start.tv_sec) * 1e9 + (double) (now.tv_nsec - start.tv_nsec);
+        }
+        while (elapsed_ns < 1e7);
+
+        uint64_t elapsed_ticks = __rdtsc() - start_ticks;
+
+        return (elapsed_ticks != 0) ? elapsed_ns / (double) elapsed_ticks : 1.0;
+
+    #else
+
+        return 1.0;
+
+    #endif
+}
+
+/**
+*   @brief Returns the number of nanoseconds in one tick, measures it at the first call.
+*/
+
+static double latency_ns_per_tick()
+{
+    static const double ns_per_tick = latency_calibrate();
+
+    return ns_per_tick;
+}
+
+/*-----------------------------------------------------BUCKETS--------------------------------------------------------*/
+
+/**
+*   @brief Returns the index of the bucket of "value".
+*/
+
+static inline size_t latency_bucket(uint64_t value)
+{
+    if (value >= (1ull << LATENCY_MAX_BITS))
+        return LATENCY_BUCKETS - 1;
+
+    if (value < LATENCY_SUB_COUNT)
+        return (size_t) value;
+
+    // the highest bit is in [LATENCY_SUB_BITS, LATENCY_MAX_BITS), so "value >> shift" is in [SUB_HALF, SUB_COUNT)
+    unsigned shift = (unsigned) (63 - __builtin_clzll(value)) - (LATENCY_SUB_BITS - 1);
+
+    return (size_t) (shift + 1) * LATENCY_SUB_HALF + (size_t) (value >> shift) - LATENCY_SUB_HALF;
+}
+
+/**
+*   @brief Returns the highest value which is counted in the bucket "index".
+*/
+
+static inline uint64_t latency_bucket_top(size_t index)
+{
+    if (index < LATENCY_SUB_COUNT)
+        return (uint64_t) index;
+
+    unsigned shift = (unsigned) (index / LATENCY_SUB_HALF) - 1;
+    uint64_t sub   = (uint64_t) (index % LATENCY_SUB_HALF) + LATENCY_SUB_HALF;
+
+    return ((sub + 1) << shift) - 1;
+}
+
+/*-----------------------------------------------------RECORD---------------------------------------------------------*/
+
+/**
+*   @brief Counts the latency "ticks" in the histogram.
+*
+*   @param  hist [in][out] hist - pointer to the histogram
+*   @param ticks [in]     ticks - latency (in ticks)
+*/
+
+static inline void latency_record(LatencyHist *hist, const uint64_t ticks)
+{
+    assert(hist != nullptr);
+
+    if (hist->count == 0 || ticks < hist->min) hist->min = ticks;
+    if (ticks > hist->max)                     hist->max = ticks;
+
+    ++hist->count;
+    hist->sum += ticks;
+
+    ++hist->buckets[latency_bucket(ticks)];
+}
+
+/**
+*   @brief Adds all values of the histogram "src" to the histogram "dst".
+*
+*   @param dst [in][out] dst - pointer to the histogram which gets the values
+*   @param src [in]      src - pointer to the added histogram
+*/
+
+static void latency_merge(LatencyHist *dst, const LatencyHist *src)
+{
+    assert(dst != nullptr);
+    assert(src != nullptr);
+
+    if (src->count == 0)
+        return;
+
+    if (dst->count == 0 || src->min < dst->min) dst->min = src->min;
+    if (src->max > dst->max)                    dst->max = src->max;
+
+    dst->count += src->count;
+    dst->sum   += src->sum;
+
+    for (size_t index = 0; index < LATENCY_BUCKETS; ++index)
+        dst->buckets[index] += src->buckets[index];
+}
+
+/*-----------------------------------------------------REPORT---------------------------------------------------------*/
+
+/**
+*   @brief Returns the latency (in nanoseconds) which is not less than "percent" percents of the recorded values.
+*   @brief The result is the top of the bucket, but never more than the exact maximum.
+*
+*   @param    hist [in]    hist - pointer to the histogram
+*   @param percent [in] percent - percentile in [0, 100]
+*
+*   @return percentile (in nanoseconds), 0 if the histogram is empty
+*/
+
+static double latency_percentile(const LatencyHist *hist, const double percent)
+{
+    assert(hist != nullptr);
+
+    if (hist->count == 0)
+        return 0;
+
+    uint64_t rank = (uint64_t) (percent / 100.0 * (double) hist->count + 0.5);
+
+    if (rank == 0)           rank = 1;
+    if (rank > hist->count)  rank = hist->count;
+
+    uint64_t seen = 0;
+    uint64_t top  = hist->max;
+
+    for (size_t index = 0; index < LATENCY_BUCKETS; ++index)
+    {
+        seen += hist->buckets[index];
+
+        if (seen >= rank)
+        {
+            top = latency_bucket_top(index);
+            break;
+        }
+    }
+
+    if (top > hist->max) top = hist->max;
+    if (top < hist->min) top = hist->min;
+
+    return (double) top * latency_ns_per_tick();
+}
+
+/**
+*   @brief Prints one line of the histogram "hist" with the name "name": number of values, mean, p50, p99, p999 and
+*   @brief the maximum (in nanoseconds).
+*/
+
+static void latency_print(FILE *stream, const char *name, const LatencyHist *hist)
+{
+    assert(stream != nullptr);
+    assert(name   != nullptr);
+    assert(hist   != nullptr);
+
+    double ns_per_tick = latency_ns_per_tick();
+    double mean        = (hist->count != 0) ? (double) hist->sum / (double) hist->count * ns_per_tick : 0;
+
+    fprintf(stream, "%-8s count = %-10" PRIu64 " mean = %-10.0f p50 = %-10.0f p99 = %-10.0f p999 = %-10.0f max = %.0f ns\n",
+                    name, hist->count, mean, latency_percentile(hist, 50),
+                                             latency_percentile(hist, 99),
+                                             latency_percentile(hist, 99.9), (double) hist->max * ns_per_tick);
+}
+
+#endif //STACK_LATENCY_H
@@ -0,0 +1,440 @@
+/** @file */
+
+#ifndef STACK_LOCKFREE_H
+#define STACK_LOCKFREE_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <assert.h>
+#include <atomic>
+
+#include "stack_common.h"
+
+/**
+*   @brief Lock-free LIFO of "Stack_elem" (Treiber stack) which may be used by many threads at once.
+*   @brief "Stack_elem" must be defined before the header the same way as for "stack.h".
+*
+*   @brief Elements are kept in nodes of a linked list, push and pop are one CAS on the 64-bit head word:
+*   @brief   head = (tag << 32) | index of the front node
+*   @brief Every successful CAS increments the tag, so the ABA problem (the front node was popped, reused and pushed
+*   @brief back between the load and the CAS of another thread) makes the CAS fail instead of corrupting the list.
+*
+*   @brief Memory reclamation: nodes are never freed until "LockFreeStackDtor()", popped nodes go to the lock-free
+*   @brief free list (the same tagged Treiber stack) and are reused by the next pushes. So a thread which has loaded
+*   @brief a stale front index may still read its "next" field safely, the CAS rejects the stale value afterwards.
+*   @brief Nodes are allocated by chunks of LF_CHUNK_SIZE, chunks are never moved, so indexes stay valid.
+*
+*   @brief The stack doesn't write the log: LOG_STREAM and TAB_SHIFT of "stack.h" are not thread safe.
+*   @brief Errors are reported by the same bit-mask of "enum _StackError" as "stack.h" does.
+*/
+
+/**
+*   @brief Constants of the node store.
+*
+*   @param LF_CHUNK_SIZE - number of nodes in one chunk
+*   @param LF_CHUNKS_MAX - maximum number of chunks, so the stack holds at most LF_CHUNK_SIZE * LF_CHUNKS_MAX - 1 elements
+*   @param LF_NULL       - index of no node (node 0 is never used)
+*/
+
+enum _LockFreeConst
+{
+    LF_CHUNK_SIZE = 1 << 12,
+    LF_CHUNKS_MAX = 1 << 16,
+    LF_NULL       = 0
+};
+
+/**
+*   @brief Node of the "LockFreeStack".
+*
+*   @param next - index of the next node, atomic because a stale reader may load it while the node is reused
+*   @param  val - element, is accessed only by the thread which owns the node
+*/
+
+typedef struct _LockFreeNode
+{
+    std::atomic<uint32_t> next;
+    Stack_elem            val;
+
+} LockFreeNode;
+
+/**
+*   @brief Lock-free "Stack".
+*
+*   @param      head - tagged index of the front node
+*   @param free_head - tagged index of the front node of the free list
+*   @param nodes_num - number of nodes which were ever taken from the chunks (including node 0)
+*   @param      size - number of elements, exact only when no push or pop is running
+*   @param    chunks - directory of the node chunks, a chunk is allocated by the first node taken from it
+*   @param   is_Ctor - shows if "LockFreeStack" has been already constructed
+*/
+
+typedef struct _LockFreeStack
+{
+    std::atomic<uint64_t>        head;
+    std::atomic<uint64_t>   free_head;
+    std::atomic<uint32_t>   nodes_num;
+    std::atomic<size_t>          size;
+
+    std::atomic<LockFreeNode *> *chunks;
+
+    bool is_Ctor;
+
+} LockFreeStack;
+
+/*---------------------------------------------FUNCTIONS_DECLARATION--------------------------------------------------*/
+
+static unsigned LockFreeStackCtor  (LockFreeStack *stk);
+static unsigned LockFreeStackDtor  (LockFreeStack *stk);
+static unsigned LockFreeStackVerify(LockFreeStack *stk);
+
+static unsigned LockFreeStackPush  (LockFreeStack *stk, const Stack_elem push_val);
+static unsigned LockFreeStackPop   (LockFreeStack *stk,       Stack_elem *const front_val = nullptr);
+static size_t   LockFreeStackSize  (LockFreeStack *stk);
+
+static LockFreeNode *lf_node      (LockFreeStack *stk, const uint32_t index);
+static uint32_t      lf_node_alloc(LockFreeStack *stk);
+static void          lf_list_push (LockFreeStack *stk, std::atomic<uint64_t> *list, const uint32_t index);
+static uint32_t      lf_list_pop  (LockFreeStack *stk, std::atomic<uint64_t> *list);
+
+static bool lf_list_try_push(LockFreeStack *stk, std::atomic<uint64_t> *list, const uint32_t  index);
+static bool lf_list_try_pop (LockFreeStack *stk, std::atomic<uint64_t> *list,       uint32_t *index);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+static inline uint32_t lf_index(const uint64_t tagged) { return (uint32_t)  tagged;        }
+static inline uint32_t lf_tag  (const uint64_t tagged) { return (uint32_t) (tagged >> 32); }
+
+static inline uint64_t lf_tagged(const uint32_t tag, const uint32_t index)
+{
+    return ((uint64_t) tag << 32) | index;
+}
+
+/**
+*   @brief Returns the node by its index. The chunk of the node must be already allocated.
+*
+*   @param   stk [in]   stk - pointer to the "LockFreeStack"
+*   @param index [in] index - index of the node
+*
+*   @return pointer to the node
+*/
+
+static LockFreeNode *lf_node(LockFreeStack *stk, const uint32_t index)
+{
+    LockFreeNode *chunk = stk->chunks[index / LF_CHUNK_SIZE].load(std::memory_order_acquire);
+
+    assert(chunk != nullptr);
+
+    return chunk + index % LF_CHUNK_SIZE;
+}
+
+/**
+*   @brief Makes one attempt to push the node owned by the current thread to the tagged list ("head" or "free_head").
+*   @brief Release CAS publishes the node's "val" and "next" to the thread which pops it.
+*
+*   @param   stk [in][out]   stk - pointer to the "LockFreeStack"
+*   @param  list [in][out]  list - head of the list
+*   @param index [in]      index - index of the node
+*
+*   @return true if the node is pushed and false if the CAS has lost the race with another thread
+*/
+
+static bool lf_list_try_push(LockFreeStack *stk, std::atomic<uint64_t> *list, const uint32_t index)
+{
+    LockFreeNode *node = lf_node(stk, index);
+
+    uint64_t old_head = list->load(std::memory_order_relaxed);
+
+    node->next.store(lf_index(old_head), std::memory_order_relaxed);
+
+    return list->compare_exchange_strong(old_head, lf_tagged(lf_tag(old_head) + 1, index), std::memory_order_release,
+                                                                                           std::memory_order_relaxed);
+}
+
+/**
+*   @brief Makes one attempt to pop the front node of the tagged list ("head" or "free_head").
+*   @brief After the successful CAS the node is owned by the current thread only.
+*
+*   @param   stk [in][out]   stk - pointer to the "LockFreeStack"
+*   @param  list [in][out]  list - head of the list
+*   @param index [out]     index - index of the popped node or LF_NULL if the list is empty
+*
+*   @return true if the node is popped or the list is empty and false if the CAS has lost the race with another thread
+*/
+
+static bool lf_list_try_pop(LockFreeStack *stk, std::atomic<uint64_t> *list, uint32_t *index)
+{
+    uint64_t old_head = list->load(std::memory_order_acquire);
+
+    *index = lf_index(old_head);
+    if (*index == LF_NULL)
+        return true;
+
+    // the node may be already popped and reused by another thread, then "next" is garbage, but the tag differs
+    uint32_t next = lf_node(stk, *index)->next.load(std::memory_order_relaxed);
+
+    return list->compare_exchange_strong(old_head, lf_tagged(lf_tag(old_head) + 1, next), std::memory_order_acquire,
+                                                                                          std::memory_order_relaxed);
+}
+
+/**
+*   @brief Pushes the node owned by the current thread to the tagged list ("head" or "free_head").
+*
+*   @param   stk [in][out]   stk - pointer to the "LockFreeStack"
+*   @param  list [in][out]  list - head of the list
+*   @param index [in]      index - index of the node
+*
+*   @return nothing
+*/
+
+static void lf_list_push(LockFreeStack *stk, std::atomic<uint64_t> *list, const uint32_t index)
+{
+    while (!lf_list_try_push(stk, list, index))
+        ;
+}
+
+/**
+*   @brief Pops the front node of the tagged list ("head" or "free_head").
+*
+*   @param  stk [in][out]  stk - pointer to the "LockFreeStack"
+*   @param list [in][out] list - head of the list
+*
+*   @return index of the popped node or LF_NULL if the list is empty
+*/
+
+static uint32_t lf_list_pop(LockFreeStack *stk, std::atomic<uint64_t> *list)
+{
+    uint32_t index = LF_NULL;
+
+    while (!lf_list_try_pop(stk, list, &index))
+        ;
+
+    return index;
+}
+
+/**
+*   @brief Takes a node from the free list or, if it is empty, the next never used node.
+*   @brief The first node of the chunk allocates it, threads racing for one chunk install it by CAS.
+*
+*   @param stk [in][out] stk - pointer to the "LockFreeStack"
+*
+*   @return index of the node or LF_NULL if the memory limit is exceeded
+*/
+
+static uint32_t lf_node_alloc(LockFreeStack *stk)
+{
+    uint32_t index = lf_list_pop(stk, &stk->free_head);
+    if (index != LF_NULL)
+        return index;
+
+    index = stk->nodes_num.fetch_add(1, std::memory_order_relaxed);
+    if (index >= (uint32_t) LF_CHUNK_SIZE * LF_CHUNKS_MAX)
+    {
+        stk->nodes_num.fetch_sub(1, std::memory_order_relaxed);
+        return LF_NULL;
+    }
+
+    std::atomic<LockFreeNode *> *chunk_ptr = stk->chunks + index / LF_CHUNK_SIZE;
+
+    if (chunk_ptr->load(std::memory_order_acquire) == nullptr)
+    {
+        LockFreeNode *new_chunk = (LockFreeNode *) calloc(LF_CHUNK_SIZE, sizeof(LockFreeNode));
+        if (new_chunk == nullptr)
+            return LF_NULL; // the index is lost, the next thread will retry the allocation of the chunk
+
+        LockFreeNode *expected = nullptr;
+        if (!chunk_ptr->compare_exchange_strong(expected, new_chunk, std::memory_order_acq_rel))
+            free(new_chunk);
+    }
+
+    return index;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/**
+*   @brief "LockFreeStack" constructor. Must not be called concurrently with other functions on the same "stk".
+*
+*   @param stk [out] stk - pointer to the "LockFreeStack"
+*
+*   @return bit-mask which encodes the errors from "enum _StackError"
+*/
+
+static unsigned LockFreeStackCtor(LockFreeStack *stk)
+{
+    unsigned err = 0;
+
+    if (stk == nullptr)
+    {
+        make_bit_true(&err, STACK_NULLPTR);
+        return err;
+    }
+
+    if (stk->is_Ctor)
+    {
+        make_bit_true(&err, STACK_ALREADY_CTOR);
+        return err;
+    }
+
+    stk->chunks = (std::atomic<LockFreeNode *> *) calloc(LF_CHUNKS_MAX, sizeof(std::atomic<LockFreeNode *>));
+    if (stk->chunks == nullptr)
+    {
+        make_bit_true(&err, MEMORY_LIMIT_EXCEEDED);
+        return err;
+    }
+
+    stk->chunks[0].store((LockFreeNode *) calloc(LF_CHUNK_SIZE, sizeof(LockFreeNode)));
+    if (stk->chunks[0].load() == nullptr)
+    {
+        free(stk->chunks);
+        stk->chunks = nullptr;
+
+        make_bit_true(&err, MEMORY_LIMIT_EXCEEDED);
+        return err;
+    }
+
+    stk->     head.store(lf_tagged(0, LF_NULL));
+    stk->free_head.store(lf_tagged(0, LF_NULL));
+    stk->nodes_num.store(LF_NULL + 1);
+    stk->     size.store(0);
+
+    stk->is_Ctor = true;
+
+    return STACK_OK;
+}
+
+/**
+*   @brief "LockFreeStack" destructor. Frees all nodes. Must not be called concurrently with other functions on the same "stk".
+*
+*   @param stk [in][out] stk - pointer to the "LockFreeStack"
+*
+*   @return bit-mask which encodes the errors from "enum _StackError"
+*/
+
+static unsigned LockFreeStackDtor(LockFreeStack *stk)
+{
+    unsigned err = LockFreeStackVerify(stk);
+    if (err)
+        return err;
+
+    for (int counter = 0; counter < LF_CHUNKS_MAX; ++counter)
+        free(stk->chunks[counter].load());
+
+    free(stk->chunks);
+
+    stk->chunks  = nullptr;
+    stk->is_Ctor = false;
+
+    return STACK_OK;
+}
+
+/**
+*   @brief Checks the fields of the "LockFreeStack" which don't change after the constructor.
+*   @brief Elements are not checked: the list may be changed by other threads during the check.
+*
+*   @param stk [in] stk - pointer to the "LockFreeStack"
+*
+*   @return bit-mask which encodes the errors from "enum _StackError"
+*/
+
+static unsigned LockFreeStackVerify(LockFreeStack *stk)
+{
+    unsigned err = 0;
+
+    if (stk == nullptr)
+    {
+        make_bit_true(&err, STACK_NULLPTR);
+        return err;
+    }
+
+    if (!stk->is_Ctor)
+    {
+        make_bit_true(&err, STACK_NON_CTOR);
+        return err;
+    }
+
+    if (stk->chunks == nullptr || stk->chunks[0].load(std::memory_order_relaxed) == nullptr)
+        make_bit_true(&err, CAPACITY_INVALID);
+
+    return err;
+}
+
+/**
+*   @brief Adds the element to the front of the "LockFreeStack". Thread safe.
+*
+*   @param      stk [in][out]      stk - pointer to the "LockFreeStack"
+*   @param push_val [in]      push_val - value to push
+*
+*   @return bit-mask which encodes the errors from "enum _StackError"
+*/
+
+static unsigned LockFreeStackPush(LockFreeStack *stk, const Stack_elem push_val)
+{
+    unsigned err = LockFreeStackVerify(stk);
+    if (err)
+        return err;
+
+    uint32_t index = lf_node_alloc(stk);
+    if (index == LF_NULL)
+    {
+        make_bit_true(&err, MEMORY_LIMIT_EXCEEDED);
+        return err;
+    }
+
+    lf_node(stk, index)->val = push_val;
+
+    stk->size.fetch_add(1, std::memory_order_relaxed); // before the CAS, so the pop of this node can't make it negative
+
+    lf_list_push(stk, &stk->head, index);
+
+    return STACK_OK;
+}
+
+/**
+*   @brief Deletes the front element of the "LockFreeStack". Puts it in variable pointed by "front_val" if it isn't nullptr.
+*   @brief Thread safe.
+*
+*   @param       stk [in][out]       stk - pointer to the "LockFreeStack"
+*   @param front_val [out]     front_val - pointer to the front element
+*
+*   @return bit-mask which encodes the errors from "enum _StackError"
+*/
+
+static unsigned LockFreeStackPop(LockFreeStack *stk, Stack_elem *const front_val)
+{
+    unsigned err = LockFreeStackVerify(stk);
+    if (err)
+        return err;
+
+    uint32_t index = lf_list_pop(stk, &stk->head);
+    if (index == LF_NULL)
+    {
+        make_bit_true(&err, STACK_EMPTY);
+        return err;
+    }
+
+    stk->size.fetch_sub(1, std::memory_order_relaxed);
+
+    if (front_val != nullptr)
+        *front_val = lf_node(stk, index)->val;
+
+    lf_list_push(stk, &stk->free_head, index);
+
+    return STACK_OK;
+}
+
+/**
+*   @brief Returns the number of elements in the "LockFreeStack". Exact only when no push or pop is running.
+*
+*   @param stk [in] stk - pointer to the "LockFreeStack"
+*
+*   @return number of elements
+*/
+
+static size_t LockFreeStackSize(LockFreeStack *stk)
+{
+    assert(stk != nullptr);
+
+    return stk->size.load(std::memory_order_relaxed);
+}
+
+#endif //STACK_LOCKFREE_H
@@ -0,0 +1,430 @@
+/** @file */
+
+#ifndef STACK_PERSIST_H
+#define STACK_PERSIST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "stack_alloc.h"
+#include "stack_hash.h"
+
+/**
+*   @brief File-backed store of a persistent "Stack" (STACK_PERSISTENT mode of "stack.h", see "StackPersistOpen()").
+*
+*   @brief Layout: [PersistHeader][elements store]. The store is kept as "Stack" keeps it in memory (see "stack_file.h"),
+*   @brief the file is mapped shared, so every change of the elements is the change of the file. The file is longer
+*   @brief than the store when the capacity was decreased, it never shrinks.
+*
+*   @brief "Stack.size", "Stack.capacity" and "Stack.hash_val" are written in the header by "persist_commit()" at
+*   @brief the end of every operation. There are two commit slots, the commit goes to the older one and the check
+*   @brief word is written last, so the process killed in the middle of the commit leaves the previous commit intact.
+*
+*   @brief Killed process loses nothing which is written in the mapping, the kernel writes it back later. The power
+*   @brief loss keeps only what was msync()-ed: the commits are synced according to "enum _PersistSync", the elements
+*   @brief are synced before the commit which refers to them.
+*/
+
+/**
+*   @brief When the commits are synced to the disk.
+*
+*   @param PERSIST_SYNC_NONE   - never, the kernel writes the mapping back by itself (survives the process crash)
+*   @param PERSIST_SYNC_EVERY  - after every commit (survives the power loss, costs two msync() per operation)
+*   @param PERSIST_SYNC_PERIOD - after every "sync_period"-th commit, the power loss rolls back at most that many
+*/
+
+typedef enum _PersistSync
+{
+    PERSIST_SYNC_NONE   = 0,
+    PERSIST_SYNC_EVERY  = 1,
+    PERSIST_SYNC_PERIOD = 2
+
+} PersistSync;
+
+/**
+*   @brief Consistent state of the "Stack" in the file.
+*
+*   @param      seq - number of the commit, 0 means the empty slot
+*   @param     size - "Stack.size"
+*   @param capacity - "Stack.capacity"
+*   @param poisoned - "Stack.poisoned" in POISON_WATERMARK mode, "capacity" without it
+*   @param hash_val - "Stack.hash_val", 0 without HASH_PROTECTION
+*   @param    check - "persist_commit_check()" of the fields above, the slot with the wrong one is torn
+*/
+
+typedef struct _PersistCommit
+{
+    uint64_t seq;
+    uint64_t size;
+    uint64_t capacity;
+    uint64_t poisoned;
+    uint64_t hash_val;
+    uint64_t check;
+
+} PersistCommit;
+
+/**
+*   @brief Header of the file.
+*
+*   @param       magic - PERSIST_MAGIC
+*   @param     version - PERSIST_VERSION
+*   @param header_size - sizeof(PersistHeader), offset of the store in the file
+*   @param   elem_size - sizeof(Stack_elem) of the "Stack"
+*   @param       flags - modes of the "Stack", bit-mask of "enum _StackFileFlag" (see "stack_file.h")
+*   @param     commits - two last commits, the one with the greater "seq" is the newest
+*/
+
+typedef struct alignas(64) _PersistHeader
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t elem_size;
+    uint32_t flags;
+
+    PersistCommit commits[2];
+
+} PersistHeader;
+
+const char     PERSIST_MAGIC[8] = {'S', 'T', 'K', 'P', 'E', 'R', 'S', '\0'};
+const uint32_t PERSIST_VERSION  = 1;
+
+/**
+*   @brief State of the opened file. "allocator" gives the store to "Stack", its "ctx" points to this state.
+*
+*   @param          fd - descriptor of the file
+*   @param         map - shared mapping of the whole file
+*   @param   file_size - size of the file and of the mapping
+*   @param        sync - policy of the syncs
+*   @param sync_period - period of the syncs in PERSIST_SYNC_PERIOD mode
+*   @param    unsynced - number of the commits after the last sync
+*   @param  dirty_from - offset in the store of the first byte which may be changed after the last sync
+*   @param        last - copy of the newest commit, "last.seq" is 0 if there is no one
+*   @param   allocator - allocator of the "Stack" store
+*/
+
+typedef struct _PersistFile
+{
+    int     fd;
+    char   *map;
+    size_t  file_size;
+
+    PersistSync sync;
+    size_t      sync_period;
+    size_t      unsynced;
+    size_t      dirty_from;
+
+    PersistCommit last;
+
+    StackAllocator allocator;
+
+} PersistFile;
+
+static inline PersistHeader *persist_header(const PersistFile *file)
+{
+    return (PersistHeader *) file->map;
+}
+
+static inline char *persist_store(const PersistFile *file)
+{
+    return file->map + sizeof(PersistHeader);
+}
+
+static inline uint64_t persist_commit_check(const PersistCommit *commit)
+{
+    return hash_mul64(commit, offsetof(PersistCommit, check), HASH_MUL_K);
+}
+
+/**
+*   @brief Returns the newest commit of "header" whose check word is right, nullptr if there is no one.
+*/
+
+static const PersistCommit *persist_last_commit(const PersistHeader *header)
+{
+    const PersistCommit *last = nullptr;
+
+    for (int slot = 0; slot < 2; ++slot)
+    {
+        const PersistCommit *commit = header->commits + slot;
+
+        if (commit->seq == 0 || commit->check != persist_commit_check(commit))
+            continue;
+
+        if (last == nullptr || commit->seq > last->seq)
+            last = commit;
+    }
+
+    return last;
+}
+
+/**
+*   @brief msync()-s the bytes [from, to) of the mapping, "from" is rounded down to the page.
+*/
+
+static void persist_msync(PersistFile *file, size_t from, const size_t to)
+{
+    const size_t page = (size_t) sysconf(_SC_PAGESIZE);
+
+    from = from / page * page;
+
+    if (from < to)
+        msync(file->map + from, to - from, MS_SYNC);
+}
+
+/**
+*   @brief Makes the file big enough for the store of "store_size" bytes and maps it again if it has grown.
+*   @brief The new mapping is made before the old one is unmapped, so the old store stays if it fails.
+*
+*   @return 1 if it is OK, 0 else
+*/
+
+static int persist_reserve(PersistFile *file, const size_t store_size)
+{
+    const size_t needed = sizeof(PersistHeader) + store_size;
+
+    if (needed <= file->file_size)
+        return 1;
+
+    // the added part is zeros until "Stack" poisons it, it is after the committed capacity, so a crash leaves it unused
+    if (ftruncate(file->fd, (off_t) needed) != 0)
+        return 0;
+
+    char *map = (char *) mmap(nullptr, needed, PROT_READ | PROT_WRITE, MAP_SHARED, file->fd, 0);
+    if (map == (char *) MAP_FAILED)
+        return 0;
+
+    munmap(file->map, file->file_size);
+
+    file->map       = map;
+    file->file_size = needed;
+
+    return 1;
+}
+
+/**
+*   @brief Writes the new commit into the older slot and syncs it if the policy says so.
+*
+*   @param       file [in][out]       file - pointer to the state
+*   @param     commit [in]          commit - new state of the "Stack", "seq" and "check" are set here
+*   @param dirty_from [in]      dirty_from - offset in the store of the first byte changed after the previous commit
+*
+*   @return nothing
+*/
+
+static void persist_commit(PersistFile *file, PersistCommit commit, const size_t dirty_from)
+{
+    assert(file != nullptr);
+
+    if (dirty_from < file->dirty_from)
+        file->dirty_from = dirty_from;
+
+    int is_synced = file->sync == PERSIST_SYNC_EVERY ||
+                   (file->sync == PERSIST_SYNC_PERIOD && ++file->unsynced >= file->sync_period);
+
+    // the elements reach the disk before the commit which refers to them
+    if (is_synced && file->dirty_from < file->file_size)
+        persist_msync(file, sizeof(PersistHeader) + file->dirty_from, file->file_size);
+
+    commit.seq   = file->last.seq + 1;
+    commit.check = persist_commit_check(&commit);
+
+    PersistCommit *slot = persist_header(file)->commits + (commit.seq & 1);
+
+    memcpy(slot, &commit, offsetof(PersistCommit, check));
+
+    __atomic_thread_fence(__ATOMIC_RELEASE); // the check word is the last, so the slot is valid only when it is whole
+
+    slot->check = commit.check;
+    file->last  = commit;
+
+    if (is_synced)
+    {
+        persist_msync(file, 0, sizeof(PersistHeader));
+
+        file->unsynced   = 0;
+        file->dirty_from = (size_t) -1;
+    }
+}
+
+/**
+*   @brief msync()-s everything changed after the last sync and the newest commit.
+*/
+
+static void persist_sync(PersistFile *file)
+{
+    assert(file != nullptr);
+
+    if (file->dirty_from < file->file_size)
+        persist_msync(file, sizeof(PersistHeader) + file->dirty_from, file->file_size);
+
+    persist_msync(file, 0, sizeof(PersistHeader));
+
+    file->unsynced   = 0;
+    file->dirty_from = (size_t) -1;
+}
+
+/**
+*   @brief Syncs the file unless the policy is PERSIST_SYNC_NONE, unmaps and closes it, frees the state.
+*/
+
+static void persist_close(PersistFile *file)
+{
+    if (file == nullptr)
+        return;
+
+    if (file->sync != PERSIST_SYNC_NONE)
+        persist_sync(file);
+
+    munmap(file->map, file->file_size);
+    close(file->fd);
+
+    free(file);
+}
+
+/*-----------------------------------------------------ALLOCATOR------------------------------------------------------*/
+
+/**
+*   @brief The only block of the allocator is the store in the mapping, it begins right after the header.
+*   @brief Growth extends the file, shrinking keeps it, freeing closes the file and leaves it on the disk.
+*/
+
+static void *persist_realloc(void *ctx, void *, size_t, size_t new_size)
+{
+    PersistFile *file = (PersistFile *) ctx;
+
+    if (!persist_reserve(file, new_size))
+        return nullptr;
+
+    return persist_store(file);
+}
+
+static void *persist_alloc(void *ctx, size_t size)
+{
+    return persist_realloc(ctx, nullptr, 0, size);
+}
+
+static void persist_free(void *ctx, void *, size_t)
+{
+    persist_close((PersistFile *) ctx);
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/**
+*   @brief Opens or creates the file "file_name" and maps it. The new file gets the header without commits.
+*
+*   @param   file_name [in]    file_name - name of the file
+*   @param   elem_size [in]    elem_size - sizeof(Stack_elem), the existing file must have the same one
+*   @param       flags [in]        flags - modes of "stack.h", the existing file must have the same ones
+*   @param        sync [in]         sync - policy of the syncs
+*   @param sync_period [in]  sync_period - period of the syncs in PERSIST_SYNC_PERIOD mode
+*   @param  is_invalid [out]  is_invalid - 1 if the file exists but it is not the file of this "Stack", 0 else
+*
+*   @return pointer to the state, nullptr if the file can't be opened or it is invalid
+*/
+
+static PersistFile *persist_open(const char *file_name, const uint32_t elem_size, const uint32_t flags,
+                                 const PersistSync sync, const size_t sync_period, int *is_invalid)
+{
+    assert(file_name  != nullptr);
+    assert(is_invalid != nullptr);
+
+    *is_invalid = 0;
+
+    int         fd    = open(file_name, O_RDWR | O_CREAT, 0644);
+    struct stat state = {};
+
+    if (fd < 0 || fstat(fd, &state) != 0)
+    {
+        if (fd >= 0)
+            close(fd);
+
+        return nullptr;
+    }
+
+    size_t file_size = (size_t) state.st_size;
+
+    if (file_size == 0)
+    {
+        PersistHeader header = {};
+
+        memcpy(header.magic, PERSIST_MAGIC, sizeof(PERSIST_MAGIC));
+
+        header.version     = PERSIST_VERSION;
+        header.header_size = sizeof(PersistHeader);
+        header.elem_size   = elem_size;
+        header.flags       = flags;
+
+        // one write() of the whole header: the killed process leaves either no header or the whole one
+        if (pwrite(fd, &header, sizeof(header), 0) != (ssize_t) sizeof(header))
+        {
+            close(fd);
+            return nullptr;
+        }
+
+        file_size = sizeof(header);
+    }
+
+    if (file_size < sizeof(PersistHeader))
+    {
+        *is_invalid = 1;
+
+        close(fd);
+        return nullptr;
+    }
+
+    char *map = (char *) mmap(nullptr, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    if (map == (char *) MAP_FAILED)
+    {
+        close(fd);
+        return nullptr;
+    }
+
+    const PersistHeader *header = (const PersistHeader *) map;
+
+    if (memcmp(header->magic, PERSIST_MAGIC, sizeof(PERSIST_MAGIC)) != 0 ||
+        header->version     != PERSIST_VERSION       ||
+        header->header_size != sizeof(PersistHeader) ||
+        header->elem_size   != elem_size             ||
+        header->flags       != flags)
+    {
+        *is_invalid = 1;
+
+        munmap(map, file_size);
+        close(fd);
+        return nullptr;
+    }
+
+    PersistFile *file = (PersistFile *) calloc(1, sizeof(PersistFile));
+
+    if (file == nullptr)
+    {
+        munmap(map, file_size);
+        close(fd);
+        return nullptr;
+    }
+
+    const PersistCommit *last = persist_last_commit(header);
+
+    file->fd          = fd;
+    file->map         = map;
+    file->file_size   = file_size;
+    file->sync        = sync;
+    file->sync_period = (sync_period != 0) ? sync_period : 1;
+    file->unsynced    = 0;
+    file->dirty_from  = (size_t) -1;
+    file->last        = (last != nullptr) ? *last : PersistCommit{};
+    file->allocator   = {persist_alloc, persist_realloc, persist_free, file};
+
+    return file;
+}
+
+#endif //STACK_PERSIST_H
@@ -0,0 +1,378 @@
+/** @file */
+
+#ifndef STACK_POISON_H
+#define STACK_POISON_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+    #define POISON_X86
+#endif
+
+/**
+*   @brief Kernels which scan and fill the poisoned ranges of the elements store.
+*
+*   @brief poison_find_eq() - index of the first byte     equal to "val" (active elements must not have it)
+*   @brief poison_find_ne() - index of the first byte not equal to "val" (non active elements must have only it)
+*   @brief poison_fill()    - fills the range by "val"
+*
+*   @brief Both scans return "len" if there is no such byte. On x86 the kernel is chosen once at the first call by
+*   @brief cpuid: AVX-512BW, AVX2 or SSE2, the scalar loop is used on the other targets. Every vector kernel checks
+*   @brief the whole block before the branch and finds the index by the mask only in the block with the mismatch.
+*/
+
+/**
+*   @brief Size (in bytes) starting from which "poison_fill()" bypasses the cache by the non temporal stores.
+*   @brief The poisoned store is not read back soon, so it must not evict the active elements.
+*/
+
+const size_t POISON_STREAM_SIZE = 4u << 20;
+
+typedef size_t (*poison_scan_t)(const unsigned char *buf, size_t len, unsigned char val);
+typedef void   (*poison_fill_t)(      unsigned char *buf, size_t len, unsigned char val);
+
+/**
+*   @brief Kernels chosen for the current CPU.
+*
+*   @param find_eq - kernel of "poison_find_eq()"
+*   @param find_ne - kernel of "poison_find_ne()"
+*   @param    fill - kernel of "poison_fill()"
+*/
+
+typedef struct _PoisonKernels
+{
+    poison_scan_t find_eq;
+    poison_scan_t find_ne;
+    poison_fill_t fill;
+
+} PoisonKernels;
+
+/*-----------------------------------------------------SCALAR---------------------------------------------------------*/
+
+static size_t poison_find_eq_scalar(const unsigned char *buf, size_t len, unsigned char val)
+{
+    const void *found = memchr(buf, val, len);
+
+    return (found == nullptr) ? len : (size_t) ((const unsigned char *) found - buf);
+}
+
+static size_t poison_find_ne_scalar(const unsigned char *buf, size_t len, unsigned char val)
+{
+    uint64_t pattern = 0x0101010101010101ull * val;
+
+    size_t counter = 0;
+
+    for (; counter + sizeof(uint64_t) <= len; counter += sizeof(uint64_t))
+    {
+        uint64_t word = 0;
+        memcpy(&word, buf + counter, sizeof(uint64_t));
+
+        if (word != pattern)
+            break;
+    }
+
+    for (; counter < len; ++counter)
+    {
+        if (buf[counter] != val)
+            return counter;
+    }
+
+    return len;
+}
+
+static void poison_fill_scalar(unsigned char *buf, size_t len, unsigned char val)
+{
+    memset(buf, val, len);
+}
+
+#ifdef POISON_X86
+
+/*-------------------------------------------------------SSE2---------------------------------------------------------*/
+
+__attribute__((target("sse2")))
+static size_t poison_scan_sse2(const unsigned char *buf, size_t len, unsigned char val, const unsigned char equal)
+{
+    const __m128i pattern = _mm_set1_epi8((char) val);
+    const unsigned  full  = equal ? 0 : 0xFFFFu;
+
+    size_t counter = 0;
+
+    for (; counter + 64 <= len; counter += 64)
+    {
+        __m128i c0 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (buf + counter)     ), pattern);
+        __m128i c1 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (buf + counter) + 1), pattern);
+        __m128i c2 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (buf + counter) + 2), pattern);
+        __m128i c3 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (buf + counter) + 3), pattern);
+
+        __m128i any = equal ? _mm_or_si128 (_mm_or_si128 (c0, c1), _mm_or_si128 (c2, c3)) :
+                              _mm_and_si128(_mm_and_si128(c0, c1), _mm_and_si128(c2, c3));
+
+        if ((unsigned) _mm_movemask_epi8(any) != full)
+            break;
+    }
+
+    for (; counter + 16 <= len; counter += 16)
+    {
+        __m128i  cmp = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (buf + counter)), pattern);
+        unsigned hit = (unsigned) _mm_movemask_epi8(cmp) ^ full;
+
+        if (hit)
+            return counter + (size_t) __builtin_ctz(hit);
+    }
+
+    return counter + (equal ? poison_find_eq_scalar(buf + counter, len - counter, val) :
+                              poison_find_ne_scalar(buf + counter, len - counter, val));
+}
+
+__attribute__((target("sse2")))
+static size_t poison_find_eq_sse2(const unsigned char *buf, size_t len, unsigned char val)
+{
+    return poison_scan_sse2(buf, len, val, 1);
+}
+
+__attribute__((target("sse2")))
+static size_t poison_find_ne_sse2(const unsigned char *buf, size_t len, unsigned char val)
+{
+    return poison_scan_sse2(buf, len, val, 0);
+}
+
+__attribute__((target("sse2")))
+static void poison_fill_sse2(unsigned char *buf, size_t len, unsigned char val)
+{
+    if (len < POISON_STREAM_SIZE)
+    {
+        memset(buf, val, len);
+        return;
+    }
+
+    const __m128i pattern = _mm_set1_epi8((char) val);
+
+    size_t head = (16 - (uintptr_t) buf % 16) % 16;
+    memset(buf, val, head);
+
+    size_t counter = head;
+
+    for (; counter + 16 <= len; counter += 16)
+        _mm_stream_si128((__m128i *) (buf + counter), pattern);
+
+    _mm_sfence();
+
+    memset(buf + counter, val, len - counter);
+}
+
+/*-------------------------------------------------------AVX2---------------------------------------------------------*/
+
+__attribute__((target("avx2")))
+static size_t poison_scan_avx2(const unsigned char *buf, size_t len, unsigned char val, const unsigned char equal)
+{
+    const __m256i pattern = _mm256_set1_epi8((char) val);
+    const unsigned  full  = equal ? 0 : 0xFFFFFFFFu;
+
+    size_t counter = 0;
+
+    for (; counter + 128 <= len; counter += 128)
+    {
+        __m256i c0 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (buf + counter)     ), pattern);
+        __m256i c1 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (buf + counter) + 1), pattern);
+        __m256i c2 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (buf + counter) + 2), pattern);
+        __m256i c3 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (buf + counter) + 3), pattern);
+
+        __m256i any = equal ? _mm256_or_si256 (_mm256_or_si256 (c0, c1), _mm256_or_si256 (c2, c3)) :
+                              _mm256_and_si256(_mm256_and_si256(c0, c1), _mm256_and_si256(c2, c3));
+
+        if ((unsigned) _mm256_movemask_epi8(any) != full)
+            break;
+    }
+
+    for (; counter + 32 <= len; counter += 32)
+    {
+        __m256i  cmp = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (buf + counter)), pattern);
+        unsigned hit = (unsigned) _mm256_movemask_epi8(cmp) ^ full;
+
+        if (hit)
+            return counter + (size_t) __builtin_ctz(hit);
+    }
+
+    return counter + poison_scan_sse2(buf + counter, len - counter, val, equal);
+}
+
+__attribute__((target("avx2")))
+static size_t poison_find_eq_avx2(const unsigned char *buf, size_t len, unsigned char val)
+{
+    return poison_scan_avx2(buf, len, val, 1);
+}
+
+__attribute__((target("avx2")))
+static size_t poison_find_ne_avx2(const unsigned char *buf, size_t len, unsigned char val)
+{
+    return poison_scan_avx2(buf, len, val, 0);
+}
+
+__attribute__((target("avx2")))
+static void poison_fill_avx2(unsigned char *buf, size_t len, unsigned char val)
+{
+    if (len < POISON_STREAM_SIZE)
+    {
+        memset(buf, val, len);
+        return;
+    }
+
+    const __m256i pattern = _mm256_set1_epi8((char) val);
+
+    size_t head = (32 - (uintptr_t) buf % 32) % 32;
+    memset(buf, val, head);
+
+    size_t counter = head;
+
+    for (; counter + 32 <= len; counter += 32)
+        _mm256_stream_si256((__m256i *) (buf + counter), pattern);
+
+    _mm_sfence();
+
+    memset(buf + counter, val, len - counter);
+}
+
+/*-----------------------------------------------------AVX-512--------------------------------------------------------*/
+
+__attribute__((target("avx512f,avx512bw")))
+static size_t poison_scan_avx512(const unsigned char *buf, size_t len, unsigned char val, const unsigned char equal)
+{
+    const __m512i pattern = _mm512_set1_epi8((char) val);
+
+    size_t counter = 0;
+
+    for (; counter + 64 <= len; counter += 64)
+    {
+        __m512i  block = _mm512_loadu_si512((const void *) (buf + counter));
+        uint64_t hit   = equal ? _mm512_cmpeq_epi8_mask (block, pattern) :
+                                 _mm512_cmpneq_epi8_mask(block, pattern);
+        if (hit)
+            return counter + (size_t) __builtin_ctzll(hit);
+    }
+
+    if (counter < len)
+    {
+        // masked load of the tail doesn't touch the bytes after the buffer, so it never faults
+        __mmask64 tail  = (1ull << (len - counter)) - 1;
+        __m512i   block = _mm512_maskz_loadu_epi8(tail, (const void *) (buf + counter));
+        uint64_t  hit   = equal ? _mm512_mask_cmpeq_epi8_mask (tail, block, pattern) :
+                                  _mm512_mask_cmpneq_epi8_mask(tail, block, pattern);
+        if (hit)
+            return counter + (size_t) __builtin_ctzll(hit);
+    }
+
+    return len;
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static size_t poison_find_eq_avx512(const unsigned char *buf, size_t len, unsigned char val)
+{
+    return poison_scan_avx512(buf, len, val, 1);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static size_t poison_find_ne_avx512(const unsigned char *buf, size_t len, unsigned char val)
+{
+    return poison_scan_avx512(buf, len, val, 0);
+}
+
+#endif //POISON_X86
+
+/*----------------------------------------------------DISPATCH--------------------------------------------------------*/
+
+/**
+*   @brief Chooses the kernels by the CPU features. Called once, the result is kept in "poison_kernels()".
+*
+*   @return kernels for the current CPU
+*/
+
+static PoisonKernels poison_kernels_detect()
+{
+    PoisonKernels kernels = {poison_find_eq_scalar, poison_find_ne_scalar, poison_fill_scalar};
+
+    #ifdef POISON_X86
+
+        __builtin_cpu_init();
+
+        if (__builtin_cpu_supports("sse2"))
+            kernels = {poison_find_eq_sse2, poison_find_ne_sse2, poison_fill_sse2};
+
+        if (__builtin_cpu_supports("avx2"))
+            kernels = {poison_find_eq_avx2, poison_find_ne_avx2, poison_fill_avx2};
+
+        if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+        {
+            kernels.find_eq = poison_find_eq_avx512;
+            kernels.find_ne = poison_find_ne_avx512;
+        }
+
+    #endif
+
+    return kernels;
+}
+
+static const PoisonKernels *poison_kernels()
+{
+    static const PoisonKernels kernels = poison_kernels_detect();
+
+    return &kernels;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/**
+*   @brief Looks for the first byte of the buffer equal to "val".
+*
+*   @param buf [in] buf - pointer to the buffer
+*   @param len [in] len - size (in bytes) of the buffer
+*   @param val [in] val - poison value
+*
+*   @return index of the byte or "len" if there is no such byte
+*/
+
+static inline size_t poison_find_eq(const void *buf, size_t len, unsigned char val)
+{
+    assert(buf != nullptr || len == 0);
+
+    return poison_kernels()->find_eq((const unsigned char *) buf, len, val);
+}
+
+/**
+*   @brief Looks for the first byte of the buffer not equal to "val".
+*
+*   @param buf [in] buf - pointer to the buffer
+*   @param len [in] len - size (in bytes) of the buffer
+*   @param val [in] val - poison value
+*
+*   @return index of the byte or "len" if there is no such byte
+*/
+
+static inline size_t poison_find_ne(const void *buf, size_t len, unsigned char val)
+{
+    assert(buf != nullptr || len == 0);
+
+    return poison_kernels()->find_ne((const unsigned char *) buf, len, val);
+}
+
+/**
+*   @brief Fills the buffer by "val".
+*
+*   @param buf [out] buf - pointer to the buffer
+*   @param len [in]  len - size (in bytes) of the buffer
+*   @param val [in]  val - poison value
+*
+*   @return nothing
+*/
+
+static inline void poison_fill(void *buf, size_t len, unsigned char val)
+{
+    assert(buf != nullptr || len == 0);
+
+    poison_kernels()->fill((unsigned char *) buf, len, val);
+}
+
+#endif //STACK_POISON_H
@@ -0,0 +1,505 @@
+/** @file */
+
+#ifndef STACK_SHARED_H
+#define STACK_SHARED_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <assert.h>
+
+#include "stack_common.h"
+#include "stack_poison.h"
+#include "stack_hash.h"
+
+/**
+*   @brief LIFO of "Stack_elem" whose copies share the elements, so the copy ("SharedStackSnapshot()") is O(1).
+*   @brief "Stack_elem" must be defined before the header the same way as for "stack.h".
+*
+*   @brief Elements are kept in chunks of SHARED_CHUNK_SIZE, every chunk points to the chunk below it, the stack
+*   @brief points to its top chunk. A chunk is counted by every stack and every chunk which points to it. The chunk
+*   @brief counted once belongs to one stack and is changed in place. The chunk counted more than once is never
+*   @brief changed: the push on it begins the new chunk above it (so a chunk in the middle may be not full), the pop
+*   @brief from it only moves the top of the stack down. So no push or pop copies elements, the snapshot costs one
+*   @brief increment and the elements below the point of the snapshot are kept once for all copies.
+*
+*   @brief Every chunk has the same protection as the store of "Stack": canaries around it, poison in the elements
+*   @brief which are not written and the hash of the written ones. The hash is djb2 of "stack_hash.h", the push
+*   @brief appends the element to it and the pop of the own chunk removes it by the inverse of 33, both in
+*   @brief O(sizeof(Stack_elem)). Push and pop check the chunk they change, "SharedStackVerify()" checks all chunks.
+*
+*   @brief Reference counts are not atomic: the copies which share chunks must be used by one thread.
+*   @brief The stack doesn't write the log, errors are reported by the same bit-mask of "enum _StackError" as
+*   @brief "stack.h" does.
+*/
+
+#ifndef SHARED_CHUNK_SIZE
+    #define SHARED_CHUNK_SIZE 64 ///< number of elements in one chunk
+#endif
+
+/**
+*   @brief Multiplicative inverse of 33 modulo 2^64, it removes the last byte from the djb2 hash.
+*/
+
+const unsigned long long SHARED_DJB2_INVERSE = 0x0F83E0F83E0F83E1ull;
+
+/**
+*   @brief Chunk of the "SharedStack" elements.
+*
+*   @param  left_canary - LEFT_CANARY
+*   @param         refs - number of the stacks and chunks which point to it
+*   @param         prev - chunk below it, nullptr for the bottom one
+*   @param   prev_count - number of the elements of "prev" which are below it
+*   @param         used - number of the written elements, "elems[used..]" are poisoned
+*   @param     hash_val - djb2 of "used" written elements
+*   @param        elems - elements
+*   @param right_canary - RIGHT_CANARY
+*/
+
+typedef struct _SharedChunk
+{
+    unsigned left_canary;
+
+    size_t               refs;
+    struct _SharedChunk *prev;
+    size_t               prev_count;
+    size_t               used;
+
+    unsigned long long hash_val;
+
+    Stack_elem elems[SHARED_CHUNK_SIZE];
+
+    unsigned right_canary;
+
+} SharedChunk;
+
+/**
+*   @brief "Stack" which shares the chunks with its snapshots.
+*
+*   @param     top - top chunk, nullptr if the stack is empty
+*   @param   count - number of the elements of "top" which belong to the stack, the others are written by the copies
+*   @param    size - number of elements
+*   @param is_Ctor - shows if "SharedStack" has been already constructed
+*/
+
+typedef struct _SharedStack
+{
+    SharedChunk *top;
+    size_t       count;
+    size_t       size;
+
+    bool is_Ctor;
+
+} SharedStack;
+
+/*---------------------------------------------FUNCTIONS_DECLARATION--------------------------------------------------*/
+
+static unsigned SharedStackCtor    (SharedStack *stk);
+static unsigned SharedStackDtor    (SharedStack *stk);
+static unsigned SharedStackVerify  (SharedStack *stk);
+static unsigned SharedStackSnapshot(SharedStack *dst, SharedStack *src);
+
+static unsigned SharedStackPush    (SharedStack *stk, const Stack_elem push_val);
+static unsigned SharedStackPop     (SharedStack *stk,       Stack_elem *const front_val = nullptr);
+static size_t   SharedStackSize    (SharedStack *stk);
+
+static SharedChunk *shared_chunk_alloc  (SharedChunk *prev, const size_t prev_count);
+static void         shared_chunk_release(SharedChunk *chunk);
+static void         shared_chunk_trim   (SharedChunk *chunk, const size_t count);
+static unsigned     shared_chunk_verify (const SharedChunk *chunk);
+static unsigned     shared_view_verify  (SharedStack *stk);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/**
+*   @brief Returns djb2 "hash_val" without the last "len" bytes, which are "buf".
+*/
+
+static inline unsigned long long shared_unhash(unsigned long long hash_val, const void *_buf, const size_t len)
+{
+    const unsigned char *buf = (const unsigned char *) _buf;
+
+    for (size_t counter = len; counter > 0; --counter)
+        hash_val = (hash_val - buf[counter - 1]) * SHARED_DJB2_INVERSE;
+
+    return hash_val;
+}
+
+/**
+*   @brief Allocates the poisoned chunk above "prev_count" elements of "prev". The reference of the caller to "prev"
+*   @brief becomes the reference of the chunk.
+*
+*   @return pointer to the chunk, nullptr if there is no memory
+*/
+
+static SharedChunk *shared_chunk_alloc(SharedChunk *prev, const size_t prev_count)
+{
+    SharedChunk *chunk = (SharedChunk *) malloc(sizeof(SharedChunk));
+    if (chunk == nullptr)
+        return nullptr;
+
+    chunk->left_canary  = (unsigned) LEFT_CANARY;
+    chunk->right_canary = (unsigned) RIGHT_CANARY;
+
+    chunk->refs       = 1;
+    chunk->prev       = prev;
+    chunk->prev_count = prev_count;
+    chunk->used       = 0;
+    chunk->hash_val   = HASH_START;
+
+    poison_fill(chunk->elems, sizeof(chunk->elems), (unsigned char) POISON_BYTE);
+
+    return chunk;
+}
+
+/**
+*   @brief Drops one reference to "chunk" and frees the chunks which are not referenced any more, going down.
+*   @brief The loop instead of the recursion keeps the stack of calls flat for any number of chunks.
+*/
+
+static void shared_chunk_release(SharedChunk *chunk)
+{
+    while (chunk != nullptr && --chunk->refs == 0)
+    {
+        SharedChunk *prev = chunk->prev;
+
+        free(chunk);
+        chunk = prev;
+    }
+}
+
+/**
+*   @brief Poisons the elements after the first "count" ones of the chunk which belongs to one stack. They are
+*   @brief written by the copies which have been released since then.
+*/
+
+static void shared_chunk_trim(SharedChunk *chunk, const size_t count)
+{
+    assert(chunk->refs == 1);
+
+    if (chunk->used <= count)
+        return;
+
+    poison_fill(chunk->elems + count, (chunk->used - count) * sizeof(Stack_elem), (unsigned char) POISON_BYTE);
+
+    chunk->used     = count;
+    chunk->hash_val = hash_djb2(chunk->elems, count * sizeof(Stack_elem), HASH_START);
+}
+
+/**
+*   @brief Checks one chunk: canaries, counters, poison of the not written elements, no poison in the written ones
+*   @brief and the hash.
+*
+*   @return bit-mask which encodes the errors from "enum _StackError"
+*/
+
+static unsigned shared_chunk_verify(const SharedChunk *chunk)
+{
+    assert(chunk != nullptr);
+
+    unsigned err = 0;
+
+    if (chunk->left_canary != (unsigned) LEFT_CANARY || chunk->right_canary != (unsigned) RIGHT_CANARY)
+        make_bit_true(&err, CANARY_PROTECTION_FAILED);
+
+    if (chunk->refs == 0 || chunk->used > SHARED_CHUNK_SIZE)
+    {
+        make_bit_true(&err, SIZE_INVALID);
+        return err;
+    }
+
+    const size_t written = chunk->used * sizeof(Stack_elem);
+
+    if (poison_find_eq(chunk->elems, written, (unsigned char) POISON_BYTE) != written)
+        make_bit_true(&err, ACTIVE_POISON_VALUES);
+
+    if (poison_find_ne((const char *) chunk->elems + written, sizeof(chunk->elems) - written,
+                       (unsigned char) POISON_BYTE) != sizeof(chunk->elems) - written)
+        make_bit_true(&err, NON_ACTIVE_NON_POISON_VALUES);
+
+    if (hash_djb2(chunk->elems, written, HASH_START) != chunk->hash_val)
+        make_bit_true(&err, HASH_PROTECTION_FAILED);
+
+    return err;
+}
+
+/**
+*   @brief Checks the fields of the "SharedStack" and its top chunk, it is the check of every push and pop.
+*
+*   @return bit-mask which encodes the errors from "enum _StackError"
+*/
+
+static unsigned shared_view_verify(SharedStack *stk)
+{
+    unsigned err = 0;
+
+    if (stk == nullptr)
+    {
+        make_bit_true(&err, STACK_NULLPTR);
+        return err;
+    }
+
+    if (!stk->is_Ctor)
+    {
+        make_bit_true(&err, STACK_NON_CTOR);
+        return err;
+    }
+
+    if (stk->top == nullptr)
+    {
+        if (stk->size != 0 || stk->count != 0)
+            make_bit_true(&err, SIZE_INVALID);
+
+        return err;
+    }
+
+    err |= shared_chunk_verify(stk->top);
+
+    if (stk->count == 0 || stk->count > stk->top->used || stk->count > stk->size)
+        make_bit_true(&err, SIZE_INVALID);
+
+    return err;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/**
+*   @brief "SharedStack" constructor.
+*
+*   @param stk [out] stk - pointer to the "SharedStack", it must be initialized by nulls
+*
+*   @return bit-mask which encodes the errors from "enum _StackError"
+*/
+
+static unsigned SharedStackCtor(SharedStack *stk)
+{
+    unsigned err = 0;
+
+    if (stk == nullptr)
+    {
+        make_bit_true(&err, STACK_NULLPTR);
+        return err;
+    }
+
+    if (stk->is_Ctor)
+    {
+        make_bit_true(&err, STACK_ALREADY_CTOR);
+        return err;
+    }
+
+    stk->top     = nullptr;
+    stk->count   = 0;
+    stk->size    = 0;
+    stk->is_Ctor = true;
+
+    return STACK_OK;
+}
+
+/**
+*   @brief "SharedStack" destructor. Frees the chunks which are not shared with the other copies.
+*
+*   @param stk [in][out] stk - pointer to the "SharedStack"
+*
+*   @return bit-mask which encodes the errors from "enum _StackError"
+*/
+
+static unsigned SharedStackDtor(SharedStack *stk)
+{
+    unsigned err = shared_view_verify(stk);
+    if (err)
+        return err;
+
+    shared_chunk_release(stk->top);
+
+    stk->top     = nullptr;
+    stk->count   = 0;
+    stk->size    = POISON_SIZE;
+    stk->is_Ctor = false;
+
+    return STACK_OK;
+}
+
+/**
+*   @brief Checks the whole "SharedStack": the fields and every chunk from the top to the bottom
+*   @brief (see "shared_chunk_verify()"), the numbers of elements in the chunks must sum up to the size.
+*
+*   @param stk [in] stk - pointer to the "SharedStack"
+*
+*   @return bit-mask which encodes the errors from "enum _StackError"
+*/
+
+static unsigned SharedStackVerify(SharedStack *stk)
+{
+    unsigned err = shared_view_verify(stk);
+    if (err || stk->top == nullptr)
+        return err;
+
+    size_t elems_num = stk->count;
+
+    for (const SharedChunk *chunk = stk->top; chunk->prev != nullptr; chunk = chunk->prev)
+    {
+        err |= shared_chunk_verify(chunk->prev);
+
+        if (chunk->prev_count == 0 || chunk->prev_count > chunk->prev->used)
+            make_bit_true(&err, SIZE_INVALID);
+
+        if (err)
+            return err;
+
+        elems_num += chunk->prev_count;
+    }
+
+    if (elems_num != stk->size)
+        make_bit_true(&err, SIZE_INVALID);
+
+    return err;
+}
+
+/**
+*   @brief Makes "dst" the copy of "src" in O(1): they share all chunks, the later pushes and pops of either one
+*   @brief don't change the other one.
+*
+*   @param dst [out]    dst - pointer to the copy, it must be initialized by nulls
+*   @param src [in]     src - pointer to the "SharedStack" to copy
+*
+*   @return bit-mask which encodes the errors from "enum _StackError"
+*/
+
+static unsigned SharedStackSnapshot(SharedStack *dst, SharedStack *src)
+{
+    unsigned err = shared_view_verify(src);
+    if (err)
+        return err;
+
+    if (dst == nullptr)
+    {
+        make_bit_true(&err, STACK_NULLPTR);
+        return err;
+    }
+
+    if (dst->is_Ctor)
+    {
+        make_bit_true(&err, STACK_ALREADY_CTOR);
+        return err;
+    }
+
+    *dst = *src;
+
+    if (dst->top != nullptr)
+        ++dst->top->refs;
+
+    return STACK_OK;
+}
+
+/**
+*   @brief Adds the element to the front of the "SharedStack". The top chunk is written in place if it belongs
+*   @brief to this stack only and is not full, else the new chunk is put above it.
+*
+*   @param      stk [in][out]      stk - pointer to the "SharedStack"
+*   @param push_val [in]      push_val - value to push
+*
+*   @return bit-mask which encodes the errors from "enum _StackError"
+*/
+
+static unsigned SharedStackPush(SharedStack *stk, const Stack_elem push_val)
+{
+    unsigned err = shared_view_verify(stk);
+    if (err)
+        return err;
+
+    SharedChunk *top = stk->top;
+
+    if (top == nullptr || top->refs > 1 || stk->count == SHARED_CHUNK_SIZE)
+    {
+        top = shared_chunk_alloc(stk->top, stk->count);
+        if (top == nullptr)
+        {
+            make_bit_true(&err, MEMORY_LIMIT_EXCEEDED);
+            return err;
+        }
+
+        stk->top   = top;
+        stk->count = 0;
+    }
+    else
+        shared_chunk_trim(top, stk->count);
+
+    top->elems[top->used++] = push_val;
+    top->hash_val           = hash_djb2(&push_val, sizeof(Stack_elem), top->hash_val);
+
+    ++stk->count;
+    ++stk->size;
+
+    return shared_view_verify(stk);
+}
+
+/**
+*   @brief Deletes the front element of the "SharedStack". Puts it in variable pointed by "front_val" if it isn't nullptr.
+*   @brief The element is poisoned only in the chunk which belongs to this stack, the shared chunk is not changed.
+*
+*   @param       stk [in][out]       stk - pointer to the "SharedStack"
+*   @param front_val [out]     front_val - pointer to the front element
+*
+*   @return bit-mask which encodes the errors from "enum _StackError"
+*/
+
+static unsigned SharedStackPop(SharedStack *stk, Stack_elem *const front_val)
+{
+    unsigned err = shared_view_verify(stk);
+    if (err)
+        return err;
+
+    if (stk->size == 0)
+    {
+        make_bit_true(&err, STACK_EMPTY);
+        return err;
+    }
+
+    SharedChunk *top = stk->top;
+
+    if (front_val != nullptr)
+        *front_val = top->elems[stk->count - 1];
+
+    --stk->count;
+    --stk->size;
+
+    if (top->refs == 1)
+    {
+        shared_chunk_trim(top, stk->count + 1);
+
+        top->hash_val = shared_unhash(top->hash_val, top->elems + stk->count, sizeof(Stack_elem));
+        top->used     = stk->count;
+
+        poison_fill(top->elems + stk->count, sizeof(Stack_elem), (unsigned char) POISON_BYTE);
+    }
+
+    if (stk->count == 0)
+    {
+        // the reference to the chunk below moves from the emptied top to the stack
+        stk->top   = top->prev;
+        stk->count = top->prev_count;
+
+        if (stk->top != nullptr)
+            ++stk->top->refs;
+
+        shared_chunk_release(top);
+    }
+
+    return shared_view_verify(stk);
+}
+
+/**
+*   @brief Returns the number of elements in the "SharedStack".
+*
+*   @param stk [in] stk - pointer to the "SharedStack"
+*
+*   @return number of elements
+*/
+
+static size_t SharedStackSize(SharedStack *stk)
+{
+    assert(stk != nullptr);
+
+    return stk->size;
+}
+
+#endif //STACK_SHARED_H
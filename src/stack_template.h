@@ -0,0 +1,497 @@
+/** @file */
+
+#ifndef STACK_TEMPLATE_H
+#define STACK_TEMPLATE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <type_traits>
+
+#include "stack_common.h"
+#include "stack_hash.h"
+
+/**
+*   @brief Policy-based "Stack". Unlike "stack.h" where the protections are switched by global macros, here every
+*   @brief protection, logging and growth strategy is a template parameter resolved at compile time:
+*
+*   @brief   policy::Stack<T, ProtectionPolicy, LoggingPolicy, GrowthPolicy>
+*
+*   @brief With "NoProtection" and "NoLogging" all checks and trace calls are empty inline functions,
+*   @brief so "push()" and "pop()" compile down to the code of a bare growing array.
+*   @brief Errors are reported by the same bit-mask of "enum _StackError" as "stack.h" does.
+*/
+
+namespace policy
+{
+
+/*---------------------------------------------PROTECTION_POLICIES---------------------------------------------------*/
+
+/**
+*   @brief Protection policy interface (all functions are static):
+*
+*   @param SLACK    - number of bytes reserved before and after the elements store
+*   @param State    - data kept in every "Stack" (empty struct if nothing is needed)
+*   @param on_alloc - called after every (re)allocation of the store, elements [0, size) are already copied
+*   @param on_push  - called after the element "data[size - 1]" is written
+*   @param on_pop   - called after the element "data[size]"     is removed
+*   @param verify   - returns the bit-mask which encodes the errors from "enum _StackError"
+*/
+
+struct NoProtection
+{
+    static const size_t SLACK = 0;
+
+    struct State {};
+
+    template <typename T> static void     on_alloc(State &, T *, size_t, size_t)             {}
+    template <typename T> static void     on_push (State &, T *, size_t, size_t)             {}
+    template <typename T> static void     on_pop  (State &, T *, size_t, size_t)             {}
+    template <typename T> static unsigned verify  (const State &, const T *, size_t, size_t) { return STACK_OK; }
+};
+
+/**
+*   @brief Checks "size" and "capacity" of the "Stack". Used by all protection policies except "NoProtection".
+*
+*   @return bit-mask which encodes the errors from "enum _StackError"
+*/
+
+template <typename T>
+static unsigned verify_meta(const T *data, size_t size, size_t capacity)
+{
+    unsigned err = 0;
+
+    if (size > capacity)
+    {
+        make_bit_true(&err,     SIZE_INVALID);
+        make_bit_true(&err, CAPACITY_INVALID);
+    }
+
+    if (capacity > 0 && data == nullptr)
+        make_bit_true(&err, CAPACITY_INVALID);
+
+    return err;
+}
+
+/**
+*   @brief Keeps LEFT_CANARY right before and RIGHT_CANARY right after the elements store.
+*   @brief The slack is max_align_t-sized, so the elements stay aligned.
+*/
+
+struct CanaryProtection
+{
+    static const size_t SLACK = alignof(max_align_t);
+
+    struct State {};
+
+    template <typename T> static void on_alloc(State &, T *data, size_t, size_t capacity)
+    {
+        const unsigned  left =  LEFT_CANARY;
+        const unsigned right = RIGHT_CANARY;
+
+        memcpy((char *) data - sizeof(unsigned), &left,  sizeof(unsigned));
+        memcpy((char *) (data + capacity),       &right, sizeof(unsigned));
+    }
+
+    template <typename T> static void on_push(State &, T *, size_t, size_t) {}
+    template <typename T> static void on_pop (State &, T *, size_t, size_t) {}
+
+    template <typename T> static unsigned verify(const State &, const T *data, size_t size, size_t capacity)
+    {
+        unsigned err = verify_meta(data, size, capacity);
+        if (err || data == nullptr) return err;
+
+        unsigned left = 0, right = 0;
+
+        memcpy(&left,  (const char *) data - sizeof(unsigned), sizeof(unsigned));
+        memcpy(&right, (const char *) (data + capacity),       sizeof(unsigned));
+
+        if (left != (unsigned) LEFT_CANARY || right != (unsigned) RIGHT_CANARY)
+            make_bit_true(&err, CANARY_PROTECTION_FAILED);
+
+        return err;
+    }
+};
+
+/**
+*   @brief Keeps the non active elements [size, capacity) filled by POISON_BYTE.
+*/
+
+struct PoisonProtection
+{
+    static const size_t SLACK = 0;
+
+    struct State {};
+
+    template <typename T> static void on_alloc(State &, T *data, size_t size, size_t capacity)
+    {
+        memset(data + size, (unsigned char) POISON_BYTE, (capacity - size) * sizeof(T));
+    }
+
+    template <typename T> static void on_push(State &, T *, size_t, size_t) {}
+
+    template <typename T> static void on_pop(State &, T *data, size_t size, size_t)
+    {
+        memset(data + size, (unsigned char) POISON_BYTE, sizeof(T));
+    }
+
+    template <typename T> static unsigned verify(const State &, const T *data, size_t size, size_t capacity)
+    {
+        unsigned err = verify_meta(data, size, capacity);
+        if (err || data == nullptr) return err;
+
+        const unsigned char *bytes = (const unsigned char *) data;
+
+        for (size_t counter = size * sizeof(T); counter < capacity * sizeof(T); ++counter)
+        {
+            if (bytes[counter] != (unsigned char) POISON_BYTE)
+            {
+                make_bit_true(&err, NON_ACTIVE_NON_POISON_VALUES);
+                break;
+            }
+        }
+
+        return err;
+    }
+};
+
+/**
+*   @brief Keeps the hash of the whole elements store. "hash" is one of the functions of "stack_hash.h":
+*   @brief "HashProtection" uses djb2 (the same hash as "get_hash()" of "stack.h" by default),
+*   @brief "Crc32cProtection" and "Mul64Protection" use the faster ones.
+*/
+
+typedef unsigned long long (*hash_func_t)(const void *buf, const size_t len, const unsigned long long seed);
+
+template <hash_func_t hash>
+struct BasicHashProtection
+{
+    static const size_t SLACK = 0;
+
+    struct State
+    {
+        unsigned long long hash_val;
+    };
+
+    static unsigned long long get_hash(const void *_data_store, const size_t len)
+    {
+        return hash(_data_store, len, HASH_START);
+    }
+
+    template <typename T> static void on_alloc(State &state, T *data, size_t, size_t capacity)
+    {
+        state.hash_val = get_hash(data, capacity * sizeof(T));
+    }
+
+    template <typename T> static void on_push(State &state, T *data, size_t size, size_t capacity)
+    {
+        on_alloc(state, data, size, capacity);
+    }
+
+    template <typename T> static void on_pop(State &state, T *data, size_t size, size_t capacity)
+    {
+        on_alloc(state, data, size, capacity);
+    }
+
+    template <typename T> static unsigned verify(const State &state, const T *data, size_t size, size_t capacity)
+    {
+        unsigned err = verify_meta(data, size, capacity);
+        if (err || data == nullptr) return err;
+
+        if (get_hash(data, capacity * sizeof(T)) != state.hash_val)
+            make_bit_true(&err, HASH_PROTECTION_FAILED);
+
+        return err;
+    }
+};
+
+typedef BasicHashProtection<hash_djb2>   HashProtection;
+typedef BasicHashProtection<hash_crc32c> Crc32cProtection;
+typedef BasicHashProtection<hash_mul64>  Mul64Protection;
+
+/**
+*   @brief Combines two protection policies. Can be nested to combine more.
+*/
+
+template <typename First, typename Second>
+struct Protections
+{
+    static const size_t SLACK = (First::SLACK > Second::SLACK) ? First::SLACK : Second::SLACK;
+
+    struct State
+    {
+        typename First ::State first;
+        typename Second::State second;
+    };
+
+    template <typename T> static void on_alloc(State &state, T *data, size_t size, size_t capacity)
+    {
+        First ::on_alloc(state.first,  data, size, capacity);
+        Second::on_alloc(state.second, data, size, capacity);
+    }
+
+    template <typename T> static void on_push(State &state, T *data, size_t size, size_t capacity)
+    {
+        First ::on_push(state.first,  data, size, capacity);
+        Second::on_push(state.second, data, size, capacity);
+    }
+
+    template <typename T> static void on_pop(State &state, T *data, size_t size, size_t capacity)
+    {
+        First ::on_pop(state.first,  data, size, capacity);
+        Second::on_pop(state.second, data, size, capacity);
+    }
+
+    template <typename T> static unsigned verify(const State &state, const T *data, size_t size, size_t capacity)
+    {
+        return First ::verify(state.first,  data, size, capacity) |
+               Second::verify(state.second, data, size, capacity);
+    }
+};
+
+/**
+*   @brief Analogue of "stack.h" with CANARY_PROTECTION and HASH_PROTECTION.
+*   @brief Hash goes last, so it covers the store after the poison is written.
+*/
+
+typedef Protections<CanaryProtection, Protections<PoisonProtection, HashProtection> > FullProtection;
+
+/*----------------------------------------------LOGGING_POLICIES-----------------------------------------------------*/
+
+/**
+*   @brief Logging policy interface (all functions are static):
+*
+*   @param call - called at the beginning of the traced function
+*   @param ret  - called at the end       of the traced function, returns "err"
+*/
+
+struct NoLogging
+{
+    static void     call(const char *, const void *)    {}
+    static unsigned ret (const char *, unsigned err)    { return err; }
+};
+
+/**
+*   @brief Writes the traced calls in the same HTML layout as "stack.h" into "HtmlLogging::stream"
+*   @brief (stderr if it is nullptr).
+*/
+
+struct HtmlLogging
+{
+    static inline FILE *stream  = nullptr;
+    static inline int   tab_num = 0;
+
+    static FILE *out() { return stream ? stream : stderr; }
+
+    static void tabs()
+    {
+        for (int counter = 0; counter < tab_num; ++counter) fputc('\t', out());
+    }
+
+    static void call(const char *function_name, const void *stk)
+    {
+        fprintf(out(), "%s(stk = %p)\n\n", function_name, stk);
+        ++tab_num;
+        tabs();
+    }
+
+    static unsigned ret(const char *function_name, unsigned err)
+    {
+        if (tab_num > 0) --tab_num;
+
+        fprintf(out(), "<font color=>%s returns %u\n\n", function_name, err);
+        tabs();
+        fprintf(out(), "</font>");
+
+        return err;
+    }
+};
+
+/*-----------------------------------------------GROWTH_POLICIES-----------------------------------------------------*/
+
+/**
+*   @brief Growth policy interface (all functions are static):
+*
+*   @param grow   - returns the new capacity when the "Stack" is full
+*   @param shrink - returns the new capacity after pop, 0 means "don't reallocate"
+*/
+
+struct DoublingGrowth
+{
+    static size_t grow(size_t capacity)
+    {
+        return (capacity < 2) ? 4 : 2 * capacity;
+    }
+
+    static size_t shrink(size_t size, size_t capacity)
+    {
+        return (size != 0 && capacity >= 4 * size) ? 2 * size : 0;
+    }
+};
+
+struct NoShrinkGrowth
+{
+    static size_t grow  (size_t capacity) { return DoublingGrowth::grow(capacity); }
+    static size_t shrink(size_t, size_t)  { return 0; }
+};
+
+/*---------------------------------------------------STACK-----------------------------------------------------------*/
+
+/**
+*   @brief Data structure, which stores the ordered subsequence of "T"-type elements, organaized according to the LIFO principle.
+*   @brief "T" must be trivially copyable, because the store is moved by realloc().
+*
+*   @param     data - pointer to the "Stack" elements store
+*   @param     size - number of elements in the "Stack"
+*   @param capacity - number of "Stack" elements which may be fit in allocated memory
+*
+*   @note "ProtectionPolicy::State" is a private base, so an empty state takes no memory.
+*/
+
+template <typename T, typename ProtectionPolicy = NoProtection,
+                      typename LoggingPolicy    = NoLogging,
+                      typename GrowthPolicy     = DoublingGrowth>
+class Stack : private ProtectionPolicy::State
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Stack elements are moved by realloc()");
+
+    T     *data;
+    size_t size;
+    size_t capacity;
+
+    typename ProtectionPolicy::State &state() { return *this; }
+
+    /**
+    *   @brief Moves the elements store to the memory of "future_capacity" elements.
+    *
+    *   @return bit-mask which encodes the errors from "enum _StackError"
+    */
+
+    unsigned reserve_exact(size_t future_capacity)
+    {
+        const size_t SLACK = ProtectionPolicy::SLACK;
+
+        char *old_store = data ? (char *) data - SLACK : nullptr;
+        char *new_store = (char *) realloc(old_store, future_capacity * sizeof(T) + 2 * SLACK);
+
+        if (new_store == nullptr)
+        {
+            unsigned err = 0;
+            make_bit_true(&err, MEMORY_LIMIT_EXCEEDED);
+
+            return err;
+        }
+
+        data     = (T *) (new_store + SLACK);
+        capacity = future_capacity;
+
+        ProtectionPolicy::on_alloc(state(), data, size, capacity);
+
+        return STACK_OK;
+    }
+
+  public:
+
+    Stack():
+        ProtectionPolicy::State(),
+        data    (nullptr),
+        size    (0),
+        capacity(0)
+        {}
+
+    Stack            (const Stack &) = delete;
+    Stack &operator= (const Stack &) = delete;
+
+    ~Stack()
+    {
+        if (data) free((char *) data - ProtectionPolicy::SLACK);
+
+        data     = nullptr;
+        size     = 0;
+        capacity = 0;
+    }
+
+    size_t get_size    () const { return size;     }
+    size_t get_capacity() const { return capacity; }
+
+    /**
+    *   @brief Check if the "Stack" is invalid according to the "ProtectionPolicy".
+    *
+    *   @return bit-mask which encodes the errors from "enum _StackError"
+    */
+
+    unsigned verify() const
+    {
+        return ProtectionPolicy::verify((const typename ProtectionPolicy::State &) *this, data, size, capacity);
+    }
+
+    /**
+    *   @brief Add the element into the "Stack".
+    *
+    *   @param push_val [in] push_val - value of element to put
+    *
+    *   @return bit-mask which encodes the errors from "enum _StackError"
+    */
+
+    unsigned push(const T &push_val)
+    {
+        LoggingPolicy::call(__PRETTY_FUNCTION__, this);
+
+        unsigned err = verify();
+        if (err) return LoggingPolicy::ret(__PRETTY_FUNCTION__, err);
+
+        if (size == capacity)
+        {
+            err = reserve_exact(GrowthPolicy::grow(capacity));
+            if (err) return LoggingPolicy::ret(__PRETTY_FUNCTION__, err);
+        }
+
+        data[size++] = push_val;
+        ProtectionPolicy::on_push(state(), data, size, capacity);
+
+        return LoggingPolicy::ret(__PRETTY_FUNCTION__, verify());
+    }
+
+    /**
+    *   @brief Deletes the front element of the "Stack". Puts it in variable pointed by "front_val" before deliting.
+    *
+    *   @param front_val [out] front_val - pointer to the front element, may be nullptr
+    *
+    *   @return bit-mask which encodes the errors from "enum _StackError"
+    */
+
+    unsigned pop(T *const front_val = nullptr)
+    {
+        LoggingPolicy::call(__PRETTY_FUNCTION__, this);
+
+        unsigned err = verify();
+        if (err) return LoggingPolicy::ret(__PRETTY_FUNCTION__, err);
+
+        if (size == 0)
+        {
+            make_bit_true(&err, STACK_EMPTY);
+            return LoggingPolicy::ret(__PRETTY_FUNCTION__, err);
+        }
+
+        --size;
+
+        if (front_val != nullptr)
+            *front_val = data[size];
+
+        ProtectionPolicy::on_pop(state(), data, size, capacity);
+
+        size_t future_capacity = GrowthPolicy::shrink(size, capacity);
+        if (future_capacity)
+        {
+            err = reserve_exact(future_capacity);
+            if (err) return LoggingPolicy::ret(__PRETTY_FUNCTION__, err);
+        }
+
+        return LoggingPolicy::ret(__PRETTY_FUNCTION__, verify());
+    }
+};
+
+} // namespace policy
+
+#endif //STACK_TEMPLATE_H
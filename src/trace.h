@@ -0,0 +1,616 @@
+/** @file */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <inttypes.h>
+#include <time.h>
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+#endif
+
+/**
+*   @brief Binary trace format of the "Stack" log (LOG_TRACE mode).
+*   @brief The hot path only copies a fixed-size "TraceRecord" into a memory buffer, all formatting is deferred
+*   @brief to the offline renderer (tools/trace_render.cpp) which turns the trace into the usual log.html layout.
+*
+*   @brief File layout: "TraceHeader", then the sequence of "TraceRecord", each one followed by "payload_len" bytes.
+*
+*   @brief Every thread collects its records in its own buffer and writes it by one fwrite(), so the records of one
+*   @brief thread go in blocks and never split. TRACE_STRING record is written at once, before any record which uses it.
+*/
+
+/**
+*   @brief The enum contains events of the trace.
+*
+*   @param TRACE_TEXT          - already formatted text (cold paths: constructor, dumps), payload is the text
+*   @param TRACE_STRING        - string table entry, arg[0] is the id of the string, payload is the string
+*   @param TRACE_FUNC_END      - "log_func_end()", arg[0] is the id of the function name, arg[1] is the returned value
+*   @param TRACE_PUSH          - "StackPush()"   call, payload is the bytes of the pushed value
+*   @param TRACE_POP           - "StackPop()"    call, arg[0] is "front_val"
+*   @param TRACE_VERIFY        - "StackVerify()" call
+*   @param TRACE_REALLOC       - "StackRealloc()" call, arg[0] is "condition"
+*   @param TRACE_DTOR          - "StackDtor()"   call
+*   @param TRACE_FILL_POISON   - "FillPoison()"  call, arg[0..3] are "elem_size", "left", "right", "poison_val",
+*                                "stk" is "_fillable_elem"
+*   @param TRACE_PUSH_N        - "StackPushN()"  call, arg[0] is "push_vals",  arg[1] is "num"
+*   @param TRACE_POP_N         - "StackPopN()"   call, arg[0] is "front_vals", arg[1] is "num"
+*   @param TRACE_RESERVE       - "StackReserve()" call, arg[0] is "capacity"
+*   @param TRACE_SHRINK_TO_FIT - "StackShrinkToFit()" call
+*/
+
+typedef enum _TraceEvent
+{
+    TRACE_TEXT          = 0,
+    TRACE_STRING        = 1,
+    TRACE_FUNC_END      = 2,
+    TRACE_PUSH          = 3,
+    TRACE_POP           = 4,
+    TRACE_VERIFY        = 5,
+    TRACE_REALLOC       = 6,
+    TRACE_DTOR          = 7,
+    TRACE_FILL_POISON   = 8,
+    TRACE_PUSH_N        = 9,
+    TRACE_POP_N         = 10,
+    TRACE_RESERVE       = 11,
+    TRACE_SHRINK_TO_FIT = 12
+
+} TraceEvent;
+
+/**
+*   @brief Header of the trace file.
+*
+*   @param       magic - TRACE_MAGIC
+*   @param     version - TRACE_VERSION
+*   @param   elem_size - sizeof(Stack_elem) of the traced program
+*   @param poison_byte - POISON_BYTE of the traced program
+*/
+
+typedef struct _TraceHeader
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t elem_size;
+    uint8_t  poison_byte;
+    uint8_t  reserved[7];
+
+} TraceHeader;
+
+/**
+*   @brief One event of the trace.
+*
+*   @param       event - value from "enum _TraceEvent"
+*   @param     tab_num - nesting of the traced calls of the thread when the event happened
+*   @param payload_len - number of bytes following the record
+*   @param   timestamp - TSC (or nanoseconds of CLOCK_MONOTONIC on non-x86) when the event happened
+*   @param         stk - pointer to the "Stack" of the event
+*   @param         arg - arguments of the event
+*/
+
+typedef struct _TraceRecord
+{
+    uint16_t event;
+    int16_t  tab_num;
+    uint32_t payload_len;
+    uint64_t timestamp;
+    uint64_t stk;
+    uint64_t arg[4];
+
+} TraceRecord;
+
+const char     TRACE_MAGIC[8]      = {'S', 'T', 'K', 'T', 'R', 'A', 'C', 'E'};
+const uint32_t TRACE_VERSION       = 2;
+
+const size_t   TRACE_BUF_SIZE      = 1 << 16;
+const int      TRACE_STRING_CHUNK  = 64;   ///< entries in one chunk of the string table
+const int      TRACE_STRING_CHUNKS = 1024; ///< chunks of the string table
+
+/*----------------------------------------------FORMATS_OF_EVENTS----------------------------------------------------*/
+
+/**
+*   @brief Formats of the traced calls. They are shared by the live log (without LOG_TRACE) and the offline renderer,
+*   @brief so both produce the same log.html. Every "%s" after a new line is the current TAB_SHIFT.
+*/
+
+#define TRACE_FORMAT_PUSH_BEGIN "StackPush(stk = %p, push_val = "
+#define TRACE_FORMAT_PUSH_END   ")\n\n%s\t"
+#define TRACE_FORMAT_POP        "StackPop(stk = %p, front_val = %p)\n\n%s"
+#define TRACE_FORMAT_PUSH_N     "StackPushN(stk = %p, push_vals = %p, num = %lu)\n\n%s"
+#define TRACE_FORMAT_POP_N      "StackPopN(stk = %p, front_vals = %p, num = %lu)\n\n%s"
+#define TRACE_FORMAT_RESERVE    "StackReserve(stk = %p, capacity = %lu)\n\n%s"
+#define TRACE_FORMAT_SHRINK_TO_FIT "StackShrinkToFit(stk = %p)\n\n%s"
+#define TRACE_FORMAT_VERIFY     "StackVerify(stk = %p)\n\n%s"
+#define TRACE_FORMAT_REALLOC    "StackRealloc(stk = %p, condition = %d)\n\n%s"
+#define TRACE_FORMAT_DTOR       "StackDtor(stk = %p)\n\n%s"
+#define TRACE_FORMAT_FUNC_END   "<font color=>%s returns %d\n\n%s</font>"
+#define TRACE_FORMAT_ELEM_BYTE  "<font color=MediumBlue>%x</font>"
+#define TRACE_FORMAT_ELEM_POISON "<font color=Olive>(POISON)</font>"
+
+#define TRACE_FORMAT_FILL_POISON                                                                                      \
+        "FillPoison(_fillable_elem = %p, elem_size = %lu,\n%s"                                                        \
+        "                                                left  = %lu,\n%s"                                            \
+        "                                                right = %lu, poison_val = %u)\n\n%s"
+
+/*-------------------------------------------------TRACE_WRITER------------------------------------------------------*/
+
+/**
+*   @brief State of the trace writer shared by all threads.
+*
+*   @param      stream - trace file
+*   @param     tab_num - function which returns the nesting of the traced calls of the calling thread
+*   @param        lock - mutex which orders the writes to the "stream" and the additions to the "strings"
+*   @param     strings - already written entries of the string table, the entry of the id is
+*                        strings[id / TRACE_STRING_CHUNK][id % TRACE_STRING_CHUNK]; chunks are allocated on demand
+*                        and never move, so the entries are read without the "lock"
+*   @param strings_num - number of the given ids, it is read without the "lock";
+*                        ids above the table size are given but not kept
+*/
+
+typedef struct _TraceWriter
+{
+    FILE       *stream;
+    int       (*tab_num)();
+
+    pthread_mutex_t lock;
+
+    const char **strings[TRACE_STRING_CHUNKS];
+    int          strings_num;
+
+} TraceWriter;
+
+TraceWriter TRACE_WRITER = {nullptr, nullptr, PTHREAD_MUTEX_INITIALIZER, {}, 0};
+
+/**
+*   @brief Records of one thread collected since the last write.
+*
+*   @param      buf - memory of TRACE_BUF_SIZE bytes, allocated at the first event of the thread
+*   @param buf_size - number of bytes in the "buf"
+*   @param   exited - marker if the "buf" is already freed at the thread exit, the later records are written at once
+*/
+
+typedef struct _TraceBuffer
+{
+    char   *buf;
+    size_t  buf_size;
+    int     exited;
+
+} TraceBuffer;
+
+thread_local TraceBuffer TRACE_BUFFER = {};
+
+/**
+*   @brief Returns the timestamp of the event: TSC on x86 and nanoseconds of CLOCK_MONOTONIC else.
+*/
+
+static inline uint64_t trace_timestamp()
+{
+    #if defined(__x86_64__) || defined(__i386__)
+
+        return __rdtsc();
+
+    #else
+
+        struct timespec now = {};
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        return (uint64_t) now.tv_sec * 1000000000u + (uint64_t) now.tv_nsec;
+
+    #endif
+}
+
+/**
+*   @brief Writes the records collected by the calling thread into the trace file.
+*
+*   @return nothing
+*/
+
+static void trace_flush()
+{
+    assert(TRACE_WRITER.stream != nullptr);
+
+    pthread_mutex_lock(&TRACE_WRITER.lock);
+
+    fwrite(TRACE_BUFFER.buf, 1, TRACE_BUFFER.buf_size, TRACE_WRITER.stream);
+    fflush(TRACE_WRITER.stream);
+
+    pthread_mutex_unlock(&TRACE_WRITER.lock);
+
+    TRACE_BUFFER.buf_size = 0;
+}
+
+/**
+*   @brief Writes the rest of the records of the thread and frees its buffer at the thread exit. The later events
+*   @brief of the thread (other thread_local destructors, the atexit() handlers of the main thread) skip the buffer.
+*/
+
+struct TraceBufferExit
+{
+    ~TraceBufferExit()
+    {
+        if (TRACE_BUFFER.buf_size != 0) trace_flush();
+
+        free(TRACE_BUFFER.buf);
+
+        TRACE_BUFFER        = {};
+        TRACE_BUFFER.exited = 1;
+    }
+};
+
+/**
+*   @brief Appends bytes to the trace buffer of the calling thread. The caller makes sure that they fit in.
+*
+*   @param src [in] src - pointer to the first byte to append
+*   @param len [in] len - number of bytes to append
+*
+*   @return nothing
+*/
+
+static void trace_append(const void *src, size_t len)
+{
+    assert(TRACE_BUFFER.buf_size + len <= TRACE_BUF_SIZE);
+
+    memcpy(TRACE_BUFFER.buf + TRACE_BUFFER.buf_size, src, len);
+    TRACE_BUFFER.buf_size += len;
+}
+
+/**
+*   @brief Fills the record of the event with the nesting of the calling thread and the current timestamp.
+*/
+
+static TraceRecord trace_record(const TraceEvent event, const void *stk, uint64_t arg0, uint64_t arg1,
+                                                                        uint64_t arg2, uint64_t arg3,
+                                                                        const size_t payload_len)
+{
+    TraceRecord record = {};
+
+    record.event       = (uint16_t) event;
+    record.tab_num     = (int16_t)  (TRACE_WRITER.tab_num ? TRACE_WRITER.tab_num() : 0);
+    record.payload_len = (uint32_t) payload_len;
+    record.timestamp   = trace_timestamp();
+    record.stk         = (uint64_t) (uintptr_t) stk;
+    record.arg[0]      = arg0;
+    record.arg[1]      = arg1;
+    record.arg[2]      = arg2;
+    record.arg[3]      = arg3;
+
+    return record;
+}
+
+/**
+*   @brief Appends the event to the trace buffer of the calling thread.
+*
+*   @param       event [in]       event - value from "enum _TraceEvent"
+*   @param         stk [in]         stk - pointer to the "Stack" of the event
+*   @param        arg0 [in]        arg0 - first  argument of the event
+*   @param        arg1 [in]        arg1 - second argument of the event
+*   @param        arg2 [in]        arg2 - third  argument of the event
+*   @param        arg3 [in]        arg3 - fourth argument of the event
+*   @param     payload [in]     payload - pointer to the bytes following the record (may be nullptr if "payload_len" is 0)
+*   @param payload_len [in] payload_len - number of bytes following the record
+*
+*   @return nothing
+*/
+
+static void trace_event(const TraceEvent event, const void *stk, uint64_t arg0 = 0, uint64_t arg1 = 0,
+                                                                 uint64_t arg2 = 0, uint64_t arg3 = 0,
+                        const void *payload = nullptr, const size_t payload_len = 0)
+{
+    TraceRecord record = trace_record(event, stk, arg0, arg1, arg2, arg3, payload_len);
+
+    if (TRACE_BUFFER.buf == nullptr && !TRACE_BUFFER.exited)
+    {
+        static thread_local TraceBufferExit buffer_exit;
+        (void) buffer_exit;
+
+        TRACE_BUFFER.buf = (char *) calloc(TRACE_BUF_SIZE, sizeof(char));
+        assert(TRACE_BUFFER.buf != nullptr);
+    }
+
+    // the event never splits between two writes, else the records of other threads could get in the middle
+    if (TRACE_BUFFER.buf_size + sizeof(TraceRecord) + payload_len > TRACE_BUF_SIZE)
+        trace_flush();
+
+    if (sizeof(TraceRecord) + payload_len > TRACE_BUF_SIZE || TRACE_BUFFER.exited)
+    {
+        pthread_mutex_lock(&TRACE_WRITER.lock);
+
+        fwrite(&record, sizeof(TraceRecord), 1, TRACE_WRITER.stream);
+        fwrite(payload, 1, payload_len, TRACE_WRITER.stream);
+
+        pthread_mutex_unlock(&TRACE_WRITER.lock);
+        return;
+    }
+
+    trace_append(&record, sizeof(TraceRecord));
+
+    if (payload_len) trace_append(payload, payload_len);
+}
+
+/**
+*   @brief Returns the id of the string in the string table. Writes the TRACE_STRING event when the string is met
+*   @brief the first time. Strings are compared by pointers, so it is meant for __PRETTY_FUNCTION__ and literals.
+*
+*   @param str [in] str - pointer to the null-terminated string
+*
+*   @return id of the string
+*/
+
+static uint64_t trace_string_id(const char *str)
+{
+    const int STRINGS_MAX = TRACE_STRING_CHUNK * TRACE_STRING_CHUNKS;
+
+    // ids are never reused and entries are never changed after "strings_num" covers them,
+    // so they are searched without the lock and every record keeps the meaning of its id
+    int strings_num = __atomic_load_n(&TRACE_WRITER.strings_num, __ATOMIC_ACQUIRE);
+    int kept_num    = (strings_num < STRINGS_MAX) ? strings_num : STRINGS_MAX;
+
+    for (int counter = 0; counter < kept_num; ++counter)
+    {
+        if (TRACE_WRITER.strings[counter / TRACE_STRING_CHUNK][counter % TRACE_STRING_CHUNK] == str)
+            return (uint64_t) counter;
+    }
+
+    pthread_mutex_lock(&TRACE_WRITER.lock);
+
+    kept_num = (TRACE_WRITER.strings_num < STRINGS_MAX) ? TRACE_WRITER.strings_num : STRINGS_MAX;
+
+    for (int counter = strings_num; counter < kept_num; ++counter)
+    {
+        if (TRACE_WRITER.strings[counter / TRACE_STRING_CHUNK][counter % TRACE_STRING_CHUNK] == str)
+        {
+            pthread_mutex_unlock(&TRACE_WRITER.lock);
+            return (uint64_t) counter;
+        }
+    }
+
+    int id = TRACE_WRITER.strings_num;
+
+    if (id < STRINGS_MAX)
+    {
+        const char ***chunk = TRACE_WRITER.strings + id / TRACE_STRING_CHUNK;
+
+        if (*chunk == nullptr)
+            *chunk = (const char **) calloc(TRACE_STRING_CHUNK, sizeof(const char *));
+
+        if (*chunk != nullptr)
+            (*chunk)[id % TRACE_STRING_CHUNK] = str;
+        else
+            id = STRINGS_MAX; // no memory for the chunk: the table is full from now on
+    }
+
+    // a string which doesn't fit into the table gets a new id at every call, so it is written every time,
+    // but the ids are not reused (up to INT32_MAX, which is the last one)
+    if (id < INT32_MAX)
+        __atomic_store_n(&TRACE_WRITER.strings_num, id + 1, __ATOMIC_RELEASE);
+
+    size_t      len    = strlen(str);
+    TraceRecord record = trace_record(TRACE_STRING, nullptr, (uint64_t) id, 0, 0, 0, len);
+
+    fwrite(&record, sizeof(TraceRecord), 1, TRACE_WRITER.stream);
+    fwrite(str, 1, len, TRACE_WRITER.stream);
+
+    pthread_mutex_unlock(&TRACE_WRITER.lock);
+    return (uint64_t) id;
+}
+
+/**
+*   @brief Opens the trace file and writes the "TraceHeader".
+*
+*   @param   file_name [in]   file_name - name of the trace file
+*   @param   elem_size [in]   elem_size - sizeof(Stack_elem)
+*   @param poison_byte [in] poison_byte - POISON_BYTE
+*   @param     tab_num [in]     tab_num - function which returns the nesting of the traced calls of the calling thread
+*
+*   @return pointer to the trace file stream, nullptr if opening failed
+*/
+
+static FILE *trace_open(const char *file_name, const size_t elem_size, const unsigned char poison_byte,
+                                                                       int               (*tab_num)())
+{
+    assert(file_name != nullptr);
+
+    TRACE_WRITER.tab_num = tab_num;
+
+    TRACE_WRITER.stream = fopen(file_name, "wb");
+    if (TRACE_WRITER.stream == nullptr) return nullptr;
+
+    TraceHeader header = {};
+
+    memcpy(header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    header.version     = TRACE_VERSION;
+    header.elem_size   = (uint32_t) elem_size;
+    header.poison_byte = poison_byte;
+
+    fwrite(&header, sizeof(TraceHeader), 1, TRACE_WRITER.stream);
+
+    return TRACE_WRITER.stream;
+}
+
+/*-------------------------------------------------TRACE_RENDERER----------------------------------------------------*/
+
+/**
+*   @brief State of the offline renderer.
+*
+*   @param         out - stream of the rendered log.html
+*   @param      header - header of the rendered trace
+*   @param     tab_num - current nesting of the traced calls
+*   @param   tab_shift - string of "tab_num" tabs
+*   @param tab_cap     - size of the "tab_shift" memory
+*   @param     strings - string table, "strings_cap" entries, grows with the ids met
+*   @param strings_cap - size of the "strings"
+*/
+
+typedef struct _TraceRenderer
+{
+    FILE        *out;
+    TraceHeader  header;
+
+    int          tab_num;
+    char        *tab_shift;
+    size_t       tab_cap;
+
+    char       **strings;
+    size_t       strings_cap;
+
+} TraceRenderer;
+
+/**
+*   @brief Sets the nesting of the renderer and rebuilds the "tab_shift" string.
+*
+*   @return nothing
+*/
+
+static void trace_render_shift(TraceRenderer *rnd, const int tab_num)
+{
+    assert(rnd != nullptr);
+
+    rnd->tab_num = tab_num;
+    size_t tabs = (rnd->tab_num > 0) ? (size_t) rnd->tab_num : 0;
+
+    if (tabs + 1 > rnd->tab_cap)
+    {
+        size_t new_cap = 2 * (tabs + 1);
+        char  *new_mem = (char *) realloc(rnd->tab_shift, new_cap);
+        assert(new_mem != nullptr);
+
+        rnd->tab_shift = new_mem;
+        rnd->tab_cap   = new_cap;
+    }
+
+    memset(rnd->tab_shift, '\t', tabs);
+    rnd->tab_shift[tabs] = '\0';
+}
+
+/**
+*   @brief Renders one event of the trace in the same way as the live log does it.
+*
+*   @param     rnd [in][out] rnd - pointer to the renderer
+*   @param  record [in]   record - pointer to the event
+*   @param payload [in]  payload - bytes following the event
+*
+*   @return nothing
+*/
+
+static void trace_render_event(TraceRenderer *rnd, const TraceRecord *record, const unsigned char *payload)
+{
+    assert(rnd    != nullptr);
+    assert(record != nullptr);
+
+    const void *stk = (const void *) (uintptr_t) record->stk;
+
+    if (record->event != TRACE_TEXT && record->event != TRACE_STRING)
+        trace_render_shift(rnd, record->tab_num);
+
+    switch ((TraceEvent) record->event)
+    {
+        case TRACE_TEXT:
+            fwrite(payload, 1, record->payload_len, rnd->out);
+            break;
+
+        case TRACE_STRING:
+        {
+            size_t id = (size_t) record->arg[0];
+            if (id > INT32_MAX) break;
+
+            if (id >= rnd->strings_cap)
+            {
+                size_t new_cap = 2 * (id + 1);
+                char **new_mem = (char **) realloc(rnd->strings, new_cap * sizeof(char *));
+                if (new_mem == nullptr) break;
+
+                memset(new_mem + rnd->strings_cap, 0, (new_cap - rnd->strings_cap) * sizeof(char *));
+
+                rnd->strings     = new_mem;
+                rnd->strings_cap = new_cap;
+            }
+
+            free(rnd->strings[id]);
+
+            rnd->strings[id] = (char *) calloc(record->payload_len + 1, sizeof(char));
+            assert(rnd->strings[id] != nullptr);
+
+            memcpy(rnd->strings[id], payload, record->payload_len);
+            break;
+        }
+
+        case TRACE_FUNC_END:
+        {
+            size_t      id   = (size_t) record->arg[0];
+            const char *name = (id < rnd->strings_cap && rnd->strings[id]) ? rnd->strings[id] : "?";
+
+            fprintf(rnd->out, TRACE_FORMAT_FUNC_END, name, (int) record->arg[1], rnd->tab_shift);
+            break;
+        }
+
+        case TRACE_PUSH:
+        {
+            fprintf(rnd->out, TRACE_FORMAT_PUSH_BEGIN, stk);
+
+            unsigned char is_poison = 1;
+
+            for (size_t counter = 0; counter < record->payload_len; ++counter)
+            {
+                if (payload[counter] != rnd->header.poison_byte) is_poison = 0;
+
+                fprintf(rnd->out, TRACE_FORMAT_ELEM_BYTE, payload[counter]);
+            }
+            if (is_poison) fprintf(rnd->out, TRACE_FORMAT_ELEM_POISON);
+
+            fprintf(rnd->out, TRACE_FORMAT_PUSH_END, rnd->tab_shift);
+            break;
+        }
+
+        case TRACE_POP:
+            fprintf(rnd->out, TRACE_FORMAT_POP, stk, (const void *) (uintptr_t) record->arg[0], rnd->tab_shift);
+            break;
+
+        case TRACE_PUSH_N:
+            fprintf(rnd->out, TRACE_FORMAT_PUSH_N, stk, (const void *) (uintptr_t) record->arg[0],
+                                                        (unsigned long)            record->arg[1], rnd->tab_shift);
+            break;
+
+        case TRACE_POP_N:
+            fprintf(rnd->out, TRACE_FORMAT_POP_N,  stk, (const void *) (uintptr_t) record->arg[0],
+                                                        (unsigned long)            record->arg[1], rnd->tab_shift);
+            break;
+
+        case TRACE_RESERVE:
+            fprintf(rnd->out, TRACE_FORMAT_RESERVE, stk, (unsigned long) record->arg[0], rnd->tab_shift);
+            break;
+
+        case TRACE_SHRINK_TO_FIT:
+            fprintf(rnd->out, TRACE_FORMAT_SHRINK_TO_FIT, stk, rnd->tab_shift);
+            break;
+
+        case TRACE_VERIFY:
+            fprintf(rnd->out, TRACE_FORMAT_VERIFY, stk, rnd->tab_shift);
+            break;
+
+        case TRACE_REALLOC:
+            fprintf(rnd->out, TRACE_FORMAT_REALLOC, stk, (int) record->arg[0], rnd->tab_shift);
+            break;
+
+        case TRACE_DTOR:
+            fprintf(rnd->out, TRACE_FORMAT_DTOR, stk, rnd->tab_shift);
+            break;
+
+        case TRACE_FILL_POISON:
+            fprintf(rnd->out, TRACE_FORMAT_FILL_POISON, stk, (unsigned long) record->arg[0], rnd->tab_shift,
+                                                               (unsigned long) record->arg[1], rnd->tab_shift,
+                                                               (unsigned long) record->arg[2],
+                                                               (unsigned)      record->arg[3], rnd->tab_shift);
+            break;
+
+        default:
+            fprintf(stderr, "trace: unknown event %u skipped\n", (unsigned) record->event);
+            break;
+    }
+}
+
+#endif //TRACE_H
@@ -0,0 +1,80 @@
+/** @file */
+
+/**
+*   @brief Zero-overhead check of "stack_template.h": the same functions "disasm_push()" and "disasm_pop()" are compiled
+*   @brief twice, once as "policy::Stack<int, NoProtection, NoLogging>::push()" and "pop()" (DISASM_TEMPLATE) and once
+*   @brief as a hand-written growing array with the same layout, growth and shrink. "make disasm_test" diffs
+*   @brief "objdump -d" of both objects function by function, so any instruction which the policies add shows up
+*   @brief in the diff and fails the target.
+*/
+
+#include <stdlib.h>
+#include <stddef.h>
+
+#include "../src/stack_template.h"
+
+#ifdef DISASM_TEMPLATE
+
+typedef policy::Stack<int, policy::NoProtection, policy::NoLogging> DisasmStack;
+
+extern "C" unsigned disasm_push(DisasmStack *stk, const int *push_val)
+{
+    return stk->push(*push_val);
+}
+
+extern "C" unsigned disasm_pop(DisasmStack *stk, int *front_val)
+{
+    return stk->pop(front_val);
+}
+
+#else
+
+struct DisasmStack
+{
+    int   *data;
+    size_t size;
+    size_t capacity;
+};
+
+extern "C" unsigned disasm_push(DisasmStack *stk, const int *push_val)
+{
+    if (stk->size == stk->capacity)
+    {
+        size_t future_capacity = (stk->capacity < 2) ? 4 : 2 * stk->capacity;
+
+        int *data = (int *) realloc(stk->data, future_capacity * sizeof(int));
+        if (data == nullptr) return 1u << MEMORY_LIMIT_EXCEEDED;
+
+        stk->data     = data;
+        stk->capacity = future_capacity;
+    }
+
+    stk->data[stk->size++] = *push_val;
+
+    return STACK_OK;
+}
+
+extern "C" unsigned disasm_pop(DisasmStack *stk, int *front_val)
+{
+    if (stk->size == 0) return 1u << STACK_EMPTY;
+
+    --stk->size;
+
+    if (front_val != nullptr)
+        *front_val = stk->data[stk->size];
+
+    size_t future_capacity = (stk->size != 0 && stk->capacity >= 4 * stk->size) ? 2 * stk->size : 0;
+
+    if (future_capacity)
+    {
+        int *data = (int *) realloc(stk->data, future_capacity * sizeof(int));
+        if (data == nullptr) return 1u << MEMORY_LIMIT_EXCEEDED;
+
+        stk->data     = data;
+        stk->capacity = future_capacity;
+    }
+
+    return STACK_OK;
+}
+
+#endif
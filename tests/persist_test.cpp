@@ -0,0 +1,261 @@
+/** @file */
+
+/**
+*   @brief Crash test of STACK_PERSISTENT mode. Every cycle forks a child which opens the file and runs random pushes,
+*   @brief pops, batches and shrinks until the parent kills it by SIGKILL at a random moment. Then the parent opens
+*   @brief the file itself and checks that the "Stack" is valid, every element is the one which was pushed at its
+*   @brief index and the size is the committed size either before or after the operation the child was killed in.
+*   @brief The cycles go through all "PersistSync" policies.
+*
+*   @brief Usage: persist_test [number of cycles] [seed]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+typedef long long Stack_elem;
+
+#include "../src/stack.h"
+
+#ifndef STACK_PERSISTENT
+    #error "persist_test needs STACK_PERSISTENT mode"
+#endif
+
+/**
+*   @brief Constants of the test.
+*
+*   @param PERSIST_MAX_SIZE  - size above which the child only pops
+*   @param PERSIST_BATCH     - maximum number of elements of "StackPushN()" and "StackPopN()"
+*   @param PERSIST_MIN_KILL  - minimum lifetime of the child in microseconds
+*   @param PERSIST_MAX_KILL  - maximum lifetime of the child in microseconds
+*/
+
+enum _PersistTestConst
+{
+    PERSIST_MAX_SIZE = 20000,
+    PERSIST_BATCH    = 64,
+    PERSIST_MIN_KILL = 5000,
+    PERSIST_MAX_KILL = 95000
+};
+
+/**
+*   @brief Progress of the child in the memory shared with the parent. "before" is written before "after",
+*   @brief so after the kill the size in the file must be one of them.
+*
+*   @param before - committed size before the current operation
+*   @param  after - size after the current operation
+*   @param    ops - number of the finished operations
+*/
+
+typedef struct _PersistProgress
+{
+    volatile size_t        before;
+    volatile size_t        after;
+    volatile unsigned long ops;
+
+} PersistProgress;
+
+const char *PERSIST_TEST_FILE = "persist_test.stk";
+
+/**
+*   @brief Value of the element at the index "index". It never contains POISON_BYTE.
+*/
+
+static Stack_elem persist_elem(const size_t index)
+{
+    return (Stack_elem) ((index % 128) | ((index / 128) << 8));
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/**
+*   @brief Body of the child: runs random operations on the persistent "Stack" until it is killed.
+*   @brief Exits with the code 2 if the file isn't opened and 3 if an operation fails.
+*
+*   @param     sync [in]         sync - sync policy of the file
+*   @param progress [out]    progress - shared progress of the child
+*
+*   @return never returns
+*/
+
+static void persist_child(const PersistSync sync, PersistProgress *progress)
+{
+    Stack stk = {};
+
+    if (StackPersistOpen(&stk, PERSIST_TEST_FILE, 4, sync, 16))
+        _exit(2);
+
+    srand((unsigned) getpid());
+
+    Stack_elem vals[PERSIST_BATCH] = {};
+
+    for (;;)
+    {
+        const size_t size = stk.size;
+        const size_t num  = 1 + (size_t) rand() % PERSIST_BATCH;
+
+        int op = rand() % 8;
+
+        if (size > PERSIST_MAX_SIZE)            op = 3;
+        if (op >= 3 && op < 5 && size == 0)     op = 0;
+        if (op == 6 && num > size)              op = 5;
+
+        size_t after = size;
+
+        if      (op <  3) after = size + 1;
+        else if (op <  5) after = size - 1;
+        else if (op == 5) after = size + num;
+        else if (op == 6) after = size - num;
+
+        progress->before = size;
+        progress->after  = after;
+
+        unsigned err = 0;
+
+        if (op < 3)
+            err = StackPush(&stk, persist_elem(size));
+
+        else if (op < 5)
+            err = StackPop(&stk);
+
+        else if (op == 5)
+        {
+            for (size_t counter = 0; counter < num; ++counter)
+                vals[counter] = persist_elem(size + counter);
+
+            err = StackPushN(&stk, vals, num);
+        }
+
+        else if (op == 6)
+            err = StackPopN(&stk, vals, num);
+
+        else
+            err = (rand() % 16 == 0) ? StackShrinkToFit(&stk) : StackReserve(&stk, size + num);
+
+        if (err || stk.size != after)
+            _exit(3);
+
+        ++progress->ops;
+    }
+}
+
+/**
+*   @brief One cycle: forks the child, kills it after "lifetime" microseconds and checks the file.
+*
+*   @param     sync [in]         sync - sync policy of the file
+*   @param lifetime [in]     lifetime - lifetime of the child in microseconds
+*   @param progress [in][out] progress - shared progress of the child
+*
+*   @return true if the file is valid
+*/
+
+static bool persist_cycle(const PersistSync sync, const unsigned lifetime, PersistProgress *progress)
+{
+    *progress = {};
+
+    pid_t pid = fork();
+
+    if (pid < 0)
+    {
+        perror("fork");
+        return false;
+    }
+
+    if (pid == 0)
+        persist_child(sync, progress);
+
+    usleep(lifetime);
+    kill(pid, SIGKILL);
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+
+    if (!WIFSIGNALED(status))
+    {
+        printf("child exited with the code %d before the kill\n", WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+        return false;
+    }
+
+    Stack stk = {};
+
+    unsigned err = StackPersistOpen(&stk, PERSIST_TEST_FILE, 4, sync, 16);
+    if (err)
+    {
+        printf("open error %u\n", err);
+        return false;
+    }
+
+    bool is_ok = StackVerify(&stk) == STACK_OK;
+
+    if (!is_ok)
+        printf("verify error %u\n", StackVerify(&stk));
+
+    if (stk.size != progress->before && stk.size != progress->after)
+    {
+        printf("size %zu is neither %zu nor %zu\n", stk.size, (size_t) progress->before, (size_t) progress->after);
+        is_ok = false;
+    }
+
+    for (size_t index = 0; index < stk.size && is_ok; ++index)
+    {
+        if (stk.data[index] != persist_elem(index))
+        {
+            printf("element %zu is %lld instead of %lld\n", index, stk.data[index], persist_elem(index));
+            is_ok = false;
+        }
+    }
+
+    StackDtor(&stk);
+
+    return is_ok;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+int main(int argc, const char *argv[])
+{
+    const unsigned long cycles = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 60;
+    const unsigned      seed   = (argc > 2) ? (unsigned) strtoul(argv[2], nullptr, 10) : (unsigned) time(nullptr);
+
+    srand(seed);
+
+    PersistProgress *progress = (PersistProgress *) mmap(nullptr, sizeof(PersistProgress), PROT_READ | PROT_WRITE,
+                                                         MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (progress == MAP_FAILED)
+    {
+        perror("mmap");
+        return 1;
+    }
+
+    const PersistSync syncs[] = {PERSIST_SYNC_NONE, PERSIST_SYNC_EVERY, PERSIST_SYNC_PERIOD};
+
+    unlink(PERSIST_TEST_FILE);
+
+    unsigned long ops = 0;
+
+    for (unsigned long cycle = 0; cycle < cycles; ++cycle)
+    {
+        const PersistSync sync     = syncs[cycle % (sizeof(syncs) / sizeof(syncs[0]))];
+        const unsigned    lifetime = PERSIST_MIN_KILL + (unsigned) rand() % (PERSIST_MAX_KILL - PERSIST_MIN_KILL);
+
+        if (!persist_cycle(sync, lifetime, progress))
+        {
+            printf("persist_test: cycle %lu (sync %d, seed %u) FAILED\n", cycle, (int) sync, seed);
+            return 1;
+        }
+
+        ops += progress->ops;
+    }
+
+    printf("persist_test: %lu kills, %lu operations, seed %u: OK\n", cycles, ops, seed);
+
+    unlink(PERSIST_TEST_FILE);
+    munmap(progress, sizeof(PersistProgress));
+
+    return 0;
+}
@@ -0,0 +1,186 @@
+/** @file */
+
+/**
+*   @brief Stress test of "LockFreeStack" and "EliminationStack": MT_THREADS threads run rounds of a random number of
+*   @brief pushes followed by as many pops, so a pop never finds the stack empty, and leave MT_LEFT elements at the end.
+*   @brief Every pushed value is unique, the sum and the number of the popped and the drained values must match
+*   @brief the pushed ones. "make mt_test" runs it as is and under ThreadSanitizer.
+*
+*   @brief Usage: stack_mt_test [rounds per thread]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+typedef long long Stack_elem;
+
+#include "../src/stack_common.h"
+#include "../src/stack_lockfree.h"
+#include "../src/stack_elimination.h"
+
+/**
+*   @brief Constants of the test.
+*
+*   @param MT_THREADS - number of threads
+*   @param MT_BATCH   - maximum number of pushes in one round
+*   @param MT_LEFT    - number of elements which every thread leaves in the stack
+*/
+
+enum _MtTestConst
+{
+    MT_THREADS = 8,
+    MT_BATCH   = 16,
+    MT_LEFT    = 100
+};
+
+/**
+*   @brief Totals of one thread.
+*
+*   @param pushed_sum - sum of the pushed values
+*   @param popped_sum - sum of the popped values
+*   @param    pushes  - number of pushes
+*   @param      pops  - number of pops
+*   @param    errors  - number of operations which returned an error
+*/
+
+typedef struct _MtTotals
+{
+    unsigned long long pushed_sum;
+    unsigned long long popped_sum;
+    size_t             pushes;
+    size_t             pops;
+    size_t             errors;
+
+} MtTotals;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/**
+*   @brief Runs MT_THREADS threads over "stk", then drains it by "pop" and compares the totals.
+*
+*   @param   name [in]   name - name of the stack in the report
+*   @param    stk [in]    stk - pointer to the constructed stack
+*   @param rounds [in] rounds - number of rounds of every thread
+*   @param   push [in]   push - push function of the stack
+*   @param    pop [in]    pop - pop function of the stack
+*
+*   @return true if the totals match
+*/
+
+template <typename StackT, typename Push, typename Pop>
+static bool mt_run(const char *name, StackT *stk, const size_t rounds, Push push, Pop pop)
+{
+    std::vector<std::thread> threads;
+    std::vector<MtTotals>    totals(MT_THREADS);
+
+    for (int thread = 0; thread < MT_THREADS; ++thread)
+    {
+        threads.emplace_back([=, &totals]
+        {
+            MtTotals local = {};
+            uint32_t seed  = 2 * (uint32_t) thread + 1;
+
+            // values are unique among all threads: thread number in the high bits, counter in the low ones
+            Stack_elem next_val = ((Stack_elem) thread << 40) + 1;
+
+            for (size_t round = 0; round < rounds; ++round)
+            {
+                seed ^= seed << 13;
+                seed ^= seed >> 17;
+                seed ^= seed <<  5;
+
+                const size_t batch = 1 + seed % MT_BATCH;
+
+                for (size_t counter = 0; counter < batch; ++counter, ++next_val)
+                {
+                    if (push(stk, next_val)) { ++local.errors; continue; }
+
+                    local.pushed_sum += (unsigned long long) next_val;
+                    ++local.pushes;
+                }
+
+                for (size_t counter = 0; counter < batch; ++counter)
+                {
+                    Stack_elem val = 0;
+
+                    if (pop(stk, &val)) { ++local.errors; continue; }
+
+                    local.popped_sum += (unsigned long long) val;
+                    ++local.pops;
+                }
+            }
+
+            for (size_t counter = 0; counter < MT_LEFT; ++counter, ++next_val)
+            {
+                if (push(stk, next_val)) { ++local.errors; continue; }
+
+                local.pushed_sum += (unsigned long long) next_val;
+                ++local.pushes;
+            }
+
+            totals[(size_t) thread] = local;
+        });
+    }
+
+    for (std::thread &thread : threads)
+        thread.join();
+
+    MtTotals sum = {};
+
+    for (const MtTotals &local : totals)
+    {
+        sum.pushed_sum += local.pushed_sum;
+        sum.popped_sum += local.popped_sum;
+        sum.pushes     += local.pushes;
+        sum.pops       += local.pops;
+        sum.errors     += local.errors;
+    }
+
+    Stack_elem val = 0;
+
+    while (pop(stk, &val) == STACK_OK)
+    {
+        sum.popped_sum += (unsigned long long) val;
+        ++sum.pops;
+    }
+
+    const bool is_ok = sum.errors == 0 && sum.pushes == sum.pops && sum.pushed_sum == sum.popped_sum;
+
+    printf("%-12s threads = %d, pushes = %zu, pops = %zu, errors = %zu, pushed sum = %llu, popped sum = %llu: %s\n",
+           name, MT_THREADS, sum.pushes, sum.pops, sum.errors, sum.pushed_sum, sum.popped_sum, is_ok ? "OK" : "FAILED");
+
+    return is_ok;
+}
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+int main(int argc, const char *argv[])
+{
+    const size_t rounds = (argc > 1) ? strtoull(argv[1], nullptr, 10) : 20000;
+
+    bool is_ok = true;
+
+    LockFreeStack lf_stk = {};
+    LockFreeStackCtor(&lf_stk);
+
+    is_ok &= mt_run("lockfree", &lf_stk, rounds,
+                    [] (LockFreeStack *stk, Stack_elem val)  { return LockFreeStackPush(stk, val); },
+                    [] (LockFreeStack *stk, Stack_elem *val) { return LockFreeStackPop (stk, val); });
+
+    is_ok &= LockFreeStackSize(&lf_stk) == 0 && LockFreeStackDtor(&lf_stk) == STACK_OK;
+
+    EliminationStack *el_stk = new EliminationStack();
+    EliminationStackCtor(el_stk);
+
+    is_ok &= mt_run("elimination", el_stk, rounds,
+                    [] (EliminationStack *stk, Stack_elem val)  { return EliminationStackPush(stk, val); },
+                    [] (EliminationStack *stk, Stack_elem *val) { return EliminationStackPop (stk, val); });
+
+    is_ok &= LockFreeStackSize(&el_stk->stk) == 0 && EliminationStackDtor(el_stk) == STACK_OK;
+    delete el_stk;
+
+    return is_ok ? 0 : 1;
+}
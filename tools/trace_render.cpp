@@ -0,0 +1,99 @@
+/** @file */
+
+/**
+*   @brief Offline renderer of the binary "Stack" trace (LOG_TRACE mode of "stack.h").
+*   @brief Turns the trace file into the same log.html layout the live log produces.
+*
+*   @brief Usage: trace_render [trace_file = log.trace] [html_file = log.html]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/trace.h"
+
+int main(int argc, const char *argv[])
+{
+    const char * in_name = (argc > 1) ? argv[1] : "log.trace";
+    const char *out_name = (argc > 2) ? argv[2] : "log.html";
+
+    FILE *in = fopen(in_name, "rb");
+    if (in == nullptr)
+    {
+        fprintf(stderr, "trace_render: can't open \"%s\"\n", in_name);
+        return 1;
+    }
+
+    TraceRenderer rnd = {};
+
+    if (fread(&rnd.header, sizeof(TraceHeader), 1, in) != 1 ||
+        memcmp(rnd.header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0)
+    {
+        fprintf(stderr, "trace_render: \"%s\" is not a stack trace\n", in_name);
+        fclose(in);
+        return 1;
+    }
+
+    if (rnd.header.version != TRACE_VERSION)
+    {
+        fprintf(stderr, "trace_render: unsupported trace version %u\n", rnd.header.version);
+        fclose(in);
+        return 1;
+    }
+
+    rnd.out = fopen(out_name, "w");
+    if (rnd.out == nullptr)
+    {
+        fprintf(stderr, "trace_render: can't open \"%s\"\n", out_name);
+        fclose(in);
+        return 1;
+    }
+
+    trace_render_shift(&rnd, 0);
+
+    TraceRecord    record      = {};
+    unsigned char *payload     = nullptr;
+    size_t         payload_cap = 0;
+    size_t         events_num  = 0;
+
+    while (fread(&record, sizeof(TraceRecord), 1, in) == 1)
+    {
+        if (record.payload_len > payload_cap)
+        {
+            unsigned char *new_payload = (unsigned char *) realloc(payload, record.payload_len);
+            if (new_payload == nullptr)
+            {
+                fprintf(stderr, "trace_render: memory limit exceeded\n");
+                break;
+            }
+
+            payload     = new_payload;
+            payload_cap = record.payload_len;
+        }
+
+        if (record.payload_len && fread(payload, 1, record.payload_len, in) != record.payload_len)
+        {
+            fprintf(stderr, "trace_render: trace is truncated\n");
+            break;
+        }
+
+        trace_render_event(&rnd, &record, payload);
+        ++events_num;
+    }
+
+    fprintf(stderr, "trace_render: %zu events rendered into \"%s\"\n", events_num, out_name);
+
+    for (size_t counter = 0; counter < rnd.strings_cap; ++counter)
+        free(rnd.strings[counter]);
+
+    free(rnd.strings);
+
+    free(payload);
+    free(rnd.tab_shift);
+
+    fclose(rnd.out);
+    fclose(in);
+
+    return 0;
+}